@@ -0,0 +1,120 @@
+#!/bin/bash -e
+
+rootDir="$(cd "$(dirname "$0")/.." && pwd)"
+buildRoot="$rootDir/build"
+
+# Check to see if this is WSL. If it is, we want build output to go into a separate directory so that build output does
+# not collide with Windows build output
+if "$rootDir/scripts/check-wsl.sh"; then
+    buildRoot="$buildRoot/wsl"
+fi
+
+compiler=
+installPrefix=
+vcpkgRoot=
+cmakeArgs=()
+
+function show_help {
+    echo "USAGE:"
+    echo "    pgo.sh [-c <compiler>] [-i <install-prefix>] [-p <path-to-vcpkg-root>]"
+    echo
+    echo "Builds a release version of the library optimized with a profile collected from running the perf tests."
+    echo "A release build without PGO is also built so that the perf test results can be compared."
+    echo
+    echo "ARGUMENTS:"
+    echo "    -c      Spcifies the compiler to use, either 'gcc' (the default) or 'clang'"
+    echo "    -i      Specifies the path used for 'CMAKE_INSTALL_PREFIX'. If this argument is specified, the"
+    echo "            optimized library is installed to this location once it is built."
+    echo "    -p      Specifies the path to the root of your local vcpkg clone. If this value is not"
+    echo "            specified, then the VCPKG_ROOT environment variable is used, if set"
+}
+
+while getopts :hc:i:p: opt; do
+    if [ -n "${OPTARG}" ]; then
+        arg=${OPTARG,,}
+    fi
+    case $opt in
+        h)
+            show_help
+            exit 0
+            ;;
+        c)
+            if [ $arg == "gcc" ]; then
+                compiler="gcc"
+            elif [ $arg == "clang" ]; then
+                compiler="clang"
+            else
+                echo>&2 "Error: Invalid compiler specified. Must be either 'gcc' or 'clang'."
+                exit 1
+            fi
+            ;;
+        i)
+            installPrefix="$OPTARG"
+            ;;
+        p)
+            vcpkgRoot="$OPTARG"
+            ;;
+        *)
+            echo>&2 "ERROR: Invalid argument '-$OPTARG'"
+            show_help
+            exit 1
+            ;;
+    esac
+done
+
+if [ "$compiler" == "" ]; then
+    compiler="gcc"
+fi
+if [ "$vcpkgRoot" == "" ] && [ "$VCPKG_ROOT" != "" ]; then
+    vcpkgRoot="$(realpath "$VCPKG_ROOT")"
+fi
+
+if [ "$compiler" == "gcc" ]; then
+    cmakeArgs+=(-DCMAKE_C_COMPILER=gcc -DCMAKE_CXX_COMPILER=g++)
+elif [ "$compiler" == "clang" ]; then
+    cmakeArgs+=(-DCMAKE_C_COMPILER=clang -DCMAKE_CXX_COMPILER=clang++)
+fi
+
+cmakeArgs+=(-DCMAKE_BUILD_TYPE=Release)
+if [ "$vcpkgRoot" != "" ]; then
+    cmakeArgs+=("-DCMAKE_TOOLCHAIN_FILE=$vcpkgRoot/scripts/buildsystems/vcpkg.cmake")
+fi
+if [ "$installPrefix" != "" ]; then
+    cmakeArgs+=("-DCMAKE_INSTALL_PREFIX=$installPrefix")
+fi
+
+arch=$("$rootDir/scripts/host-arch.sh")
+if [ $? != 0 ]; then
+    echo>&2 "ERROR: Unable to determine the host architecture ($(uname -m))"
+    exit 1
+fi
+
+baselineDir="$buildRoot/$compiler${arch}release"
+pgoDir="$buildRoot/$compiler${arch}release-pgo"
+
+# Baseline build, used only for comparison
+echo "Building baseline from '$baselineDir'"
+cmake -S "$rootDir" -B "$baselineDir" "${cmakeArgs[@]}" -DINFLATELIB_PGO=OFF
+cmake --build "$baselineDir" --target perftests
+
+# Instrumented build + training. The same build directory must be used for the optimized build
+echo "Building instrumented library from '$pgoDir'"
+cmake -S "$rootDir" -B "$pgoDir" "${cmakeArgs[@]}" -DINFLATELIB_PGO=GENERATE
+cmake --build "$pgoDir" --target pgo-train
+
+echo "Building optimized library from '$pgoDir'"
+cmake -S "$rootDir" -B "$pgoDir" -DINFLATELIB_PGO=USE
+cmake --build "$pgoDir"
+
+for mode in "" streaming; do
+    echo
+    echo "Baseline ${mode:-whole buffer}:"
+    "$baselineDir/test/perf/perftests" table totals inflatelib inflatelib64 $mode
+    echo
+    echo "PGO ${mode:-whole buffer}:"
+    "$pgoDir/test/perf/perftests" table totals inflatelib inflatelib64 $mode
+done
+
+if [ "$installPrefix" != "" ]; then
+    cmake --install "$pgoDir"
+fi
@@ -105,8 +105,8 @@ extern "C"
         inflatelib_free free;
 
         /*
-         * A string describing the last error encountered. This pointer is only valid if a library function returned
-         * failure
+         * A short, static string describing the last error encountered. This pointer is only valid if a library
+         * function returned failure. See 'inflatelib_error_message' for a more detailed description
          */
         const char* error_msg;
 
@@ -122,15 +122,120 @@ extern "C"
  * will remain unchanged. A positive return value indicates an "interesting" change in state that is not considered a
  * failure, while a return value of zero indicates generic success.
  */
-#define INFLATELIB_OK 0          /* No error occurred */
-#define INFLATELIB_EOF 1         /* No error occurred; reached the end of the stream */
-#define INFLATELIB_ERROR_ARG -1  /* Invalid argument */
-#define INFLATELIB_ERROR_DATA -2 /* Error in the input data */
-#define INFLATELIB_ERROR_OOM -3  /* Failed to allocate data */
+#define INFLATELIB_OK 0           /* No error occurred */
+#define INFLATELIB_EOF 1          /* No error occurred; reached the end of the stream */
+#define INFLATELIB_ERROR_ARG -1   /* Invalid argument */
+#define INFLATELIB_ERROR_DATA -2  /* Error in the input data */
+#define INFLATELIB_ERROR_OOM -3   /* Failed to allocate data */
+#define INFLATELIB_ERROR_LIMIT -4 /* A limit set with 'inflatelib_set_limits' was exceeded */
+
+/*
+ * Error codes. When a library function fails, the stream records one of these values along with up to three
+ * code-specific values in fixed storage inside the stream's internal state, so reporting an error never allocates
+ * memory. At that point, 'error_msg' is set to a short, static description of the error. A more detailed description
+ * that includes the recorded values can be rendered on demand using 'inflatelib_format_error' or
+ * 'inflatelib_error_message'. The values recorded for each code are listed alongside its definition.
+ */
+#define INFLATELIB_ERRCODE_NONE 0                   /* No error has been recorded */
+#define INFLATELIB_ERRCODE_OUT_OF_MEMORY 1          /* [0]: Number of bytes requested */
+#define INFLATELIB_ERRCODE_MODE_MISMATCH 2          /* [0]: Mode the stream was initialized for (0 = Deflate, 1 = Deflate64) */
+#define INFLATELIB_ERRCODE_INVALID_BLOCK_TYPE 3     /* [0]: Block type read from the input */
+#define INFLATELIB_ERRCODE_BLOCK_LEN_MISMATCH 4     /* [0]: LEN, [1]: NLEN */
+#define INFLATELIB_ERRCODE_TREE_OVERSUBSCRIBED 5    /* [0]: Code length, [1]: Number of symbols, [2]: First code */
+#define INFLATELIB_ERRCODE_REPEAT_AT_START 6        /* No values */
+#define INFLATELIB_ERRCODE_REPEAT_OVERFLOW 7        /* [0]: Number of repetitions, [1]: Number of codes remaining */
+#define INFLATELIB_ERRCODE_ZERO_REPEAT_OVERFLOW 8   /* [0]: Number of repetitions, [1]: Number of codes remaining */
+#define INFLATELIB_ERRCODE_INVALID_CODE 9           /* [0]: Input bits, [1]: Number of valid input bits */
+#define INFLATELIB_ERRCODE_INVALID_SYMBOL 10        /* [0]: Literal/length symbol */
+#define INFLATELIB_ERRCODE_INVALID_DISTANCE_CODE 11 /* [0]: Distance symbol */
+#define INFLATELIB_ERRCODE_DISTANCE_TOO_FAR 12      /* [0]: Distance, [1]: Number of bytes written to the window */
+#define INFLATELIB_ERRCODE_OUTPUT_LIMIT 13          /* [0]: Limit, [1]: Number of bytes the stream would have produced */
+#define INFLATELIB_ERRCODE_RATIO_LIMIT 14           /* [0]: Limit, [1]: Number of bytes produced, [2]: Number of bytes read */
+#define INFLATELIB_ERRCODE_BLOCK_LIMIT 15           /* [0]: Limit */
+#define INFLATELIB_ERRCODE_TABLE_LIMIT 16           /* [0]: Limit */
+#define INFLATELIB_ERRCODE_UNSUPPORTED_MODE 17      /* [0]: Requested mode (0 = Deflate, 1 = Deflate64) */
+
+    typedef struct inflatelib_error_info
+    {
+        /* One of the 'INFLATELIB_ERRCODE_*' values above */
+        int code;
+
+        /* Offset, in bits, from the start of the stream's input at which the error was detected */
+        uintmax_t bit_offset;
+
+        /* Code specific values; see the definition of each 'INFLATELIB_ERRCODE_*' value above */
+        uintmax_t values[3];
+    } inflatelib_error_info;
+
+    /*
+     * Resource limits used to reject malicious input, such as decompression bombs, before spending a large amount of
+     * time decoding it. A value of zero means "no limit." All limits apply to the data inflated since the stream was
+     * last initialized or reset and are checked at block and length/distance pair granularity, so a limit is enforced
+     * before the output of a long copy is produced; a run of literals is accounted for at the next such check. When a
+     * limit is exceeded, the inflate call fails with INFLATELIB_ERROR_LIMIT.
+     */
+    typedef struct inflatelib_limits
+    {
+        /* Maximum number of bytes that may be inflated */
+        uintmax_t max_output;
+
+        /* Maximum ratio of the number of bytes inflated to the number of bytes of input read */
+        uintmax_t max_ratio;
+
+        /* Maximum number of blocks, of any type */
+        uintmax_t max_blocks;
+
+        /* Maximum number of blocks with dynamic Huffman codes, each of which requires building new decoding tables */
+        uintmax_t max_tables;
+    } inflatelib_limits;
+
+    /*
+     * Buffer descriptors used by 'inflatelib_inflatev' and 'inflatelib_inflatev64'. The library updates 'data' and
+     * 'size' in the same way that it updates 'next_in'/'avail_in' and 'next_out'/'avail_out'.
+     */
+    typedef struct inflatelib_input_buffer
+    {
+        const void* data;
+        size_t size;
+    } inflatelib_input_buffer;
+
+    typedef struct inflatelib_output_buffer
+    {
+        void* data;
+        size_t size;
+    } inflatelib_output_buffer;
+
+/*
+ * Decoder phases that time is attributed to by 'inflatelib_get_phase_times'. Time is only attributed to one phase at a
+ * time, so e.g. the time spent building the tables for a dynamic block is not also counted as reading its header.
+ */
+#define INFLATELIB_PHASE_DYNAMIC_HEADER 0 /* Reading the code lengths of dynamic blocks */
+#define INFLATELIB_PHASE_TABLE_BUILD 1    /* Building Huffman decoding tables, for both static and dynamic blocks */
+#define INFLATELIB_PHASE_FAST_DECODE 2    /* Decoding compressed data while there is enough input to skip per-symbol checks */
+#define INFLATELIB_PHASE_SLOW_DECODE 3    /* Everything else: block headers, stored blocks, and the end of the input */
+#define INFLATELIB_PHASE_MATCH_COPY 4     /* Copying length/distance pairs within the window */
+#define INFLATELIB_PHASE_OUTPUT_COPY 5    /* Copying inflated data from the window to the output */
+#define INFLATELIB_PHASE_COUNT 6
+
+#define INFLATELIB_TICKS_CYCLES 0      /* Ticks of the processor's time stamp counter */
+#define INFLATELIB_TICKS_NANOSECONDS 1 /* Nanoseconds, used where no time stamp counter is available */
+
+    typedef struct inflatelib_phase_times
+    {
+        /* One of the 'INFLATELIB_TICKS_*' values above */
+        int unit;
+
+        /* Ticks spent in each phase, indexed by the 'INFLATELIB_PHASE_*' values above */
+        uintmax_t ticks[INFLATELIB_PHASE_COUNT];
+    } inflatelib_phase_times;
 
     /*
      * Initializes the stream. The 'user_data', 'alloc', and 'free' members MUST be set prior to the init call and MUST
      * NOT be changed after the init call completes. This function returns one of the status values specified above.
+     *
+     * NOTE: When the library is built with 'INFLATELIB_MIRRORED_WINDOW' on Linux, the window is a shared memory mapping
+     * that is not inherited across 'fork'. A stream initialized before a call to 'fork' can be destroyed in the child
+     * process, but must not be used for any other function call there. This also applies to 'inflatelib_copy'.
      */
     INFLATELIB_EXPORT int INFLATELIB_CALLCONV inflatelib_init(inflatelib_stream* stream);
 
@@ -149,16 +254,107 @@ extern "C"
      */
     INFLATELIB_EXPORT int INFLATELIB_CALLCONV inflatelib_destroy(inflatelib_stream* stream);
 
+    /*
+     * Initializes 'dest' as a copy of 'source', including any partially inflated data, so that both streams can continue
+     * inflating independently from the same point in the input. This is useful when decoding speculatively, e.g. to
+     * look ahead and then resume from an earlier point. 'dest' must not be initialized; all of its members are
+     * overwritten with those of 'source', including 'user_data', 'alloc', and 'free'. The copy is much cheaper than
+     * inflating the data again: only the part of the window that holds valid data is copied and the Huffman tables are
+     * shared by the two streams until either of them needs to build new tables. Both streams must be destroyed using
+     * 'inflatelib_destroy'. On failure, 'dest' does not need to be destroyed. This function returns one of the status
+     * values specified above.
+     */
+    INFLATELIB_EXPORT int INFLATELIB_CALLCONV inflatelib_copy(inflatelib_stream* dest, const inflatelib_stream* source);
+
     /*
      *
      */
     INFLATELIB_EXPORT int INFLATELIB_CALLCONV inflatelib_inflate(inflatelib_stream* stream);
 
     /*
-     *
+     * NOTE: Builds configured with 'INFLATELIB_SMALL_FOOTPRINT' only support Deflate. In such builds, this function and
+     * 'inflatelib_inflatev64' fail with 'INFLATELIB_ERROR_ARG' and record 'INFLATELIB_ERRCODE_UNSUPPORTED_MODE'.
      */
     INFLATELIB_EXPORT int INFLATELIB_CALLCONV inflatelib_inflate64(inflatelib_stream* stream);
 
+    /*
+     * Scatter/gather versions of 'inflatelib_inflate' and 'inflatelib_inflate64'. Input is read from the buffers in
+     * 'inputs' in order, and output is written to the buffers in 'outputs' in order, moving from one buffer to the next
+     * within a single call. Each buffer is updated to reflect the data that was consumed or written, so buffers with a
+     * size of zero after the call have been fully consumed or filled. The call returns once all input has been
+     * consumed, all output buffers have been filled, the end of the stream has been reached, or the per-call budget set
+     * by 'inflatelib_set_call_budget' has been reached, which applies to the call as a whole. The 'next_in', 'avail_in',
+     * 'next_out', and 'avail_out' members of the stream are not read, and their values after the call are unspecified.
+     * The return values are the same as the single buffer versions and the two can be freely mixed.
+     */
+    INFLATELIB_EXPORT int INFLATELIB_CALLCONV inflatelib_inflatev(
+        inflatelib_stream* stream,
+        inflatelib_input_buffer* inputs,
+        size_t inputCount,
+        inflatelib_output_buffer* outputs,
+        size_t outputCount);
+    INFLATELIB_EXPORT int INFLATELIB_CALLCONV inflatelib_inflatev64(
+        inflatelib_stream* stream,
+        inflatelib_input_buffer* inputs,
+        size_t inputCount,
+        inflatelib_output_buffer* outputs,
+        size_t outputCount);
+
+    /*
+     * Sets the resource limits enforced by the stream, replacing any previously set limits. Passing null removes all
+     * limits. Limits persist across calls to 'inflatelib_reset' and take effect immediately, even when called part of
+     * the way through inflating a stream. This function returns one of the status values specified above.
+     */
+    INFLATELIB_EXPORT int INFLATELIB_CALLCONV inflatelib_set_limits(inflatelib_stream* stream, const inflatelib_limits* limits);
+
+    /*
+     * Caps the amount of work done by a single call to 'inflatelib_inflate' or 'inflatelib_inflate64', which gives
+     * predictable latency when inflating on a thread that must remain responsive, such as an event loop. 'maxOutput' is
+     * the maximum number of bytes written to 'next_out' and 'maxSymbols' is the maximum number of literals and
+     * length/distance pairs decoded in a single call. A value of zero means "no cap." When a cap is reached, the call
+     * returns INFLATELIB_OK with its progress saved, even if input and output space remain, and the caller should call
+     * again to make further progress. These caps persist across calls to 'inflatelib_reset'. This function returns one
+     * of the status values specified above.
+     */
+    INFLATELIB_EXPORT int INFLATELIB_CALLCONV inflatelib_set_call_budget(
+        inflatelib_stream* stream, size_t maxOutput, size_t maxSymbols);
+
+    /*
+     * Retrieves the structured details of the last error recorded by the stream. If no error has been recorded, the
+     * 'code' member of 'info' will be set to 'INFLATELIB_ERRCODE_NONE'. This function returns INFLATELIB_ERROR_ARG if
+     * the stream has not been initialized and INFLATELIB_OK otherwise.
+     */
+    INFLATELIB_EXPORT int INFLATELIB_CALLCONV inflatelib_get_error(const inflatelib_stream* stream, inflatelib_error_info* info);
+
+    /*
+     * Renders a detailed, human readable description of the last error recorded by the stream into 'buffer'. The
+     * result is always null terminated if 'bufferSize' is non-zero, truncating if necessary. The return value follows
+     * the same semantics as 'snprintf': the length of the full description, not including the null terminator, or a
+     * negative value on failure. This function does not allocate memory.
+     */
+    INFLATELIB_EXPORT int INFLATELIB_CALLCONV inflatelib_format_error(
+        const inflatelib_stream* stream, char* buffer, size_t bufferSize);
+
+    /*
+     * Same as 'inflatelib_format_error', but renders into a fixed size buffer owned by the stream and returns a pointer
+     * to it. The returned pointer remains valid until the next call to a library function with the same stream,
+     * including another call to this function, which overwrites the buffer. Since this modifies the stream, it must not
+     * be called from multiple threads at once; use 'inflatelib_format_error' with caller owned storage instead. If the
+     * stream has not been initialized, or no error has been recorded, this returns 'error_msg'.
+     */
+    INFLATELIB_EXPORT const char* INFLATELIB_CALLCONV inflatelib_error_message(inflatelib_stream* stream);
+
+    /*
+     * Retrieves the time spent in each phase of decoding since the stream was initialized or last reset. Only time spent
+     * inside the inflate functions is counted. This is only supported when the library is built with
+     * 'INFLATELIB_PHASE_TIMING', which reads a timestamp each time decoding moves from one phase to another. That slows
+     * decoding down, especially for data with many short matches, so it is meant for finding where the time goes for a
+     * given stream and not for measuring throughput. This function returns INFLATELIB_ERROR_ARG if the stream has not
+     * been initialized or the library was built without 'INFLATELIB_PHASE_TIMING' and INFLATELIB_OK otherwise.
+     */
+    INFLATELIB_EXPORT int INFLATELIB_CALLCONV inflatelib_get_phase_times(
+        const inflatelib_stream* stream, inflatelib_phase_times* times);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
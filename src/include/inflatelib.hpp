@@ -11,18 +11,135 @@
 
 #include "inflatelib.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
+#include <memory>
+#include <memory_resource>
 #include <new>
 #include <span>
 #include <stdexcept>
+#include <string>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 /*
  * C++ Wrappers/helpers around the deflate64 functions/types
  */
 namespace inflatelib
 {
+namespace details
+{
+    // Contiguous, resizable containers of bytes, e.g. 'std::vector<std::byte>' or 'std::string'
+    template <typename Container>
+    concept byte_container = (sizeof(typename Container::value_type) == 1) && requires(Container& container) {
+        container.data();
+        container.resize(container.size());
+    };
+
+    template <typename Allocator>
+    concept allocator = requires(Allocator& alloc, std::size_t count) {
+        typename Allocator::value_type;
+        alloc.deallocate(alloc.allocate(count), count);
+    };
+
+    // Allocation hooks that forward to a 'std::pmr::memory_resource', passed as the user data
+    inline void* resource_alloc(void* userData, size_t bytes, size_t alignment) noexcept
+    {
+        try
+        {
+            return static_cast<std::pmr::memory_resource*>(userData)->allocate(bytes, alignment);
+        }
+        catch (...)
+        {
+            return nullptr; // The library reports the failure as INFLATELIB_ERROR_OOM
+        }
+    }
+
+    inline void resource_free(void* userData, void* ptr, size_t bytes, size_t alignment) noexcept
+    {
+        static_cast<std::pmr::memory_resource*>(userData)->deallocate(ptr, bytes, alignment);
+    }
+
+    // Allocation hooks that forward to an Allocator. Memory is allocated in units of 'std::max_align_t' so that the
+    // alignment requested by the library is honored. Stateless allocators are default constructed as needed, otherwise
+    // a copy of the allocator is stored in memory allocated from itself and passed as the user data
+    template <typename Allocator>
+    struct allocator_hooks
+    {
+        using traits = std::allocator_traits<Allocator>;
+        using storage_allocator = typename traits::template rebind_alloc<std::max_align_t>;
+        using storage_traits = std::allocator_traits<storage_allocator>;
+        using self_allocator = typename traits::template rebind_alloc<Allocator>;
+        using self_traits = std::allocator_traits<self_allocator>;
+
+        static constexpr bool is_stateless = traits::is_always_equal::value && std::is_default_constructible_v<Allocator>;
+
+        static std::size_t unit_count(std::size_t bytes) noexcept
+        {
+            return (bytes + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t);
+        }
+
+        static storage_allocator get(void* userData) noexcept
+        {
+            if constexpr (is_stateless)
+            {
+                return storage_allocator();
+            }
+            else
+            {
+                return storage_allocator(*static_cast<Allocator*>(userData));
+            }
+        }
+
+        static void* alloc(void* userData, size_t bytes, size_t alignment) noexcept
+        {
+            if (alignment > alignof(std::max_align_t))
+            {
+                return nullptr; // Over-aligned allocations are not supported
+            }
+
+            try
+            {
+                auto storage = get(userData);
+                return storage_traits::allocate(storage, unit_count(bytes));
+            }
+            catch (...)
+            {
+                return nullptr; // The library reports the failure as INFLATELIB_ERROR_OOM
+            }
+        }
+
+        static void free(void* userData, void* ptr, size_t bytes, size_t) noexcept
+        {
+            auto storage = get(userData);
+            storage_traits::deallocate(storage, static_cast<std::max_align_t*>(ptr), unit_count(bytes));
+        }
+
+        static void* store(const Allocator& allocator)
+        {
+            self_allocator self(allocator);
+            auto result = self_traits::allocate(self, 1);
+            self_traits::construct(self, result, allocator);
+            return result;
+        }
+
+        static void* duplicate(void* userData)
+        {
+            return store(*static_cast<Allocator*>(userData));
+        }
+
+        static void release(void* userData) noexcept
+        {
+            auto ptr = static_cast<Allocator*>(userData);
+            self_allocator self(*ptr);
+            self_traits::destroy(self, ptr);
+            self_traits::deallocate(self, ptr, 1);
+        }
+    };
+} // namespace details
+
 struct stream
 {
     stream()
@@ -38,6 +155,37 @@ struct stream
         init();
     }
 
+    // Allocates the internal state from 'resource', which must outlive the stream. When using an arena such as
+    // 'std::pmr::monotonic_buffer_resource', the state's memory is reclaimed along with the rest of the arena
+    explicit stream(std::pmr::memory_resource* resource) : stream(resource, &details::resource_alloc, &details::resource_free)
+    {
+    }
+
+    // Allocates the internal state using a copy of 'allocator'
+    template <details::allocator Allocator>
+    explicit stream(const Allocator& allocator)
+    {
+        using hooks = details::allocator_hooks<Allocator>;
+        m_stream.alloc = &hooks::alloc;
+        m_stream.free = &hooks::free;
+        if constexpr (!hooks::is_stateless)
+        {
+            m_stream.user_data = hooks::store(allocator);
+            m_release = &hooks::release;
+            m_duplicate = &hooks::duplicate;
+        }
+
+        try
+        {
+            init();
+        }
+        catch (...)
+        {
+            release(); // The destructor won't run
+            throw;
+        }
+    }
+
     // Constructor that allows for no initialization of the underlying inflatelib_stream. This is primarily useful
     // for scenarios such as global variables or struct members whose initialization should be delayed until needed
     stream(std::nullptr_t) noexcept
@@ -49,17 +197,59 @@ struct stream
         // NOTE: Okay to call even in the moved-from state since all fields will be null
         [[maybe_unused]] auto result = ::inflatelib_destroy(&m_stream);
         assert(result == INFLATELIB_OK);
+        release();
+    }
+
+    // Copies the state of 'other', including any partially inflated data, so that both streams can continue inflating
+    // independently from the same point. See 'inflatelib_copy' for more information. Copying a stream that has not been
+    // initialized produces another stream that has not been initialized
+    stream(const stream& other)
+    {
+        if (!other)
+        {
+            return;
+        }
+
+        if (auto result = ::inflatelib_copy(&m_stream, &other.m_stream); result != INFLATELIB_OK)
+        {
+            throw_error(result);
+        }
+
+        if (other.m_duplicate)
+        {
+            // The copy gets its own copy of the allocator. Copies of an allocator compare equal, so memory shared by the
+            // two streams can be freed by either of them
+            try
+            {
+                m_stream.user_data = other.m_duplicate(other.m_stream.user_data);
+            }
+            catch (...)
+            {
+                ::inflatelib_destroy(&m_stream); // The destructor won't run
+                throw;
+            }
+
+            m_release = other.m_release;
+            m_duplicate = other.m_duplicate;
+        }
     }
 
-    // Internal state is not copyable
-    stream(const stream&) = delete;
-    stream& operator=(const stream&) = delete;
+    stream& operator=(const stream& other)
+    {
+        if (this != &other)
+        {
+            *this = stream(other);
+        }
+        return *this;
+    }
 
     // All data inside the inflatelib_stream can safely be relocated. Clearing all values to zero is sufficient to
     // avoid issues when destroying the stream
-    stream(stream&& other) noexcept : m_stream(other.m_stream)
+    stream(stream&& other) noexcept : m_stream(other.m_stream), m_release(other.m_release), m_duplicate(other.m_duplicate)
     {
         other.m_stream = {};
+        other.m_release = nullptr;
+        other.m_duplicate = nullptr;
     }
 
     stream& operator=(stream&& other) noexcept
@@ -69,10 +259,15 @@ struct stream
             // Destroy the current stream
             // NOTE: Okay to call even in the moved-from state since all fields will be null
             ::inflatelib_destroy(&m_stream);
+            release();
 
             // Move the other stream into this one
             m_stream = other.m_stream;
+            m_release = other.m_release;
+            m_duplicate = other.m_duplicate;
             other.m_stream = {};
+            other.m_release = nullptr;
+            other.m_duplicate = nullptr;
         }
         return *this;
     }
@@ -85,6 +280,22 @@ struct stream
         }
     }
 
+    void set_limits(const inflatelib_limits& limits)
+    {
+        if (auto result = ::inflatelib_set_limits(&m_stream, &limits); result != INFLATELIB_OK)
+        {
+            throw_error(result);
+        }
+    }
+
+    void set_call_budget(std::size_t maxOutput, std::size_t maxSymbols)
+    {
+        if (auto result = ::inflatelib_set_call_budget(&m_stream, maxOutput, maxSymbols); result != INFLATELIB_OK)
+        {
+            throw_error(result);
+        }
+    }
+
     [[nodiscard]] bool inflate(std::span<const std::byte>& input, std::span<std::byte>& output)
     {
         auto result = try_inflate(input, output);
@@ -139,6 +350,58 @@ struct stream
         return result;
     }
 
+    // Scatter/gather versions of the above; the buffers are updated in place to reflect what was consumed/written
+    [[nodiscard]] bool inflatev(std::span<inflatelib_input_buffer> inputs, std::span<inflatelib_output_buffer> outputs)
+    {
+        auto result = try_inflatev(inputs, outputs);
+        if (result < INFLATELIB_OK)
+        {
+            throw_error(result);
+        }
+
+        return result == INFLATELIB_OK; // Return true if the caller should keep calling
+    }
+
+    [[nodiscard]] int try_inflatev(
+        std::span<inflatelib_input_buffer> inputs, std::span<inflatelib_output_buffer> outputs) noexcept
+    {
+        return ::inflatelib_inflatev(&m_stream, inputs.data(), inputs.size(), outputs.data(), outputs.size());
+    }
+
+    [[nodiscard]] bool inflatev64(std::span<inflatelib_input_buffer> inputs, std::span<inflatelib_output_buffer> outputs)
+    {
+        auto result = try_inflatev64(inputs, outputs);
+        if (result < INFLATELIB_OK)
+        {
+            throw_error(result);
+        }
+
+        return result == INFLATELIB_OK; // Return true if the caller should keep calling
+    }
+
+    [[nodiscard]] int try_inflatev64(
+        std::span<inflatelib_input_buffer> inputs, std::span<inflatelib_output_buffer> outputs) noexcept
+    {
+        return ::inflatelib_inflatev64(&m_stream, inputs.data(), inputs.size(), outputs.data(), outputs.size());
+    }
+
+    // Inflates all of 'input', appending the result to 'output', which must be a contiguous container of bytes such as
+    // 'std::vector<std::byte>' or 'std::string'. 'sizeHint' is the expected size of the inflated data, e.g. the
+    // uncompressed size recorded in a ZIP header. When the hint is accurate, the data is inflated directly into its final
+    // location with a single call. Otherwise, the container grows geometrically. On return, 'input' refers to any data
+    // that follows the end of the compressed data
+    template <details::byte_container Container>
+    void inflate_all(std::span<const std::byte>& input, Container& output, std::size_t sizeHint = 0)
+    {
+        inflate_all_impl<&stream::try_inflate>(input, output, sizeHint);
+    }
+
+    template <details::byte_container Container>
+    void inflate64_all(std::span<const std::byte>& input, Container& output, std::size_t sizeHint = 0)
+    {
+        inflate_all_impl<&stream::try_inflate64>(input, output, sizeHint);
+    }
+
     [[nodiscard]] inflatelib_stream* get() noexcept
     {
         return &m_stream;
@@ -154,6 +417,27 @@ struct stream
         return m_stream.error_msg;
     }
 
+    // Renders the detailed description of the last error, which includes the values that 'error_msg' leaves out
+    [[nodiscard]] std::string error_detail() const
+    {
+        std::string result;
+        auto length = ::inflatelib_format_error(&m_stream, nullptr, 0);
+        if (length > 0)
+        {
+            result.resize(static_cast<std::size_t>(length));
+            ::inflatelib_format_error(&m_stream, result.data(), result.size() + 1);
+        }
+
+        return result;
+    }
+
+    [[nodiscard]] inflatelib_error_info error_info() const noexcept
+    {
+        inflatelib_error_info result = {};
+        [[maybe_unused]] auto status = ::inflatelib_get_error(&m_stream, &result);
+        return result; // NOTE: Code will be 'INFLATELIB_ERRCODE_NONE' if the stream is not initialized
+    }
+
     // Convenience method to check if the stream has been initialized
     operator bool() const noexcept
     {
@@ -161,6 +445,17 @@ struct stream
     }
 
 private:
+    // Frees the allocator copy made by the allocator constructor, if any
+    void release() noexcept
+    {
+        if (m_release)
+        {
+            m_release(m_stream.user_data);
+            m_release = nullptr;
+            m_duplicate = nullptr;
+        }
+    }
+
     void init()
     {
         if (auto result = ::inflatelib_init(&m_stream); result != INFLATELIB_OK)
@@ -169,12 +464,53 @@ private:
         }
     }
 
+    template <auto InflateFunc, typename Container>
+    void inflate_all_impl(std::span<const std::byte>& input, Container& output, std::size_t sizeHint)
+    {
+        // Without a hint, start by assuming a typical compression ratio
+        constexpr std::size_t min_growth = 0x1000;
+        auto offset = output.size();
+        output.resize(offset + (sizeHint ? sizeHint : std::max(input.size() * 4, min_growth)));
+
+        while (true)
+        {
+            std::span<std::byte> outputSpan(reinterpret_cast<std::byte*>(output.data()) + offset, output.size() - offset);
+            auto outputSize = outputSpan.size();
+            auto inputSize = input.size();
+            auto result = (this->*InflateFunc)(input, outputSpan);
+            offset += outputSize - outputSpan.size();
+
+            if (result < INFLATELIB_OK)
+            {
+                output.resize(offset);
+                throw_error(result);
+            }
+            else if (result == INFLATELIB_EOF)
+            {
+                break;
+            }
+            else if (outputSpan.empty())
+            {
+                output.resize(output.size() + std::max(output.size(), min_growth));
+            }
+            else if (input.empty() && (outputSpan.size() == outputSize) && (input.size() == inputSize))
+            {
+                output.resize(offset);
+                throw std::runtime_error("Input ended before the end of the compressed data");
+            }
+            // Otherwise, we reached the limit set by 'set_call_budget' and need to keep going. NOTE: The budget can stop
+            // a call after all input has been consumed, with buffered bits or an unfinished copy still to be written
+        }
+
+        output.resize(offset);
+    }
+
     [[noreturn]] void throw_error(int result)
     {
         assert(result < 0); // Likely EOF, but wrong conditional
 
-        auto msg = m_stream.error_msg;
-        if (!msg)
+        auto msg = error_detail();
+        if (msg.empty())
         {
             msg = "unknown failure in inflatelib stream";
         }
@@ -193,11 +529,69 @@ private:
             throw std::runtime_error(msg);
         case INFLATELIB_ERROR_OOM:
             throw std::bad_alloc();
+        case INFLATELIB_ERROR_LIMIT:
+            throw std::range_error(msg);
         }
     }
 
     inflatelib_stream m_stream = {};
+    void (*m_release)(void*) noexcept = nullptr;
+    void* (*m_duplicate)(void*) = nullptr;
+};
+
+// Convenience functions that inflate all of 'input' into a new container. See 'stream::inflate_all' for more information
+template <details::byte_container Container = std::vector<std::byte>>
+[[nodiscard]] Container inflate_all(std::span<const std::byte> input, std::size_t sizeHint = 0, Container output = {})
+{
+    stream strm;
+    strm.inflate_all(input, output, sizeHint);
+    return output;
+}
+
+template <details::byte_container Container = std::vector<std::byte>>
+[[nodiscard]] Container inflate64_all(std::span<const std::byte> input, std::size_t sizeHint = 0, Container output = {})
+{
+    stream strm;
+    strm.inflate64_all(input, output, sizeHint);
+    return output;
+}
+
+// Same as the above, but both the output and the stream's internal state are allocated using 'resource'
+[[nodiscard]] inline std::pmr::vector<std::byte> inflate_all(
+    std::span<const std::byte> input, std::size_t sizeHint, std::pmr::memory_resource* resource)
+{
+    stream strm(resource);
+    std::pmr::vector<std::byte> output(resource);
+    strm.inflate_all(input, output, sizeHint);
+    return output;
+}
+
+[[nodiscard]] inline std::pmr::vector<std::byte> inflate64_all(
+    std::span<const std::byte> input, std::size_t sizeHint, std::pmr::memory_resource* resource)
+{
+    stream strm(resource);
+    std::pmr::vector<std::byte> output(resource);
+    strm.inflate64_all(input, output, sizeHint);
+    return output;
+}
+
+// Default buffer size used by 'istreambuf', 'zip_reader', 'inflate_chunks', and 'inflate64_chunks', which are declared in
+// the 'inflatelib_*.hpp' headers
+constexpr std::size_t default_chunk_size = 0x10000;
+
+enum class format
+{
+    deflate,
+    deflate64,
 };
+
+namespace details
+{
+    [[nodiscard]] inline bool inflate(stream& strm, format fmt, std::span<const std::byte>& input, std::span<std::byte>& output)
+    {
+        return (fmt == format::deflate64) ? strm.inflate64(input, output) : strm.inflate(input, output);
+    }
+} // namespace details
 } // namespace inflatelib
 
 #endif // INFLATELIB_HPP
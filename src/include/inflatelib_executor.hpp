@@ -0,0 +1,359 @@
+/*
+ *    Copyright (c) Microsoft. All rights reserved.
+ *    This code is licensed under the MIT License.
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF
+ *    ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+ *    TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ *    PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ */
+#ifndef INFLATELIB_EXECUTOR_HPP
+#define INFLATELIB_EXECUTOR_HPP
+
+#include "inflatelib.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/*
+ * Thread pool for inflating many independent buffers concurrently. This requires a threads library to be linked
+ */
+namespace inflatelib
+{
+// Thread pool that inflates independent buffers (e.g. ZIP entries, records, etc.) concurrently. Each worker thread owns a
+// single 'stream' that is reset and reused for every job it runs. Each worker has its own queue; jobs are taken from the
+// front of the worker's own queue and idle workers steal from the back of other workers' queues. Batches are distributed
+// largest first so that large jobs start early and small jobs fill in the gaps
+class executor
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    struct job
+    {
+        std::span<const std::byte> input;
+
+        // Inflated data is written to 'output' unless 'sink' is set, in which case it is called with each chunk of inflated
+        // data as it is produced. 'sink' is called on a worker thread
+        std::span<std::byte> output;
+        std::function<void(std::span<const std::byte>)> sink;
+
+        format fmt = format::deflate;
+    };
+
+    struct job_result
+    {
+        std::size_t input_consumed = 0;
+        std::size_t output_written = 0;
+        clock::duration queue_wait{}; // Time between submission and a worker starting the job
+        clock::duration run_time{};   // Time spent inflating, including any calls to 'sink'
+        std::exception_ptr error;     // Set if the job failed; for futures, this is instead thrown from 'get'
+    };
+
+    // Called on a worker thread once the job completes. Completion callbacks must not throw
+    using completion = std::function<void(const job_result&)>;
+
+    // A thread count of zero uses one thread per hardware thread
+    explicit executor(std::size_t threadCount = 0)
+    {
+        if (threadCount == 0)
+        {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        m_queues.reserve(threadCount);
+        for (std::size_t i = 0; i < threadCount; ++i)
+        {
+            m_queues.push_back(std::make_unique<worker_queue>());
+        }
+
+        m_threads.reserve(threadCount);
+        try
+        {
+            for (std::size_t i = 0; i < threadCount; ++i)
+            {
+                m_threads.emplace_back(&executor::worker_main, this, i);
+            }
+        }
+        catch (...)
+        {
+            stop();
+            throw;
+        }
+    }
+
+    executor(const executor&) = delete;
+    executor& operator=(const executor&) = delete;
+
+    // Waits for all submitted jobs to complete
+    ~executor()
+    {
+        stop();
+    }
+
+    std::size_t thread_count() const noexcept
+    {
+        return m_threads.size();
+    }
+
+    [[nodiscard]] std::future<job_result> submit(job work)
+    {
+        auto promise = std::make_shared<std::promise<job_result>>();
+        auto result = promise->get_future();
+        enqueue(next_queue(), std::move(work), make_completion(std::move(promise)));
+        return result;
+    }
+
+    void submit(job work, completion done)
+    {
+        enqueue(next_queue(), std::move(work), std::move(done));
+    }
+
+    // Submits multiple jobs at once. The returned futures are in the same order as 'jobs'
+    [[nodiscard]] std::vector<std::future<job_result>> submit_batch(std::vector<job> jobs)
+    {
+        std::vector<std::future<job_result>> results;
+        results.reserve(jobs.size());
+
+        std::vector<std::pair<job*, completion>> tasks;
+        tasks.reserve(jobs.size());
+        for (auto& work : jobs)
+        {
+            auto promise = std::make_shared<std::promise<job_result>>();
+            results.push_back(promise->get_future());
+            tasks.emplace_back(&work, make_completion(std::move(promise)));
+        }
+
+        std::stable_sort(tasks.begin(), tasks.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.first->input.size() > rhs.first->input.size();
+        });
+
+        for (auto& [work, done] : tasks)
+        {
+            enqueue(next_queue(), std::move(*work), std::move(done));
+        }
+
+        return results;
+    }
+
+private:
+    struct task
+    {
+        job work;
+        completion done;
+        clock::time_point enqueued;
+    };
+
+    struct worker_queue
+    {
+        std::mutex mutex;
+        std::deque<task> tasks;
+    };
+
+    static completion make_completion(std::shared_ptr<std::promise<job_result>> promise)
+    {
+        return [promise = std::move(promise)](const job_result& result) {
+            if (result.error)
+            {
+                promise->set_exception(result.error);
+            }
+            else
+            {
+                promise->set_value(result);
+            }
+        };
+    }
+
+    std::size_t next_queue() noexcept
+    {
+        return m_nextQueue.fetch_add(1, std::memory_order_relaxed) % m_queues.size();
+    }
+
+    void enqueue(std::size_t index, job work, completion done)
+    {
+        // Count the task before publishing it. Otherwise a worker could dequeue it and decrement 'm_pending' first
+        {
+            std::lock_guard lock(m_mutex);
+            ++m_pending;
+        }
+
+        {
+            auto& queue = *m_queues[index];
+            std::lock_guard lock(queue.mutex);
+            queue.tasks.push_back(task{std::move(work), std::move(done), clock::now()});
+        }
+        m_cv.notify_one();
+    }
+
+    bool try_dequeue(std::size_t index, task& result)
+    {
+        {
+            auto& queue = *m_queues[index];
+            std::lock_guard lock(queue.mutex);
+            if (!queue.tasks.empty())
+            {
+                result = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+                return true;
+            }
+        }
+
+        for (std::size_t i = 1; i < m_queues.size(); ++i)
+        {
+            auto& queue = *m_queues[(index + i) % m_queues.size()];
+            std::lock_guard lock(queue.mutex);
+            if (!queue.tasks.empty())
+            {
+                result = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard lock(m_mutex);
+            m_stopping = true;
+        }
+        m_cv.notify_all();
+
+        for (auto& thread : m_threads)
+        {
+            thread.join();
+        }
+    }
+
+    void worker_main(std::size_t index)
+    {
+        stream strm;
+        std::vector<std::byte> buffer;
+
+        while (true)
+        {
+            task current;
+            if (try_dequeue(index, current))
+            {
+                {
+                    std::lock_guard lock(m_mutex);
+                    --m_pending;
+                }
+                run(strm, buffer, current);
+                continue;
+            }
+
+            std::unique_lock lock(m_mutex);
+            m_cv.wait(lock, [&] {
+                return m_stopping || (m_pending > 0);
+            });
+            if (m_pending == 0)
+            {
+                return; // Stopping and there's no more work
+            }
+        }
+    }
+
+    static void run(stream& strm, std::vector<std::byte>& buffer, task& current)
+    {
+        job_result result;
+        auto start = clock::now();
+        result.queue_wait = start - current.enqueued;
+
+        auto& work = current.work;
+        auto input = work.input;
+        try
+        {
+            strm.reset();
+            if (work.sink)
+            {
+                buffer.resize(default_chunk_size);
+                while (true)
+                {
+                    std::span<std::byte> output = buffer;
+                    auto keepGoing = details::inflate(strm, work.fmt, input, output);
+
+                    if (auto written = buffer.size() - output.size())
+                    {
+                        result.output_written += written;
+                        work.sink(std::span<const std::byte>(buffer.data(), written));
+                    }
+
+                    if (!keepGoing)
+                    {
+                        break;
+                    }
+                    else if (input.empty() && !output.empty())
+                    {
+                        throw std::runtime_error("Input ended before the end of the compressed data");
+                    }
+                }
+            }
+            else
+            {
+                // If the output fills up, inflate into one extra byte to distinguish data that fits exactly from data
+                // that does not fit
+                auto output = work.output;
+                std::byte overflow;
+                bool checkingOverflow = false;
+                while (details::inflate(strm, work.fmt, input, output))
+                {
+                    if (output.empty())
+                    {
+                        if (checkingOverflow)
+                        {
+                            throw std::length_error("Output buffer is too small to hold the inflated data");
+                        }
+                        output = std::span<std::byte>(&overflow, 1);
+                        checkingOverflow = true;
+                    }
+                    else if (input.empty())
+                    {
+                        throw std::runtime_error("Input ended before the end of the compressed data");
+                    }
+                }
+
+                if (checkingOverflow && output.empty())
+                {
+                    throw std::length_error("Output buffer is too small to hold the inflated data");
+                }
+                result.output_written = checkingOverflow ? work.output.size() : (work.output.size() - output.size());
+            }
+        }
+        catch (...)
+        {
+            result.error = std::current_exception();
+        }
+
+        result.input_consumed = work.input.size() - input.size();
+        result.run_time = clock::now() - start;
+        current.done(result);
+    }
+
+    std::vector<std::unique_ptr<worker_queue>> m_queues;
+    std::vector<std::thread> m_threads;
+    std::atomic<std::size_t> m_nextQueue{0};
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::size_t m_pending = 0; // Jobs that have been queued, but not yet dequeued
+    bool m_stopping = false;
+};
+} // namespace inflatelib
+
+#endif // INFLATELIB_EXECUTOR_HPP
@@ -0,0 +1,347 @@
+/*
+ *    Copyright (c) Microsoft. All rights reserved.
+ *    This code is licensed under the MIT License.
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF
+ *    ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+ *    TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ *    PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ */
+#ifndef INFLATELIB_GENERATOR_HPP
+#define INFLATELIB_GENERATOR_HPP
+
+#include "inflatelib.hpp"
+
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#if __cpp_impl_coroutine >= 201902L
+#include <coroutine>
+#include <ranges>
+#define INFLATELIB_HAS_COROUTINES 1
+#endif
+
+/*
+ * Coroutine generator that lazily inflates a range of input chunks. This requires C++20 coroutine support and is kept out
+ * of <inflatelib.hpp> so that consumers who do not use it do not pay for <coroutine> and <ranges>
+ */
+namespace inflatelib
+{
+#if INFLATELIB_HAS_COROUTINES
+namespace details
+{
+    // Allocation of coroutine frames from a caller provided allocator. The frame is followed by the function used to free it
+    // and a copy of the allocator so that 'operator delete', which only receives the frame's size, can find both
+    struct frame_allocation
+    {
+        using deallocate_fn = void (*)(void* frame, std::size_t frameSize) noexcept;
+
+        static constexpr std::size_t align_up(std::size_t size) noexcept
+        {
+            return (size + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+        }
+
+        template <typename Allocator>
+        using storage_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<std::max_align_t>;
+
+        template <typename Allocator>
+        static constexpr std::size_t unit_count(std::size_t frameSize) noexcept
+        {
+            auto bytes = align_up(frameSize) + align_up(sizeof(deallocate_fn)) + align_up(sizeof(storage_allocator<Allocator>));
+            return bytes / sizeof(std::max_align_t);
+        }
+
+        template <typename Allocator>
+        static void* allocate(const Allocator& allocator, std::size_t frameSize)
+        {
+            using traits = std::allocator_traits<storage_allocator<Allocator>>;
+            storage_allocator<Allocator> storage(allocator);
+            auto result = reinterpret_cast<std::byte*>(traits::allocate(storage, unit_count<Allocator>(frameSize)));
+
+            auto trailer = result + align_up(frameSize);
+            ::new (trailer) deallocate_fn(&deallocate<Allocator>);
+            ::new (trailer + align_up(sizeof(deallocate_fn))) storage_allocator<Allocator>(std::move(storage));
+            return result;
+        }
+
+        template <typename Allocator>
+        static void deallocate(void* frame, std::size_t frameSize) noexcept
+        {
+            using traits = std::allocator_traits<storage_allocator<Allocator>>;
+            auto trailer = static_cast<std::byte*>(frame) + align_up(frameSize);
+            auto storedAllocator =
+                std::launder(reinterpret_cast<storage_allocator<Allocator>*>(trailer + align_up(sizeof(deallocate_fn))));
+
+            storage_allocator<Allocator> storage(std::move(*storedAllocator));
+            storedAllocator->~storage_allocator<Allocator>();
+            traits::deallocate(storage, static_cast<std::max_align_t*>(frame), unit_count<Allocator>(frameSize));
+        }
+
+        static void free(void* frame, std::size_t frameSize) noexcept
+        {
+            auto trailer = static_cast<std::byte*>(frame) + align_up(frameSize);
+            (*std::launder(reinterpret_cast<deallocate_fn*>(trailer)))(frame, frameSize);
+        }
+    };
+} // namespace details
+
+// Minimal, move-only generator that lazily produces a sequence of values, similar to C++23's 'std::generator'. Values are
+// referenced, not copied, and are only valid until the iterator is next incremented. The coroutine frame is allocated
+// using the allocator passed after 'std::allocator_arg' in the coroutine's parameter list, if any
+template <typename T>
+class generator
+{
+public:
+    struct promise_type
+    {
+        const T* value = nullptr;
+        std::exception_ptr exception;
+
+        generator get_return_object() noexcept
+        {
+            return generator(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() const noexcept
+        {
+            return {};
+        }
+
+        std::suspend_always final_suspend() const noexcept
+        {
+            return {};
+        }
+
+        std::suspend_always yield_value(const T& yielded) noexcept
+        {
+            value = std::addressof(yielded);
+            return {};
+        }
+
+        void return_void() const noexcept
+        {
+        }
+
+        void unhandled_exception() noexcept
+        {
+            exception = std::current_exception();
+        }
+
+        // Generators only produce values; they cannot await
+        template <typename U>
+        void await_transform(U&&) = delete;
+
+        static void* operator new(std::size_t size)
+        {
+            return details::frame_allocation::allocate(std::allocator<std::byte>{}, size);
+        }
+
+        template <typename Allocator, typename... Args>
+        static void* operator new(std::size_t size, std::allocator_arg_t, const Allocator& allocator, const Args&...)
+        {
+            return details::frame_allocation::allocate(allocator, size);
+        }
+
+        static void operator delete(void* ptr, std::size_t size) noexcept
+        {
+            details::frame_allocation::free(ptr, size);
+        }
+
+        template <typename Allocator, typename... Args>
+        static void operator delete(void* ptr, std::size_t size, std::allocator_arg_t, const Allocator&, const Args&...) noexcept
+        {
+            details::frame_allocation::free(ptr, size);
+        }
+    };
+
+    struct sentinel
+    {
+    };
+
+    class iterator
+    {
+    public:
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() = default;
+
+        explicit iterator(std::coroutine_handle<promise_type> handle) noexcept : m_handle(handle)
+        {
+        }
+
+        const T& operator*() const noexcept
+        {
+            return *m_handle.promise().value;
+        }
+
+        iterator& operator++()
+        {
+            resume(m_handle);
+            return *this;
+        }
+
+        void operator++(int)
+        {
+            ++*this;
+        }
+
+        friend bool operator==(const iterator& it, sentinel) noexcept
+        {
+            return it.m_handle.done();
+        }
+
+    private:
+        std::coroutine_handle<promise_type> m_handle;
+    };
+
+    generator(generator&& other) noexcept : m_handle(std::exchange(other.m_handle, {}))
+    {
+    }
+
+    generator& operator=(generator&& other) noexcept
+    {
+        if (this != &other)
+        {
+            if (m_handle)
+            {
+                m_handle.destroy();
+            }
+            m_handle = std::exchange(other.m_handle, {});
+        }
+        return *this;
+    }
+
+    ~generator()
+    {
+        if (m_handle)
+        {
+            m_handle.destroy();
+        }
+    }
+
+    // NOTE: Like any input range, 'begin' should only be called once
+    iterator begin()
+    {
+        resume(m_handle);
+        return iterator(m_handle);
+    }
+
+    sentinel end() const noexcept
+    {
+        return {};
+    }
+
+private:
+    explicit generator(std::coroutine_handle<promise_type> handle) noexcept : m_handle(handle)
+    {
+    }
+
+    static void resume(std::coroutine_handle<promise_type> handle)
+    {
+        handle.resume();
+        if (auto exception = std::exchange(handle.promise().exception, {}))
+        {
+            std::rethrow_exception(exception);
+        }
+    }
+
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+namespace details
+{
+    // GCC's '-Wmismatched-new-delete' pairs allocation and deallocation functions by name, and it treats the promise's
+    // templated placement 'operator new' as a different function from its usual 'operator delete'. It then reports a
+    // false positive where the frame is freed. The warning is attributed to the coroutine, not the promise, when the
+    // call is not inlined, so it is suppressed around the coroutine's definition
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+    template <auto InflateFunc, typename Allocator, typename Range>
+    generator<std::span<const std::byte>> inflate_chunks(
+        std::allocator_arg_t, Allocator allocator, stream& strm, Range inputs, std::size_t bufferSize)
+    {
+        using buffer_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<std::byte>;
+        std::vector<std::byte, buffer_allocator> buffer(bufferSize, buffer_allocator(allocator));
+
+        for (auto&& chunk : inputs)
+        {
+            std::span<const std::byte> input = chunk;
+            while (true)
+            {
+                std::span<std::byte> output = buffer;
+                auto inputSize = input.size();
+                auto keepGoing = (strm.*InflateFunc)(input, output);
+
+                auto written = buffer.size() - output.size();
+                if (written)
+                {
+                    co_yield std::span<const std::byte>(buffer.data(), written);
+                }
+
+                if (!keepGoing)
+                {
+                    co_return; // EOF; any remaining input is ignored
+                }
+                else if (input.empty() && !written && (input.size() == inputSize))
+                {
+                    break; // Need more input
+                }
+                // Otherwise, keep going. The output buffer may have been filled, or we may have reached the limit set by
+                // 'set_call_budget', possibly with buffered bits or an unfinished copy left after the input was consumed
+            }
+        }
+
+        throw std::runtime_error("Input ended before the end of the compressed data");
+    }
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+} // namespace details
+
+// Lazily inflates the chunks of compressed data in 'inputs', a range of values convertible to
+// 'std::span<const std::byte>', yielding spans of inflated data. Each yielded span refers to a buffer of 'bufferSize'
+// bytes that is reused for the next chunk of output, so no data is copied. 'inputs' is stored in the coroutine frame;
+// use 'std::views::all' or 'std::ref' to avoid copying a container. Both 'strm' and the data referenced by 'inputs' must
+// outlive the generator. Errors are thrown from the iterator's increment operator
+template <std::ranges::input_range Range>
+[[nodiscard]] generator<std::span<const std::byte>> inflate_chunks(
+    stream& strm, Range inputs, std::size_t bufferSize = default_chunk_size)
+{
+    return details::inflate_chunks<&stream::inflate>(
+        std::allocator_arg, std::allocator<std::byte>{}, strm, std::move(inputs), bufferSize);
+}
+
+template <std::ranges::input_range Range>
+[[nodiscard]] generator<std::span<const std::byte>> inflate64_chunks(
+    stream& strm, Range inputs, std::size_t bufferSize = default_chunk_size)
+{
+    return details::inflate_chunks<&stream::inflate64>(
+        std::allocator_arg, std::allocator<std::byte>{}, strm, std::move(inputs), bufferSize);
+}
+
+// Same as the above, but the coroutine frame and output buffer are allocated using 'allocator'
+template <details::allocator Allocator, std::ranges::input_range Range>
+[[nodiscard]] generator<std::span<const std::byte>> inflate_chunks(
+    std::allocator_arg_t, const Allocator& allocator, stream& strm, Range inputs, std::size_t bufferSize = default_chunk_size)
+{
+    return details::inflate_chunks<&stream::inflate>(std::allocator_arg, allocator, strm, std::move(inputs), bufferSize);
+}
+
+template <details::allocator Allocator, std::ranges::input_range Range>
+[[nodiscard]] generator<std::span<const std::byte>> inflate64_chunks(
+    std::allocator_arg_t, const Allocator& allocator, stream& strm, Range inputs, std::size_t bufferSize = default_chunk_size)
+{
+    return details::inflate_chunks<&stream::inflate64>(std::allocator_arg, allocator, strm, std::move(inputs), bufferSize);
+}
+#endif
+} // namespace inflatelib
+
+#endif // INFLATELIB_GENERATOR_HPP
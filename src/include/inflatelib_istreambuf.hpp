@@ -0,0 +1,156 @@
+/*
+ *    Copyright (c) Microsoft. All rights reserved.
+ *    This code is licensed under the MIT License.
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF
+ *    ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+ *    TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ *    PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ */
+#ifndef INFLATELIB_ISTREAMBUF_HPP
+#define INFLATELIB_ISTREAMBUF_HPP
+
+#include "inflatelib.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include <streambuf>
+#include <vector>
+
+/*
+ * Adapter for reading inflated data through a 'std::istream'
+ */
+namespace inflatelib
+{
+// Read-only 'std::streambuf' that inflates data read from an upstream 'std::streambuf' or from memory, allowing compressed
+// data to be read through a 'std::istream'. The get area points into an internal buffer that is refilled on underflow;
+// reads that are at least as large as this buffer are inflated directly into the caller's buffer. Data is read from the
+// upstream 'std::streambuf' in blocks, so any data following the end of the compressed data may have been consumed. Errors
+// are thrown as exceptions, which 'std::istream' reports by setting 'badbit'
+class istreambuf : public std::streambuf
+{
+public:
+    explicit istreambuf(std::streambuf& source, format fmt = format::deflate, std::size_t bufferSize = default_chunk_size) :
+        m_source(&source), m_format(fmt), m_input(bufferSize), m_output(bufferSize)
+    {
+        init_get_area();
+    }
+
+    explicit istreambuf(
+        std::span<const std::byte> source, format fmt = format::deflate, std::size_t bufferSize = default_chunk_size) :
+        m_format(fmt), m_pendingInput(source), m_output(bufferSize)
+    {
+        init_get_area();
+    }
+
+    istreambuf(const istreambuf&) = delete;
+    istreambuf& operator=(const istreambuf&) = delete;
+
+    // Provides access to the underlying stream, e.g. to call 'set_limits'
+    inflatelib::stream& get_stream() noexcept
+    {
+        return m_stream;
+    }
+
+protected:
+    int_type underflow() override
+    {
+        if (gptr() < egptr())
+        {
+            return traits_type::to_int_type(*gptr());
+        }
+
+        auto begin = m_output.data();
+        auto written = inflate_into(reinterpret_cast<std::byte*>(begin), m_output.size());
+        setg(begin, begin, begin + written);
+        return (written == 0) ? traits_type::eof() : traits_type::to_int_type(*gptr());
+    }
+
+    std::streamsize xsgetn(char_type* dest, std::streamsize count) override
+    {
+        std::streamsize result = 0;
+        while (result < count)
+        {
+            if (auto available = egptr() - gptr(); available > 0)
+            {
+                auto len = std::min(available, count - result);
+                std::copy_n(gptr(), len, dest + result);
+                gbump(static_cast<int>(len));
+                result += len;
+            }
+            else if (static_cast<std::size_t>(count - result) >= m_output.size())
+            {
+                // Large read; skip the intermediate buffer
+                auto remaining = static_cast<std::size_t>(count - result);
+                auto written = inflate_into(reinterpret_cast<std::byte*>(dest + result), remaining);
+                if (written == 0)
+                {
+                    break;
+                }
+                result += static_cast<std::streamsize>(written);
+            }
+            else if (traits_type::eq_int_type(underflow(), traits_type::eof()))
+            {
+                break;
+            }
+        }
+
+        return result;
+    }
+
+    std::streamsize showmanyc() override
+    {
+        return m_done ? -1 : 0;
+    }
+
+private:
+    void init_get_area() noexcept
+    {
+        auto begin = m_output.data();
+        setg(begin, begin, begin);
+    }
+
+    // Inflates up to 'size' bytes into 'dest', blocking on the upstream source until at least one byte has been produced.
+    // Returns zero once the end of the compressed data has been reached
+    std::size_t inflate_into(std::byte* dest, std::size_t size)
+    {
+        std::span<std::byte> output(dest, size);
+        while (!m_done && (output.size() == size))
+        {
+            if (m_pendingInput.empty() && m_source)
+            {
+                auto bytesRead =
+                    m_source->sgetn(reinterpret_cast<char*>(m_input.data()), static_cast<std::streamsize>(m_input.size()));
+                m_pendingInput = std::span<const std::byte>(m_input.data(), static_cast<std::size_t>(bytesRead));
+                if (bytesRead <= 0)
+                {
+                    m_source = nullptr;
+                }
+            }
+
+            auto inputSize = m_pendingInput.size();
+            if (!details::inflate(m_stream, m_format, m_pendingInput, output))
+            {
+                m_done = true;
+            }
+            else if (!m_source && m_pendingInput.empty() && (inputSize == 0) && (output.size() == size))
+            {
+                throw std::runtime_error("Input ended before the end of the compressed data");
+            }
+        }
+
+        return size - output.size();
+    }
+
+    inflatelib::stream m_stream;
+    std::streambuf* m_source = nullptr;
+    format m_format;
+    bool m_done = false;
+    std::vector<std::byte> m_input;
+    std::span<const std::byte> m_pendingInput;
+    std::vector<char> m_output;
+};
+} // namespace inflatelib
+
+#endif // INFLATELIB_ISTREAMBUF_HPP
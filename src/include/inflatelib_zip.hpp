@@ -0,0 +1,425 @@
+/*
+ *    Copyright (c) Microsoft. All rights reserved.
+ *    This code is licensed under the MIT License.
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF
+ *    ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+ *    TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ *    PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ */
+#ifndef INFLATELIB_ZIP_HPP
+#define INFLATELIB_ZIP_HPP
+
+#include "inflatelib.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+/*
+ * Single-pass reader for the entries of a ZIP archive. Only the container format is handled here; writing the entries
+ * out is left to the caller
+ */
+namespace inflatelib
+{
+// Metadata read from a ZIP local file header. When 'has_data_descriptor' is true, the CRC and sizes in the local header are
+// typically zero and are replaced with the values from the data descriptor once the entry's data has been read to the end
+struct zip_entry
+{
+    std::string name;
+    std::uint16_t flags = 0;
+    std::uint16_t method = 0;
+    std::uint32_t crc32 = 0;
+    std::uint64_t compressed_size = 0;
+    std::uint64_t uncompressed_size = 0;
+
+    [[nodiscard]] bool has_data_descriptor() const noexcept
+    {
+        return (flags & 0x0008) != 0;
+    }
+};
+
+// Reads the entries of a ZIP archive in a single pass in the order that their local file headers appear, without seeking to
+// the central directory. This allows archives to be extracted as they arrive over a pipe or socket using a fixed amount of
+// memory. For Deflate and Deflate64 entries that defer their sizes to a data descriptor, the end of the compressed data is
+// used to locate the descriptor; any input read past that point is handed back by the stream and used to parse the next
+// header. Stored entries must record their size in the local header. CRCs are not verified; the value in 'entry().crc32'
+// is final once 'read' returns zero
+class zip_reader
+{
+public:
+    static constexpr std::uint16_t method_stored = 0;
+    static constexpr std::uint16_t method_deflate = 8;
+    static constexpr std::uint16_t method_deflate64 = 9;
+
+    explicit zip_reader(std::streambuf& source, std::size_t bufferSize = default_chunk_size) :
+        m_source(&source), m_input(bufferSize)
+    {
+    }
+
+    explicit zip_reader(std::span<const std::byte> source) : m_pendingInput(source)
+    {
+    }
+
+    zip_reader(const zip_reader&) = delete;
+    zip_reader& operator=(const zip_reader&) = delete;
+
+    // Advances to the next entry, skipping any data from the current entry that has not been read. Returns false once the
+    // central directory or the end of the input has been reached
+    [[nodiscard]] bool next_entry()
+    {
+        if (m_state == state::data)
+        {
+            skip_data();
+        }
+
+        if (m_state == state::end)
+        {
+            return false;
+        }
+
+        if (!fill(4))
+        {
+            if (!m_pendingInput.empty())
+            {
+                throw_truncated();
+            }
+            m_state = state::end;
+            return false;
+        }
+
+        auto signature = read_le<std::uint32_t>(0);
+        if ((signature == central_directory_signature) || (signature == end_of_central_directory_signature) ||
+            (signature == zip64_end_of_central_directory_signature) || (signature == archive_extra_data_signature))
+        {
+            m_state = state::end;
+            return false;
+        }
+        else if (signature != local_file_header_signature)
+        {
+            throw std::runtime_error("Invalid ZIP local file header signature");
+        }
+
+        if (!fill(local_file_header_size))
+        {
+            throw_truncated();
+        }
+
+        auto nameLength = read_le<std::uint16_t>(26);
+        auto extraLength = read_le<std::uint16_t>(28);
+        auto headerSize = local_file_header_size + nameLength + extraLength;
+        if (!fill(headerSize))
+        {
+            throw_truncated();
+        }
+
+        m_entry.flags = read_le<std::uint16_t>(6);
+        m_entry.method = read_le<std::uint16_t>(8);
+        m_entry.crc32 = read_le<std::uint32_t>(14);
+        m_entry.compressed_size = read_le<std::uint32_t>(18);
+        m_entry.uncompressed_size = read_le<std::uint32_t>(22);
+        m_entry.name.assign(reinterpret_cast<const char*>(m_pendingInput.data()) + local_file_header_size, nameLength);
+
+        // The Zip64 extra field holds the sizes that don't fit in the header and also means that the data descriptor, if
+        // present, uses 64-bit sizes
+        m_zip64 = false;
+        for (std::size_t offset = local_file_header_size + nameLength; offset + 4 <= headerSize;)
+        {
+            auto id = read_le<std::uint16_t>(offset);
+            auto end = std::min<std::size_t>(offset + 4 + read_le<std::uint16_t>(offset + 2), headerSize);
+            if (id == zip64_extra_field_id)
+            {
+                m_zip64 = true;
+                auto pos = offset + 4;
+                if ((m_entry.uncompressed_size == 0xFFFFFFFF) && (pos + 8 <= end))
+                {
+                    m_entry.uncompressed_size = read_le<std::uint64_t>(pos);
+                    pos += 8;
+                }
+                if ((m_entry.compressed_size == 0xFFFFFFFF) && (pos + 8 <= end))
+                {
+                    m_entry.compressed_size = read_le<std::uint64_t>(pos);
+                }
+            }
+            offset = end;
+        }
+
+        consume(headerSize);
+        m_remaining = m_entry.compressed_size;
+        m_consumed = 0;
+        m_written = 0;
+        m_state = state::data;
+        if ((m_entry.method == method_deflate) || (m_entry.method == method_deflate64))
+        {
+            m_stream.reset();
+        }
+
+        return true;
+    }
+
+    [[nodiscard]] const zip_entry& entry() const noexcept
+    {
+        return m_entry;
+    }
+
+    // Reads up to 'output.size()' bytes of the current entry's data into 'output', blocking on the source until at least
+    // one byte has been produced. Returns the number of bytes written, or zero once the end of the entry has been reached
+    [[nodiscard]] std::size_t read(std::span<std::byte> output)
+    {
+        if ((m_state != state::data) || output.empty())
+        {
+            return 0;
+        }
+
+        if ((m_entry.flags & 0x0001) != 0)
+        {
+            throw std::runtime_error("Encrypted ZIP entries are not supported");
+        }
+
+        auto size = output.size();
+        if (m_entry.method == method_stored)
+        {
+            if (m_entry.has_data_descriptor())
+            {
+                throw std::runtime_error("Stored ZIP entries with a data descriptor cannot be read in a single pass");
+            }
+
+            while (!output.empty() && (m_remaining > 0))
+            {
+                if (!fill(1))
+                {
+                    throw_truncated();
+                }
+
+                auto available = std::min(output.size(), m_pendingInput.size());
+                auto len = static_cast<std::size_t>(std::min<std::uint64_t>(available, m_remaining));
+                std::copy_n(m_pendingInput.data(), len, output.data());
+                consume(len);
+                m_consumed += len;
+                m_remaining -= len;
+                output = output.subspan(len);
+            }
+
+            if (m_remaining == 0)
+            {
+                m_written += size - output.size();
+                finish_data();
+                return size - output.size();
+            }
+        }
+        else if ((m_entry.method == method_deflate) || (m_entry.method == method_deflate64))
+        {
+            auto fmt = (m_entry.method == method_deflate64) ? format::deflate64 : format::deflate;
+            while (output.size() == size)
+            {
+                if (m_pendingInput.empty())
+                {
+                    fill(1);
+                }
+
+                // When the compressed size is known, don't hand the stream any data belonging to the next entry
+                auto input = m_pendingInput;
+                if (!m_entry.has_data_descriptor())
+                {
+                    input = input.first(static_cast<std::size_t>(std::min<std::uint64_t>(input.size(), m_remaining)));
+                }
+
+                auto inputSize = input.size();
+                auto outputSize = output.size();
+                auto keepGoing = details::inflate(m_stream, fmt, input, output);
+                auto consumed = inputSize - input.size();
+                consume(consumed);
+                m_consumed += consumed;
+                m_remaining -= std::min<std::uint64_t>(consumed, m_remaining);
+
+                if (!keepGoing)
+                {
+                    m_written += size - output.size();
+                    finish_data();
+                    return size - output.size();
+                }
+                else if ((inputSize == 0) && (output.size() == outputSize))
+                {
+                    throw_truncated();
+                }
+            }
+        }
+        else
+        {
+            throw std::runtime_error("Unsupported ZIP compression method");
+        }
+
+        m_written += size - output.size();
+        return size - output.size();
+    }
+
+    // Provides access to the underlying stream, e.g. to call 'set_limits'
+    inflatelib::stream& get_stream() noexcept
+    {
+        return m_stream;
+    }
+
+private:
+    static constexpr std::uint32_t local_file_header_signature = 0x04034b50;
+    static constexpr std::uint32_t data_descriptor_signature = 0x08074b50;
+    static constexpr std::uint32_t central_directory_signature = 0x02014b50;
+    static constexpr std::uint32_t end_of_central_directory_signature = 0x06054b50;
+    static constexpr std::uint32_t zip64_end_of_central_directory_signature = 0x06064b50;
+    static constexpr std::uint32_t archive_extra_data_signature = 0x08064b50;
+    static constexpr std::uint16_t zip64_extra_field_id = 0x0001;
+    static constexpr std::size_t local_file_header_size = 30;
+
+    enum class state
+    {
+        header,
+        data,
+        end,
+    };
+
+    [[noreturn]] static void throw_truncated()
+    {
+        throw std::runtime_error("Input ended before the end of the ZIP entry");
+    }
+
+    template <typename T>
+    [[nodiscard]] T read_le(std::size_t offset) const noexcept
+    {
+        T result = 0;
+        for (std::size_t i = 0; i < sizeof(T); ++i)
+        {
+            result |= static_cast<T>(std::to_integer<T>(m_pendingInput[offset + i]) << (i * 8));
+        }
+        return result;
+    }
+
+    void consume(std::size_t count) noexcept
+    {
+        m_pendingInput = m_pendingInput.subspan(count);
+    }
+
+    // Ensures that at least 'size' contiguous bytes of input are available, returning false if the source ends first. Unread
+    // input is moved to the front of the buffer, which only grows if a single header is larger than the buffer
+    bool fill(std::size_t size)
+    {
+        if (m_pendingInput.size() >= size)
+        {
+            return true;
+        }
+        else if (!m_source)
+        {
+            return false;
+        }
+
+        auto length = m_pendingInput.size();
+        std::copy_n(m_pendingInput.data(), length, m_input.data());
+        if (m_input.size() < size)
+        {
+            m_input.resize(size);
+        }
+
+        while (length < size)
+        {
+            auto bytesRead = m_source->sgetn(
+                reinterpret_cast<char*>(m_input.data() + length), static_cast<std::streamsize>(m_input.size() - length));
+            if (bytesRead <= 0)
+            {
+                m_source = nullptr;
+                break;
+            }
+            length += static_cast<std::size_t>(bytesRead);
+        }
+
+        m_pendingInput = std::span<const std::byte>(m_input.data(), length);
+        return length >= size;
+    }
+
+    void skip_data()
+    {
+        if (m_entry.has_data_descriptor())
+        {
+            // The only way to find the end of the data is to inflate it
+            std::byte buffer[0x1000];
+            while (read(buffer) != 0)
+            {
+            }
+            return;
+        }
+
+        while (m_remaining > 0)
+        {
+            if (!fill(1))
+            {
+                throw_truncated();
+            }
+
+            auto len = static_cast<std::size_t>(std::min<std::uint64_t>(m_pendingInput.size(), m_remaining));
+            consume(len);
+            m_remaining -= len;
+        }
+        m_state = state::header;
+    }
+
+    // Called once the end of the entry's data has been reached to read the data descriptor, if any, and check the sizes
+    void finish_data()
+    {
+        if (!m_entry.has_data_descriptor())
+        {
+            // Skip anything the encoder wrote after the end of the compressed data
+            m_consumed += m_remaining;
+            while (m_remaining > 0)
+            {
+                if (!fill(1))
+                {
+                    throw_truncated();
+                }
+
+                auto len = static_cast<std::size_t>(std::min<std::uint64_t>(m_pendingInput.size(), m_remaining));
+                consume(len);
+                m_remaining -= len;
+            }
+        }
+        else
+        {
+            // The signature is optional
+            if (fill(4) && (read_le<std::uint32_t>(0) == data_descriptor_signature))
+            {
+                consume(4);
+            }
+
+            std::size_t sizeBytes = m_zip64 ? 8 : 4;
+            if (!fill(4 + 2 * sizeBytes))
+            {
+                throw_truncated();
+            }
+
+            m_entry.crc32 = read_le<std::uint32_t>(0);
+            m_entry.compressed_size = m_zip64 ? read_le<std::uint64_t>(4) : read_le<std::uint32_t>(4);
+            m_entry.uncompressed_size = m_zip64 ? read_le<std::uint64_t>(12) : read_le<std::uint32_t>(8);
+            consume(4 + 2 * sizeBytes);
+        }
+
+        m_state = state::header;
+        if ((m_consumed != m_entry.compressed_size) || (m_written != m_entry.uncompressed_size))
+        {
+            throw std::runtime_error("ZIP entry sizes do not match the entry's data");
+        }
+    }
+
+    inflatelib::stream m_stream;
+    std::streambuf* m_source = nullptr;
+    std::vector<std::byte> m_input;
+    std::span<const std::byte> m_pendingInput;
+    zip_entry m_entry;
+    state m_state = state::header;
+    bool m_zip64 = false;
+    std::uint64_t m_remaining = 0;
+    std::uint64_t m_consumed = 0;
+    std::uint64_t m_written = 0;
+};
+} // namespace inflatelib
+
+#endif // INFLATELIB_ZIP_HPP
@@ -0,0 +1,49 @@
+#
+# Generates a single source file containing the whole library, for projects that would rather compile inflatelib as part
+# of their own build. Each local '#include' is replaced by the contents of the file it names, starting from 'inflatelib.c'.
+# Every file is inlined at most once, so later includes of a header that has already been inlined are removed, which
+# matches what its include guard would have done. The result only depends on the public 'inflatelib.h' header.
+#
+# Usage: cmake -DSOURCE_DIR=<src/lib> -DOUTPUT=<path to the generated file> -P amalgamate.cmake
+#
+
+cmake_minimum_required(VERSION 3.20)
+
+if (NOT SOURCE_DIR OR NOT OUTPUT)
+    message(FATAL_ERROR "SOURCE_DIR and OUTPUT must both be set")
+endif()
+
+file(READ "${SOURCE_DIR}/inflatelib.c" contents)
+set(inlined_files)
+set(offset 0)
+
+while (TRUE)
+    string(SUBSTRING "${contents}" ${offset} -1 remaining)
+    string(REGEX MATCH "#include \"([A-Za-z_]+\\.[ch])\"[^\n]*\n" include_line "${remaining}")
+    if (NOT include_line)
+        break()
+    endif()
+    set(file_name "${CMAKE_MATCH_1}")
+
+    string(FIND "${remaining}" "${include_line}" include_offset)
+    math(EXPR include_offset "${offset} + ${include_offset}")
+    string(LENGTH "${include_line}" include_length)
+    math(EXPR include_end "${include_offset} + ${include_length}")
+
+    if (file_name IN_LIST inlined_files)
+        set(replacement "")
+    elseif (NOT EXISTS "${SOURCE_DIR}/${file_name}")
+        message(FATAL_ERROR "'${file_name}' is included, but is not a file in ${SOURCE_DIR}")
+    else()
+        list(APPEND inlined_files "${file_name}")
+        file(READ "${SOURCE_DIR}/${file_name}" replacement)
+    endif()
+
+    # Splice in the file, then continue from the start of what was inserted so that its own includes are inlined too
+    string(SUBSTRING "${contents}" 0 ${include_offset} before)
+    string(SUBSTRING "${contents}" ${include_end} -1 after)
+    string(CONCAT contents "${before}" "${replacement}" "${after}")
+    set(offset ${include_offset})
+endwhile()
+
+file(WRITE "${OUTPUT}" "/* Generated from the sources in src/lib by amalgamate.cmake. Do not edit. */\n" "${contents}")
@@ -117,21 +117,6 @@ static inline void bitstream_fill_buffer(bitstream* stream)
     }
 }
 
-static inline void bitstream_fill_buffer_unchecked(bitstream* stream)
-{
-    if (stream->bits_in_buffer < 16)
-    {
-        uint32_t newData;
-
-        assert(stream->length >= 2); /* Caller should have verified */
-        newData = ((uint32_t)stream->data[0]) | (((uint32_t)stream->data[1]) << 8);
-        stream->buffer |= newData << stream->bits_in_buffer;
-        stream->bits_in_buffer += 16;
-        stream->data += 2;
-        stream->length -= 2;
-    }
-}
-
 size_t bitstream_read_bits(bitstream* stream, size_t bitsToRead, uint16_t* result)
 {
     uint32_t mask;
@@ -152,23 +137,6 @@ size_t bitstream_read_bits(bitstream* stream, size_t bitsToRead, uint16_t* resul
     return 1;
 }
 
-uint16_t bitstream_read_bits_unchecked(bitstream* stream, size_t bitsToRead)
-{
-    uint16_t result;
-    uint32_t mask = ((uint32_t)1 << bitsToRead) - 1;
-
-    assert((bitsToRead > 0) && (bitsToRead <= (sizeof(result) * 8)));
-
-    bitstream_fill_buffer_unchecked(stream);
-    assert(bitsToRead <= stream->bits_in_buffer);
-
-    result = (uint16_t)(stream->buffer & mask);
-    stream->buffer >>= bitsToRead;
-    stream->bits_in_buffer -= bitsToRead;
-
-    return result;
-}
-
 size_t bitstream_peek(bitstream* stream, uint16_t* result)
 {
     bitstream_fill_buffer(stream);
@@ -176,9 +144,3 @@ size_t bitstream_peek(bitstream* stream, uint16_t* result)
     *result = (uint16_t)stream->buffer;
     return (stream->bits_in_buffer <= 16) ? stream->bits_in_buffer : 16;
 }
-
-uint16_t bitstream_peek_unchecked(bitstream* stream)
-{
-    bitstream_fill_buffer_unchecked(stream);
-    return (uint16_t)stream->buffer;
-}
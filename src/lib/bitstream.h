@@ -9,6 +9,7 @@
 #ifndef INFLATELIB_BITSTREAM_H
 #define INFLATELIB_BITSTREAM_H
 
+#include <assert.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -64,9 +65,45 @@ extern "C"
         stream->bits_in_buffer -= bits;
     }
 
-    /* Same as the above functions, but does not check to verify that the bitstream has enough input data */
-    uint16_t bitstream_read_bits_unchecked(bitstream* stream, size_t bitsToRead);
-    uint16_t bitstream_peek_unchecked(bitstream* stream);
+    /* Same as the above functions, but does not check to verify that the bitstream has enough input data. These are
+     * defined inline since they are called for every symbol decoded on the fast path */
+    static inline void bitstream_fill_buffer_unchecked(bitstream* stream)
+    {
+        if (stream->bits_in_buffer < 16)
+        {
+            uint32_t newData;
+
+            assert(stream->length >= 2); /* Caller should have verified */
+            newData = ((uint32_t)stream->data[0]) | (((uint32_t)stream->data[1]) << 8);
+            stream->buffer |= newData << stream->bits_in_buffer;
+            stream->bits_in_buffer += 16;
+            stream->data += 2;
+            stream->length -= 2;
+        }
+    }
+
+    static inline uint16_t bitstream_read_bits_unchecked(bitstream* stream, size_t bitsToRead)
+    {
+        uint16_t result;
+        uint32_t mask = ((uint32_t)1 << bitsToRead) - 1;
+
+        assert((bitsToRead > 0) && (bitsToRead <= (sizeof(result) * 8)));
+
+        bitstream_fill_buffer_unchecked(stream);
+        assert(bitsToRead <= stream->bits_in_buffer);
+
+        result = (uint16_t)(stream->buffer & mask);
+        stream->buffer >>= bitsToRead;
+        stream->bits_in_buffer -= bitsToRead;
+
+        return result;
+    }
+
+    static inline uint16_t bitstream_peek_unchecked(bitstream* stream)
+    {
+        bitstream_fill_buffer_unchecked(stream);
+        return (uint16_t)stream->buffer;
+    }
 
 #ifdef __cplusplus
 }
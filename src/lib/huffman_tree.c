@@ -50,9 +50,82 @@
  *      additional node gained by being able to increase a single node's height by one. The net change from the maximums
  *      calculated above is zero.
  */
+#ifndef INFLATELIB_SMALL_FOOTPRINT
+#define LITERAL_LENGTH_TREE_TABLE_BITS 10
+#define DISTANCE_TREE_TABLE_BITS 7
 #define CODE_LENGTH_TREE_ARRAY_SIZE 128
 #define DISTANCE_TREE_ARRAY_SIZE 204
 #define LITERAL_LENGTH_TREE_ARRAY_SIZE 1590
+#else
+/*
+ * Small footprint builds trade lookup speed for memory by using 8 bits for the literal/length lookup table and 6 bits for
+ * the distance lookup table. The code length tree is unchanged. Applying the same analysis as above:
+ *
+ *      1.  Distance Tree: 9 bits are left for the binary tree portion of the array. All 32 symbols still fit in a single
+ *          subtree, so the max is '(31 * 2 - 2) + (2 * 9) = 78'. This gives a max array size of 64 + 78 = 142.
+ *      2.  Literal/Length Tree: 7 bits are left for the binary tree portion of the array, for a maximum of 128 leaves in
+ *          a single subtree. One tree structure that gives us max memory usage is: one subtree with 31 leaves, 2
+ *          subtrees with 128 leaves, and a final subtree with a single leaf at max height. Solving for the total number
+ *          of nodes gives '(31 * 2 - 2) + 2 * (128 * 2 - 2) + (2 * 7) = 582'. This gives a max array size of
+ *          256 + 582 = 838.
+ */
+#define LITERAL_LENGTH_TREE_TABLE_BITS 8
+#define DISTANCE_TREE_TABLE_BITS 6
+#define CODE_LENGTH_TREE_ARRAY_SIZE 128
+#define DISTANCE_TREE_ARRAY_SIZE 142
+#define LITERAL_LENGTH_TREE_ARRAY_SIZE 838
+#endif
+
+/*
+ * Tree data is shared between streams copied with 'inflatelib_copy' and is therefore reference counted. The count is
+ * stored in a header placed immediately before the table entries so that 'huffman_tree' does not grow; the decode loops
+ * only ever access 'data' and the header is only touched when trees are created, shared, rebuilt, or destroyed. Streams
+ * that share data may be used on different threads, so the count is updated atomically
+ */
+typedef struct huffman_table_header
+{
+    long ref_count;
+} huffman_table_header;
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define HUFFMAN_REF_LOAD(ptr) _InterlockedOr((ptr), 0)
+#define HUFFMAN_REF_INCREMENT(ptr) _InterlockedIncrement(ptr)
+#define HUFFMAN_REF_DECREMENT(ptr) _InterlockedDecrement(ptr)
+#else
+#define HUFFMAN_REF_LOAD(ptr) __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define HUFFMAN_REF_INCREMENT(ptr) __atomic_add_fetch((ptr), 1, __ATOMIC_RELAXED)
+#define HUFFMAN_REF_DECREMENT(ptr) __atomic_sub_fetch((ptr), 1, __ATOMIC_ACQ_REL)
+#endif
+
+#define HUFFMAN_TABLE_BYTES(dataSize) (sizeof(huffman_table_header) + sizeof(huffman_table_entry) * (dataSize))
+
+static inline huffman_table_header* huffman_table_get_header(const huffman_tree* tree)
+{
+    return (huffman_table_header*)tree->data - 1;
+}
+
+static huffman_table_entry* huffman_table_alloc(inflatelib_stream* stream, size_t dataSize)
+{
+    huffman_table_header* header =
+        (huffman_table_header*)stream->alloc(stream->user_data, HUFFMAN_TABLE_BYTES(dataSize), alignof(huffman_table_header));
+    if (!header)
+    {
+        return NULL;
+    }
+
+    header->ref_count = 1;
+    return (huffman_table_entry*)(header + 1);
+}
+
+static void huffman_table_release(huffman_tree* tree, inflatelib_stream* stream)
+{
+    huffman_table_header* header = huffman_table_get_header(tree);
+    if (HUFFMAN_REF_DECREMENT(&header->ref_count) == 0)
+    {
+        stream->free(stream->user_data, header, HUFFMAN_TABLE_BYTES(tree->data_size), alignof(huffman_table_header));
+    }
+}
 
 static inline uint16_t reverse_bits(uint16_t value, int bitCount);
 
@@ -65,12 +138,12 @@ int huffman_tree_init(huffman_tree* tree, inflatelib_stream* stream, size_t dict
 
     if (dictionarySize == LITERAL_TREE_MAX_ELEMENT_COUNT)
     {
-        tree->table_bits = 10;
+        tree->table_bits = LITERAL_LENGTH_TREE_TABLE_BITS;
         tree->data_size = LITERAL_LENGTH_TREE_ARRAY_SIZE;
     }
     else if (dictionarySize == DIST_TREE_MAX_ELEMENT_COUNT)
     {
-        tree->table_bits = 7;
+        tree->table_bits = DISTANCE_TREE_TABLE_BITS;
         tree->data_size = DISTANCE_TREE_ARRAY_SIZE;
     }
     else
@@ -81,18 +154,24 @@ int huffman_tree_init(huffman_tree* tree, inflatelib_stream* stream, size_t dict
 
     tree->table_mask = ((uint16_t)0x01 << tree->table_bits) - 1;
 
-    tree->data = INFLATELIB_ALLOC(stream, huffman_table_entry, tree->data_size);
+    tree->data = huffman_table_alloc(stream, tree->data_size);
     if (!tree->data)
     {
-        stream->error_msg = "Failed to allocate space for Huffman table";
-        errno = ENOMEM;
-        return INFLATELIB_ERROR_OOM;
+        return set_error(stream, INFLATELIB_ERRCODE_OUT_OF_MEMORY, HUFFMAN_TABLE_BYTES(tree->data_size), 0, 0);
     }
     /* NOTE: 'reset' should clear data in the table */
 
     return INFLATELIB_OK;
 }
 
+void huffman_tree_share(huffman_tree* dest, const huffman_tree* source)
+{
+    assert(source->data); /* Only initialized trees can be shared */
+
+    *dest = *source;
+    HUFFMAN_REF_INCREMENT(&huffman_table_get_header(source)->ref_count);
+}
+
 int huffman_tree_reset(huffman_tree* tree, inflatelib_stream* stream, const uint8_t* codeLengths, size_t codeLengthsSize)
 {
     uint16_t bitLengthCount[MAX_CODE_LENGTH + 1]; /* NOTE: +1 because we index by length (index 0 effectively "wasted") */
@@ -102,6 +181,21 @@ int huffman_tree_reset(huffman_tree* tree, inflatelib_stream* stream, const uint
     huffman_table_entry* nextTreeInsertPtr = treeBase;
     uint16_t nextTreeInsertIndex = 0;
 
+    /* Data shared with another stream must not be modified, so the tree gets new data of its own first. If the other
+     * stream releases its reference at the same time, the worst case is an unnecessary allocation */
+    if (HUFFMAN_REF_LOAD(&huffman_table_get_header(tree)->ref_count) != 1)
+    {
+        huffman_table_entry* data = huffman_table_alloc(stream, tree->data_size);
+        if (!data)
+        {
+            return set_error(stream, INFLATELIB_ERRCODE_OUT_OF_MEMORY, HUFFMAN_TABLE_BYTES(tree->data_size), 0, 0);
+        }
+
+        huffman_table_release(tree, stream);
+        tree->data = data;
+        treeBase = nextTreeInsertPtr = tree->data + ((size_t)0x01 << tree->table_bits);
+    }
+
     /* Zero out the lookup table. This ensures that data is listed as "invalid" by default */
     memset(tree->data, 0, ((size_t)0x01 << tree->table_bits) * sizeof(huffman_table_entry));
 
@@ -128,17 +222,7 @@ int huffman_tree_reset(huffman_tree* tree, inflatelib_stream* stream, const uint
         nextCode += bitLengthCount[i];
         if (nextCode > (0x01 << i))
         {
-            if (format_error_message(
-                    stream,
-                    "Too many symbols with code length %zu. %u symbols starting at 0x%X exceeds the specified number of bits",
-                    i,
-                    bitLengthCount[i],
-                    nextCodes[i]) < 0)
-            {
-                stream->error_msg = "Not all symbols can be represented using the specified number of bits";
-            }
-            errno = EINVAL;
-            return INFLATELIB_ERROR_DATA;
+            return set_error(stream, INFLATELIB_ERRCODE_TREE_OVERSUBSCRIBED, i, bitLengthCount[i], nextCodes[i]);
         }
     }
 
@@ -222,7 +306,7 @@ void huffman_tree_destroy(huffman_tree* tree, inflatelib_stream* stream)
 {
     if (tree->data)
     {
-        INFLATELIB_FREE(stream, huffman_table_entry, tree->data, tree->data_size);
+        huffman_table_release(tree, stream);
         tree->data = NULL;
         tree->data_size = 0;
     }
@@ -268,65 +352,10 @@ int huffman_tree_lookup(huffman_tree* tree, inflatelib_stream* stream, uint16_t*
     }
     /* Otherwise, error or the data fit in the table and we have enough bits in the input to know that's the "full" code */
 
-    if (tableEntry->code_length == 0)
-    {
-        /* Zero means unassigned; this is an error */
-        if (format_error_message(
-                stream,
-                "Input bit sequence 0x%.*zX is not a valid Huffman code for the encoded table",
-                (bits + 7) / 8,
-                input & ((0x01 << bits) - 1)) < 0)
-        {
-            stream->error_msg = "Input bit sequence is not a valid Huffman code for the encoded table";
-        }
-        errno = EINVAL;
-        return -1;
-    }
-
-    /* Success if we've gotten this far */
-    *symbol = tableEntry->symbol;
-    bitstream_consume_bits(bitstream, tableEntry->code_length);
-    return 1;
-}
-
-int huffman_tree_lookup_unchecked(huffman_tree* tree, inflatelib_stream* stream, uint16_t* symbol)
-{
-    bitstream* bitstream = &stream->internal->bitstream;
-    huffman_table_entry* tableEntry;
-    size_t input;
-
-    input = bitstream_peek_unchecked(bitstream);
-    tableEntry = &tree->data[input & tree->table_mask];
-
-    if (tableEntry->code_length > tree->table_bits)
-    {
-        /* This is a "pointer" inside the tree */
-        huffman_table_entry* tableBase = tree->data + ((size_t)0x01 << tree->table_bits);
-        size_t bitsRead = tree->table_bits;
-        size_t remainingInput = input >> tree->table_bits;
-
-        do
-        {
-            assert(bitsRead < 15); /* Largest code is 15 bits */
-
-            tableEntry = tableBase + (2 * (size_t)tableEntry->symbol) + (remainingInput & 0x01);
-            assert(tableEntry < (tree->data + tree->data_size)); /* Otherwise data in the table is corrupt */
-            ++bitsRead;
-            remainingInput >>= 1;
-        } while (tableEntry->code_length > bitsRead);
-
-        assert((tableEntry->code_length == bitsRead) || !tableEntry->code_length); /* Otherwise we wrote bad data or indexed something wrong */
-    }
-    /* Otherwise, error or the data fit in the table */
-
-    if (tableEntry->code_length == 0)
+    if (INFLATELIB_UNLIKELY(tableEntry->code_length == 0))
     {
         /* Zero means unassigned; this is an error */
-        if (format_error_message(stream, "Input bit sequence 0x%2X is not a valid Huffman code for the encoded table", input) < 0)
-        {
-            stream->error_msg = "Input bit sequence is not a valid Huffman code for the encoded table";
-        }
-        errno = EINVAL;
+        set_error(stream, INFLATELIB_ERRCODE_INVALID_CODE, input & ((0x01 << bits) - 1), bits, 0);
         return -1;
     }
 
@@ -67,28 +67,39 @@ extern "C"
          * to the current bit count required to get that far means that the node is a leaf node and 'symbol' is the
          * final value, whereas a value greater than the current bit count means that 'symbol' is another index into the
          * binary tree array. */
+#ifdef INFLATELIB_SMALL_FOOTPRINT
+        /* Small footprint builds pack each entry into 16 bits. Code lengths are at most 15 and symbols, as well as the
+         * pair indices into the binary tree array, are always less than 4096 */
+        uint16_t code_length : 4;
+        uint16_t symbol : 12;
+#else
         uint16_t code_length;
         uint16_t symbol;
+#endif
     } huffman_table_entry;
 
     typedef struct huffman_tree
     {
-        size_t table_bits;         /* Either 7 or 9; see huffman_tree.c for more details */
+        size_t table_bits;         /* Depends on the tree and build configuration; see huffman_tree.c for more details */
         size_t table_mask;         /* = (1 << table_bits) - 1 */
         size_t data_size;          /* For assertions & deallocation; it's mathematically impossible to read/write past the end */
         huffman_table_entry* data; /* See above for data layout */
     } huffman_tree;
 
-    /* The order of calls must follow: init, reset, reset, ..., reset, destroy */
+    /* The order of calls must follow: init (or share), reset, reset, ..., reset, destroy */
     int huffman_tree_init(huffman_tree* tree, struct inflatelib_stream* stream, size_t dictionarySize);
     int huffman_tree_reset(huffman_tree* tree, struct inflatelib_stream* stream, const uint8_t* codeLengths, size_t codeLengthsSize);
     void huffman_tree_destroy(huffman_tree* tree, struct inflatelib_stream* stream);
 
+    /* Initializes 'dest' to refer to the same data as 'source' without copying it. The data is reference counted and is
+     * copied on write: the next call to 'huffman_tree_reset' on either tree allocates new data for that tree if the data
+     * is still shared. The streams that own the two trees must use the same allocation functions */
+    void huffman_tree_share(huffman_tree* dest, const huffman_tree* source);
+
     /* Looks up a symbol from the table, returning -1 on failure (symbol does not exist), 0 if not enough input, and 1
-     * on success. The difference between these two functions is that the 'unchecked' function assumes there's enough
-     * bits in the input to read any given symbol. */
+     * on success. See 'huffman_tree_lookup_unchecked' in 'internal.h' for a version that assumes there's enough bits in
+     * the input to read any given symbol. */
     int huffman_tree_lookup(huffman_tree* tree, struct inflatelib_stream* stream, uint16_t* symbol);
-    int huffman_tree_lookup_unchecked(huffman_tree* tree, struct inflatelib_stream* stream, uint16_t* symbol);
 
 #ifdef __cplusplus
 }
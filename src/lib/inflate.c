@@ -7,13 +7,18 @@
  *    PARTICULAR PURPOSE AND NONINFRINGEMENT.
  */
 #include <assert.h>
-#include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "internal.h"
 
+/* See the comment on 'inflatelib_state'; this catches changes that would spread the fast path's working set out */
+static_assert(
+    (sizeof(void*) != 8) || (offsetof(inflatelib_state, window.storage) <= 128),
+    "State accessed per-symbol should fit in the first 128 bytes of 'inflatelib_state'");
+
 static void* inflatelib_default_alloc(void* unusedUserData, size_t bytes, size_t alignment)
 {
     void* result;
@@ -35,6 +40,24 @@ static void inflatelib_default_free(void* unusedUserData, void* ptr, size_t byte
     free(ptr);
 }
 
+static void update_output_threshold(inflatelib_state* state, uintmax_t inputBytes)
+{
+    uintmax_t threshold = UINTMAX_MAX;
+
+    if (state->limits.max_output)
+    {
+        threshold = state->limits.max_output;
+    }
+
+    /* NOTE: More input may be read before the threshold is next updated, which only makes this conservative */
+    if (state->limits.max_ratio && (inputBytes <= (threshold / state->limits.max_ratio)))
+    {
+        threshold = inputBytes * state->limits.max_ratio;
+    }
+
+    state->output_threshold = threshold;
+}
+
 int inflatelib_init(inflatelib_stream* stream)
 {
     int result;
@@ -79,6 +102,8 @@ int inflatelib_init(inflatelib_stream* stream)
     {
         bitstream_init(&state->bitstream);
         window_init(&state->window);
+        window_enable_mirror(&state->window); /* Falls back to the window's built-in storage on failure */
+        update_output_threshold(state, 0);
 
         state->ifstate = ifstate_init;
     }
@@ -110,6 +135,14 @@ int inflatelib_reset(inflatelib_stream* stream)
     // NOTE: The Huffman trees do not need to be reset as they are reset on demand as needed. If we've made it this far,
     // all of their internal state has been allocated, and that's the best that we can ask for
 
+    state->input_bytes = 0;
+    state->block_count = 0;
+    state->table_count = 0;
+#ifdef INFLATELIB_PHASE_TIMING
+    memset(&state->phase_timer, 0, sizeof(state->phase_timer));
+#endif
+    update_output_threshold(state, 0);
+
     state->ifstate = ifstate_init;
 
     return INFLATELIB_OK;
@@ -123,22 +156,10 @@ int inflatelib_destroy(inflatelib_stream* stream)
              long as the caller zero-initialized the pointer */
     if (state)
     {
-        if (state->error_msg_fmt)
-        {
-            if (stream->error_msg == state->error_msg_fmt)
-            {
-                /* Don't leave a dangling pointer, however also don't fully null out the error message in case the
-                   caller is depending on being able to read it. Realistically, this should never cause problems in
-                   practice as we should never need to format an error message AND destroy the stream in one op */
-                stream->error_msg = "Generic failure";
-            }
-
-            INFLATELIB_FREE(stream, char, state->error_msg_fmt, state->error_msg_len);
-        }
-
         huffman_tree_destroy(&state->code_length_tree, stream);
         huffman_tree_destroy(&state->literal_length_tree, stream);
         huffman_tree_destroy(&state->distance_tree, stream);
+        window_destroy(&state->window);
 
         INFLATELIB_FREE(stream, inflatelib_state, stream->internal, 1);
         stream->internal = NULL;
@@ -147,66 +168,369 @@ int inflatelib_destroy(inflatelib_stream* stream)
     return INFLATELIB_OK;
 }
 
-int format_error_message(inflatelib_stream* stream, const char* fmt, ...)
+int inflatelib_copy(inflatelib_stream* dest, const inflatelib_stream* source)
+{
+    inflatelib_state* sourceState = source->internal;
+    inflatelib_state* destState;
+
+    /* Start from a copy of the public members, which includes the allocation functions; the shared Huffman tables must
+     * be freed using the same functions that allocated them */
+    *dest = *source;
+    dest->internal = NULL;
+
+    if (sourceState == NULL)
+    {
+        dest->error_msg = "Internal state is null; ensure inflatelib_init has been called first";
+        errno = EINVAL;
+        return INFLATELIB_ERROR_ARG;
+    }
+
+    destState = INFLATELIB_ALLOC(dest, inflatelib_state, 1);
+    if (destState == NULL)
+    {
+        dest->error_msg = "Failed to allocate storage for internal state";
+        errno = ENOMEM;
+        return INFLATELIB_ERROR_OOM;
+    }
+
+    /* The state on either side of the window is plain data, other than the Huffman trees, which are fixed up below.
+     * The window is copied separately so that only the part of its buffer that holds valid data is copied */
+    memcpy(destState, sourceState, offsetof(inflatelib_state, window));
+    memcpy(&destState->ifstate, &sourceState->ifstate, sizeof(*destState) - offsetof(inflatelib_state, ifstate));
+    dest->internal = destState;
+
+    huffman_tree_share(&destState->code_length_tree, &sourceState->code_length_tree);
+    huffman_tree_share(&destState->literal_length_tree, &sourceState->literal_length_tree);
+    huffman_tree_share(&destState->distance_tree, &sourceState->distance_tree);
+
+    window_init(&destState->window);
+    window_enable_mirror(&destState->window); /* Falls back to the window's built-in storage on failure */
+    window_copy(&destState->window, &sourceState->window);
+
+    return INFLATELIB_OK;
+}
+
+int inflatelib_set_limits(inflatelib_stream* stream, const inflatelib_limits* limits)
 {
-    va_list args;
-    int bufferSize;
     inflatelib_state* state = stream->internal;
 
-    /* Before starting, clear out the previously allocated error message, if present */
-    if (state->error_msg_fmt)
+    if (state == NULL)
     {
-        if (stream->error_msg == state->error_msg_fmt)
-        {
-            stream->error_msg = NULL;
-        }
+        stream->error_msg = "Internal state is null; ensure inflatelib_init has been called first";
+        errno = EINVAL;
+        return INFLATELIB_ERROR_ARG;
+    }
+
+    if (limits)
+    {
+        state->limits = *limits;
+    }
+    else
+    {
+        memset(&state->limits, 0, sizeof(state->limits));
+    }
+
+    update_output_threshold(state, state->input_bytes);
+
+    return INFLATELIB_OK;
+}
+
+int inflatelib_set_call_budget(inflatelib_stream* stream, size_t maxOutput, size_t maxSymbols)
+{
+    inflatelib_state* state = stream->internal;
 
-        INFLATELIB_FREE(stream, char, state->error_msg_fmt, state->error_msg_len);
-        state->error_msg_fmt = NULL;
+    if (state == NULL)
+    {
+        stream->error_msg = "Internal state is null; ensure inflatelib_init has been called first";
+        errno = EINVAL;
+        return INFLATELIB_ERROR_ARG;
     }
 
-    va_start(args, fmt);
-    bufferSize = vsnprintf(NULL, 0, fmt, args);
-    va_end(args);
+    state->call_max_output = maxOutput;
+    state->call_max_symbols = maxSymbols;
+
+    return INFLATELIB_OK;
+}
+
+typedef struct error_desc
+{
+    int result;      /* The 'INFLATELIB_ERROR_*' value returned to the caller */
+    int err;         /* The value assigned to 'errno' */
+    const char* msg; /* Short, static message assigned to 'error_msg' */
+} error_desc;
+
+/* Indexed by the 'INFLATELIB_ERRCODE_*' values */
+static const error_desc error_descs[] = {
+    [INFLATELIB_ERRCODE_NONE] = {INFLATELIB_OK, 0, NULL},
+    [INFLATELIB_ERRCODE_OUT_OF_MEMORY] = {INFLATELIB_ERROR_OOM, ENOMEM, "Failed to allocate memory"},
+    [INFLATELIB_ERRCODE_MODE_MISMATCH] =
+        {INFLATELIB_ERROR_ARG,
+         EINVAL,
+         "inflatelib_stream is initialized for a different algorithm. First call inflatelib_reset to reset the stream"},
+    [INFLATELIB_ERRCODE_INVALID_BLOCK_TYPE] = {INFLATELIB_ERROR_DATA, EINVAL, "Unexpected block type"},
+    [INFLATELIB_ERRCODE_BLOCK_LEN_MISMATCH] =
+        {INFLATELIB_ERROR_DATA, EINVAL, "Uncompressed block length does not match its encoded one's complement value"},
+    [INFLATELIB_ERRCODE_TREE_OVERSUBSCRIBED] =
+        {INFLATELIB_ERROR_DATA, EINVAL, "Not all symbols can be represented using the specified number of bits"},
+    [INFLATELIB_ERRCODE_REPEAT_AT_START] =
+        {INFLATELIB_ERROR_DATA, EINVAL, "Code length repeat code encountered at beginning of data"},
+    [INFLATELIB_ERRCODE_REPEAT_OVERFLOW] =
+        {INFLATELIB_ERROR_DATA, EINVAL, "Code length repeat code specifies more repetitions than codes remain"},
+    [INFLATELIB_ERRCODE_ZERO_REPEAT_OVERFLOW] =
+        {INFLATELIB_ERROR_DATA, EINVAL, "Zero repeat code specifies more repetitions than codes remain"},
+    [INFLATELIB_ERRCODE_INVALID_CODE] =
+        {INFLATELIB_ERROR_DATA, EINVAL, "Input bit sequence is not a valid Huffman code for the encoded table"},
+    [INFLATELIB_ERRCODE_INVALID_SYMBOL] = {INFLATELIB_ERROR_DATA, EINVAL, "Invalid symbol from literal/length tree"},
+    [INFLATELIB_ERRCODE_INVALID_DISTANCE_CODE] = {INFLATELIB_ERROR_DATA, EINVAL, "Distance code is not valid in Deflate"},
+    [INFLATELIB_ERRCODE_DISTANCE_TOO_FAR] =
+        {INFLATELIB_ERROR_DATA, EINVAL, "Compressed block has a distance which exceeds the size of the window"},
+    [INFLATELIB_ERRCODE_OUTPUT_LIMIT] = {INFLATELIB_ERROR_LIMIT, ERANGE, "Inflated data exceeds the maximum output size"},
+    [INFLATELIB_ERRCODE_RATIO_LIMIT] = {INFLATELIB_ERROR_LIMIT, ERANGE, "Inflated data exceeds the maximum compression ratio"},
+    [INFLATELIB_ERRCODE_BLOCK_LIMIT] = {INFLATELIB_ERROR_LIMIT, ERANGE, "Input exceeds the maximum number of blocks"},
+    [INFLATELIB_ERRCODE_TABLE_LIMIT] =
+        {INFLATELIB_ERROR_LIMIT, ERANGE, "Input exceeds the maximum number of blocks with dynamic Huffman codes"},
+    [INFLATELIB_ERRCODE_UNSUPPORTED_MODE] = {INFLATELIB_ERROR_ARG, ENOTSUP, "Deflate64 is not supported by this build of inflatelib"},
+};
+
+INFLATELIB_COLD int set_error(inflatelib_stream* stream, int code, uintmax_t value0, uintmax_t value1, uintmax_t value2)
+{
+    inflatelib_state* state = stream->internal;
+    const error_desc* desc;
+
+    assert((code > INFLATELIB_ERRCODE_NONE) && ((size_t)code < inflatelib_arraysize(error_descs)));
+    desc = &error_descs[code];
+
+    state->error.code = code;
+    state->error.bit_offset = stream->total_in * 8; /* 'do_inflate' refines this once it knows how much input was read */
+    state->error.values[0] = value0;
+    state->error.values[1] = value1;
+    state->error.values[2] = value2;
+
+    stream->error_msg = desc->msg;
+    errno = desc->err;
+    return desc->result;
+}
+
+int inflatelib_get_error(const inflatelib_stream* stream, inflatelib_error_info* info)
+{
+    const inflatelib_state* state = stream->internal;
 
-    if (bufferSize < 0)
+    if (state == NULL)
     {
-        stream->error_msg = "Failed to format error message";
+        /* NOTE: Can't record an error here since there's no internal state to record it in */
+        errno = EINVAL;
         return INFLATELIB_ERROR_ARG;
     }
 
-    ++bufferSize; /* Return value does not include space for null terminator */
+    *info = state->error;
+    return INFLATELIB_OK;
+}
+
+int inflatelib_format_error(const inflatelib_stream* stream, char* buffer, size_t bufferSize)
+{
+    const inflatelib_state* state = stream->internal;
+    const uintmax_t* values;
+
+    if ((state == NULL) || (state->error.code == INFLATELIB_ERRCODE_NONE))
+    {
+        return snprintf(buffer, bufferSize, "%s", stream->error_msg ? stream->error_msg : "");
+    }
+
+    values = state->error.values;
+    switch (state->error.code)
+    {
+    case INFLATELIB_ERRCODE_OUT_OF_MEMORY:
+        return snprintf(buffer, bufferSize, "Failed to allocate %ju bytes", values[0]);
+
+    case INFLATELIB_ERRCODE_MODE_MISMATCH:
+        return snprintf(
+            buffer,
+            bufferSize,
+            "inflatelib_stream is initialized for %s and cannot be called with %s encoded data. First call inflatelib_reset to reset the stream",
+            (values[0] == INFLATELIB_MODE_DEFLATE64) ? "Deflate64" : "Deflate",
+            (values[0] == INFLATELIB_MODE_DEFLATE64) ? "Deflate" : "Deflate64");
+
+    case INFLATELIB_ERRCODE_INVALID_BLOCK_TYPE:
+        return snprintf(buffer, bufferSize, "Unexpected block type '%ju'", values[0]);
+
+    case INFLATELIB_ERRCODE_BLOCK_LEN_MISMATCH:
+        return snprintf(
+            buffer,
+            bufferSize,
+            "Uncompressed block length (%04jX) does not match its encoded one's complement value (%04jX)",
+            values[0],
+            values[1]);
+
+    case INFLATELIB_ERRCODE_TREE_OVERSUBSCRIBED:
+        return snprintf(
+            buffer,
+            bufferSize,
+            "Too many symbols with code length %ju. %ju symbols starting at 0x%jX exceeds the specified number of bits",
+            values[0],
+            values[1],
+            values[2]);
+
+    case INFLATELIB_ERRCODE_REPEAT_AT_START:
+        return snprintf(buffer, bufferSize, "Code length repeat code encountered at beginning of data");
+
+    case INFLATELIB_ERRCODE_REPEAT_OVERFLOW:
+        return snprintf(
+            buffer,
+            bufferSize,
+            "Code length repeat code specifies %ju repetitions, but only %ju codes remain",
+            values[0],
+            values[1]);
+
+    case INFLATELIB_ERRCODE_ZERO_REPEAT_OVERFLOW:
+        return snprintf(
+            buffer, bufferSize, "Zero repeat code specifies %ju repetitions, but only %ju codes remain", values[0], values[1]);
+
+    case INFLATELIB_ERRCODE_INVALID_CODE:
+        /* NOTE: values[1] is the number of valid bits in values[0], which are printed as (at least) one digit per byte */
+        return snprintf(
+            buffer,
+            bufferSize,
+            "Input bit sequence 0x%.*jX is not a valid Huffman code for the encoded table",
+            (int)((values[1] + 7) / 8),
+            values[0]);
+
+    case INFLATELIB_ERRCODE_INVALID_SYMBOL:
+        return snprintf(buffer, bufferSize, "Invalid symbol '%ju' from literal/length tree", values[0]);
+
+    case INFLATELIB_ERRCODE_INVALID_DISTANCE_CODE:
+        return snprintf(buffer, bufferSize, "Distance code %ju is not valid in Deflate", values[0]);
+
+    case INFLATELIB_ERRCODE_DISTANCE_TOO_FAR:
+        return snprintf(
+            buffer,
+            bufferSize,
+            "Compressed block has a distance '%ju' which exceeds the size of the window (%ju bytes)",
+            values[0],
+            values[1]);
+
+    case INFLATELIB_ERRCODE_OUTPUT_LIMIT:
+        return snprintf(
+            buffer,
+            bufferSize,
+            "Inflated data would be at least %ju bytes, which exceeds the limit of %ju bytes",
+            values[1],
+            values[0]);
+
+    case INFLATELIB_ERRCODE_RATIO_LIMIT:
+        return snprintf(
+            buffer,
+            bufferSize,
+            "Inflating %ju bytes of input would produce at least %ju bytes, which exceeds the maximum ratio of %ju",
+            values[2],
+            values[1],
+            values[0]);
+
+    case INFLATELIB_ERRCODE_BLOCK_LIMIT:
+        return snprintf(buffer, bufferSize, "Input exceeds the maximum of %ju blocks", values[0]);
+
+    case INFLATELIB_ERRCODE_TABLE_LIMIT:
+        return snprintf(buffer, bufferSize, "Input exceeds the maximum of %ju blocks with dynamic Huffman codes", values[0]);
+
+    case INFLATELIB_ERRCODE_UNSUPPORTED_MODE:
+        return snprintf(
+            buffer,
+            bufferSize,
+            "%s is not supported by this build of inflatelib",
+            (values[0] == INFLATELIB_MODE_DEFLATE64) ? "Deflate64" : "Deflate");
+
+    default:
+        assert(0); /* Unknown error code */
+        return snprintf(buffer, bufferSize, "%s", stream->error_msg ? stream->error_msg : "");
+    }
+}
+
+const char* inflatelib_error_message(inflatelib_stream* stream)
+{
+    inflatelib_state* state = stream->internal;
 
-    state->error_msg_fmt = INFLATELIB_ALLOC(stream, char, bufferSize);
-    if (!state->error_msg_fmt)
+    if ((state == NULL) || (state->error.code == INFLATELIB_ERRCODE_NONE))
     {
-        stream->error_msg = "Failed to allocate space for error message";
-        errno = ENOMEM;
-        return INFLATELIB_ERROR_OOM;
+        return stream->error_msg;
+    }
+
+    if (inflatelib_format_error(stream, state->error_msg_buffer, sizeof(state->error_msg_buffer)) < 0)
+    {
+        return stream->error_msg;
     }
-    state->error_msg_len = bufferSize;
 
-    va_start(args, fmt);
-    bufferSize = vsnprintf(state->error_msg_fmt, bufferSize, fmt, args);
-    va_end(args);
+    return state->error_msg_buffer;
+}
+
+int inflatelib_get_phase_times(const inflatelib_stream* stream, inflatelib_phase_times* times)
+{
+#ifdef INFLATELIB_PHASE_TIMING
+    const inflatelib_state* state = stream->internal;
 
-    if (bufferSize < 0)
+    if (state == NULL)
     {
-        stream->error_msg = "Failed to format error message";
+        errno = EINVAL;
         return INFLATELIB_ERROR_ARG;
     }
 
-    stream->error_msg = state->error_msg_fmt;
+#ifdef INFLATELIB_PHASE_TIMING_TSC
+    times->unit = INFLATELIB_TICKS_CYCLES;
+#else
+    times->unit = INFLATELIB_TICKS_NANOSECONDS;
+#endif
+    memcpy(times->ticks, state->phase_timer.ticks, sizeof(times->ticks));
     return INFLATELIB_OK;
+#else
+    /* NOTE: Nothing is recorded, so there's nothing to report */
+    (void)stream;
+    (void)times;
+    errno = EINVAL;
+    return INFLATELIB_ERROR_ARG;
+#endif
+}
+
+/* Wrappers for the functions that implement the 'INFLATELIB_PHASE_MATCH_COPY', 'INFLATELIB_PHASE_OUTPUT_COPY', and
+ * 'INFLATELIB_PHASE_TABLE_BUILD' phases, which attribute the time spent in them to that phase. Other than that, these are
+ * identical to the functions that they call */
+static inline size_t inflater_copy_output(inflatelib_state* state, uint8_t* output, size_t outputSize)
+{
+    size_t result;
+
+    INFLATELIB_TIME_ENTER(state, INFLATELIB_PHASE_OUTPUT_COPY);
+    result = window_copy_output(&state->window, output, outputSize);
+    INFLATELIB_TIME_LEAVE(state);
+    return result;
+}
+
+static inline int inflater_copy_length_distance(inflatelib_state* state, size_t distance, size_t length)
+{
+    int result;
+
+    INFLATELIB_TIME_ENTER(state, INFLATELIB_PHASE_MATCH_COPY);
+    result = window_copy_length_distance(&state->window, distance, length);
+    INFLATELIB_TIME_LEAVE(state);
+    return result;
+}
+
+static int inflater_build_tree(huffman_tree* tree, inflatelib_stream* stream, const uint8_t* codeLengths, size_t codeLengthsSize)
+{
+    int result;
+
+    INFLATELIB_TIME_ENTER(stream->internal, INFLATELIB_PHASE_TABLE_BUILD);
+    result = huffman_tree_reset(tree, stream, codeLengths, codeLengthsSize);
+    INFLATELIB_TIME_LEAVE(stream->internal);
+    return result;
 }
 
 static int inflater_process_data(inflatelib_stream* stream);
+static int inflater_begin_block(inflatelib_stream* stream, uint16_t btype);
+INFLATELIB_COLD static int inflater_check_output_limits(inflatelib_stream* stream, size_t length);
 static int inflater_read_uncompressed(inflatelib_stream* stream);
-static void inflater_init_static_tables(inflatelib_stream* stream);
+static int inflater_init_static_tables(inflatelib_stream* stream);
 static int inflater_read_dynamic_header(inflatelib_stream* stream);
 static int inflater_read_compressed(inflatelib_stream* stream);
 
-static int do_inflate(inflatelib_stream* stream)
+/* Inflates from 'next_in' to 'next_out'. This is the unit of work that all of the public inflate functions are built on */
+static int inflate_step(inflatelib_stream* stream)
 {
     int result;
     inflatelib_state* state = stream->internal;
@@ -220,7 +544,9 @@ static int do_inflate(inflatelib_stream* stream)
      * however we should have reset the buffer to avoid the dangling pointer */
     bitstream_set_data(&state->bitstream, initialInData, initialInSize);
 
+    INFLATELIB_TIME_START(state);
     result = inflater_process_data(stream);
+    INFLATELIB_TIME_STOP(state);
 
     /* When making it this far, we've potentially read/written data that we want to report, even on failure */
     stream->total_out += initialOutSize - stream->avail_out;
@@ -232,48 +558,115 @@ static int do_inflate(inflatelib_stream* stream)
     assert(finalInSize <= initialInSize);
 
     stream->total_in += stream->avail_in - finalInSize;
+    state->input_bytes += stream->avail_in - finalInSize;
     stream->next_in = finalInData;
     stream->avail_in = finalInSize;
 
+    if (result < 0)
+    {
+        /* Bits still sitting in the buffer were read from the input, but were not needed to detect the error */
+        state->error.bit_offset = stream->total_in * 8 - state->bitstream.bits_in_buffer;
+    }
+
     return result;
 }
 
-int inflatelib_inflate(inflatelib_stream* stream)
+static int do_inflate(inflatelib_stream* stream)
 {
+    int result;
     inflatelib_state* state = stream->internal;
+    size_t withheldOutSize = 0;
 
-    if (state == NULL)
+    /* Apply the per-call caps. Hiding part of the output buffer caps the output without any additional checks */
+    if (state->call_max_output && (stream->avail_out > state->call_max_output))
     {
-        stream->error_msg = "Internal state is null; ensure inflatelib_init has been called first";
-        errno = EINVAL;
-        return INFLATELIB_ERROR_ARG;
+        withheldOutSize = stream->avail_out - state->call_max_output;
+        stream->avail_out = state->call_max_output;
     }
+    state->symbol_budget = state->call_max_symbols ? state->call_max_symbols : SIZE_MAX;
 
-    /* Ensure that we're not mixing inflate/inflate64 calls */
-    switch (state->ifstate)
+    result = inflate_step(stream);
+
+    stream->avail_out += withheldOutSize;
+    return result;
+}
+
+static int do_inflatev(
+    inflatelib_stream* stream,
+    inflatelib_input_buffer* inputs,
+    size_t inputCount,
+    inflatelib_output_buffer* outputs,
+    size_t outputCount)
+{
+    int result;
+    inflatelib_state* state = stream->internal;
+    size_t inputIndex = 0, outputIndex = 0, inSize, outSize;
+    size_t outputBudget = state->call_max_output ? state->call_max_output : SIZE_MAX;
+
+    /* NOTE: The per-call caps apply to the call as a whole, not to each buffer */
+    state->symbol_budget = state->call_max_symbols ? state->call_max_symbols : SIZE_MAX;
+
+    while (1)
     {
-    case ifstate_init:
-        /* Not yet initialized */
-        state->mode = INFLATELIB_MODE_DEFLATE;
-        state->ifstate = ifstate_reading_bfinal;
-        break;
+        /* Skip past buffers that have been fully consumed (or were empty to begin with) */
+        while ((inputIndex < inputCount) && (inputs[inputIndex].size == 0))
+        {
+            ++inputIndex;
+        }
+        while ((outputIndex < outputCount) && (outputs[outputIndex].size == 0))
+        {
+            ++outputIndex;
+        }
 
-    default:
-        /* Already initialized */
-        if (state->mode != INFLATELIB_MODE_DEFLATE)
+        /* NOTE: Even once we run out of input or output buffers, it may still be possible to make progress, e.g. if the
+         * window has unconsumed data or the final block's end is sitting in the bitstream's buffer */
+        inSize = (inputIndex < inputCount) ? inputs[inputIndex].size : 0;
+        outSize = (outputIndex < outputCount) ? outputs[outputIndex].size : 0;
+        outSize = (outSize > outputBudget) ? outputBudget : outSize;
+
+        stream->next_in = inSize ? inputs[inputIndex].data : NULL;
+        stream->avail_in = inSize;
+        stream->next_out = outSize ? outputs[outputIndex].data : NULL;
+        stream->avail_out = outSize;
+
+        result = inflate_step(stream);
+
+        /* Update the caller's buffers to reflect what was consumed/written */
+        if (inSize)
         {
-            stream->error_msg =
-                "inflatelib_stream is initialized for Deflate64 and cannot be called with Deflate encoded data. First call inflatelib_reset to reset the stream";
-            errno = EINVAL;
-            return INFLATELIB_ERROR_ARG;
+            inputs[inputIndex].data = stream->next_in;
+            inputs[inputIndex].size = stream->avail_in;
+        }
+        if (outSize)
+        {
+            outputs[outputIndex].data = stream->next_out;
+            outputs[outputIndex].size -= outSize - stream->avail_out;
+            outputBudget -= outSize - stream->avail_out;
+        }
+
+        if (result != INFLATELIB_OK)
+        {
+            break; /* EOF or error */
+        }
+
+        /* If no progress was made, we either need more input or more output space, neither of which we have */
+        if ((inSize == stream->avail_in) && (outSize == stream->avail_out))
+        {
+            break;
+        }
+
+        if (!state->symbol_budget || !outputBudget)
+        {
+            break; /* Reached the per-call cap */
         }
-        break;
     }
 
-    return do_inflate(stream);
+    return result;
 }
 
-int inflatelib_inflate64(inflatelib_stream* stream)
+/* Verifies the stream is initialized and that it's not being used to inflate data using a different algorithm than
+ * the one the stream was started with (e.g. mixing inflate/inflate64 calls) */
+static int begin_inflate(inflatelib_stream* stream, uint8_t mode)
 {
     inflatelib_state* state = stream->internal;
 
@@ -284,30 +677,88 @@ int inflatelib_inflate64(inflatelib_stream* stream)
         return INFLATELIB_ERROR_ARG;
     }
 
-    /* Ensure that we're not mixing inflate/inflate64 calls */
+#ifdef INFLATELIB_SMALL_FOOTPRINT
+    /* The window is only large enough for Deflate */
+    if (mode == INFLATELIB_MODE_DEFLATE64)
+    {
+        return set_error(stream, INFLATELIB_ERRCODE_UNSUPPORTED_MODE, mode, 0, 0);
+    }
+#endif
+
     switch (state->ifstate)
     {
     case ifstate_init:
         /* Not yet initialized */
-        state->mode = INFLATELIB_MODE_DEFLATE64;
+        state->mode = mode;
         state->ifstate = ifstate_reading_bfinal;
         break;
 
     default:
         /* Already initialized */
-        if (state->mode != INFLATELIB_MODE_DEFLATE64)
+        if (state->mode != mode)
         {
-            stream->error_msg =
-                "inflatelib_stream is initialized for Deflate and cannot be called with Deflate64 encoded data. First call inflatelib_reset to reset the stream";
-            errno = EINVAL;
-            return INFLATELIB_ERROR_ARG;
+            return set_error(stream, INFLATELIB_ERRCODE_MODE_MISMATCH, state->mode, 0, 0);
         }
         break;
     }
 
+    return INFLATELIB_OK;
+}
+
+int inflatelib_inflate(inflatelib_stream* stream)
+{
+    int result = begin_inflate(stream, INFLATELIB_MODE_DEFLATE);
+    if (result < 0)
+    {
+        return result; /* Error message, etc. already set */
+    }
+
+    return do_inflate(stream);
+}
+
+int inflatelib_inflate64(inflatelib_stream* stream)
+{
+    int result = begin_inflate(stream, INFLATELIB_MODE_DEFLATE64);
+    if (result < 0)
+    {
+        return result; /* Error message, etc. already set */
+    }
+
     return do_inflate(stream);
 }
 
+int inflatelib_inflatev(
+    inflatelib_stream* stream,
+    inflatelib_input_buffer* inputs,
+    size_t inputCount,
+    inflatelib_output_buffer* outputs,
+    size_t outputCount)
+{
+    int result = begin_inflate(stream, INFLATELIB_MODE_DEFLATE);
+    if (result < 0)
+    {
+        return result; /* Error message, etc. already set */
+    }
+
+    return do_inflatev(stream, inputs, inputCount, outputs, outputCount);
+}
+
+int inflatelib_inflatev64(
+    inflatelib_stream* stream,
+    inflatelib_input_buffer* inputs,
+    size_t inputCount,
+    inflatelib_output_buffer* outputs,
+    size_t outputCount)
+{
+    int result = begin_inflate(stream, INFLATELIB_MODE_DEFLATE64);
+    if (result < 0)
+    {
+        return result; /* Error message, etc. already set */
+    }
+
+    return do_inflatev(stream, inputs, inputCount, outputs, outputCount);
+}
+
 static int inflater_process_data(inflatelib_stream* stream)
 {
     inflatelib_state* state = stream->internal;
@@ -335,32 +786,11 @@ static int inflater_process_data(inflatelib_stream* stream)
                 state->need_more_data = 1;
                 return INFLATELIB_OK; /* Not enough input data */
             }
-            else if (data > 2)
-            {
-                if (format_error_message(stream, "Unexpected block type '%u'", data) < 0)
-                {
-                    stream->error_msg = "Unexpected block type";
-                }
-                errno = EINVAL;
-                return INFLATELIB_ERROR_DATA;
-            }
 
-            state->btype = (block_type)data;
-            switch (state->btype)
+            result = inflater_begin_block(stream, data);
+            if (result < 0)
             {
-            case btype_uncompressed:
-                bitstream_byte_align(&state->bitstream);
-                state->ifstate = ifstate_reading_uncompressed_block_len;
-                break;
-
-            case btype_static:
-                inflater_init_static_tables(stream);
-                state->ifstate = ifstate_reading_literal_length_code;
-                break;
-
-            case btype_dynamic:
-                state->ifstate = ifstate_reading_num_lit_codes;
-                break;
+                return result; /* Error message, etc. already set */
             }
             break; /* Handled below */
 
@@ -386,8 +816,10 @@ static int inflater_process_data(inflatelib_stream* stream)
             if (state->ifstate < ifstate_reading_literal_length_code)
             {
                 /* We have not fully initialized the dynamic Huffman tables yet */
+                INFLATELIB_TIME_ENTER(state, INFLATELIB_PHASE_DYNAMIC_HEADER);
                 result = inflater_read_dynamic_header(stream);
-                if (result < 0)
+                INFLATELIB_TIME_LEAVE(state);
+                if (INFLATELIB_UNLIKELY(result < 0))
                 {
                     return result; /* Error string, etc. already set */
                 }
@@ -403,7 +835,10 @@ static int inflater_process_data(inflatelib_stream* stream)
             result = inflater_read_compressed(stream);
             break;
         }
-    } while ((result == INFLATELIB_OK) && (state->ifstate == ifstate_reading_bfinal));
+        /* The fast path moves on to the next block by itself, and stops at the start of blocks that it hands back to us */
+    } while ((result == INFLATELIB_OK) && state->symbol_budget && !state->need_more_data &&
+             ((state->ifstate == ifstate_reading_bfinal) || (state->ifstate == ifstate_reading_uncompressed_block_len) ||
+              (state->ifstate == ifstate_reading_num_lit_codes)));
 
     if ((result == INFLATELIB_OK) && (state->ifstate == ifstate_eof))
     {
@@ -413,8 +848,64 @@ static int inflater_process_data(inflatelib_stream* stream)
     return result;
 }
 
+/* Called once BFINAL and BTYPE have been read to set up for reading the block */
+static int inflater_begin_block(inflatelib_stream* stream, uint16_t btype)
+{
+    int result;
+    inflatelib_state* state = stream->internal;
+
+    if (btype > 2)
+    {
+        return set_error(stream, INFLATELIB_ERRCODE_INVALID_BLOCK_TYPE, btype, 0, 0);
+    }
+
+    ++state->block_count;
+    if (state->limits.max_blocks && (state->block_count > state->limits.max_blocks))
+    {
+        return set_error(stream, INFLATELIB_ERRCODE_BLOCK_LIMIT, state->limits.max_blocks, 0, 0);
+    }
+
+    state->btype = (block_type)btype;
+    switch (state->btype)
+    {
+    case btype_uncompressed:
+        bitstream_byte_align(&state->bitstream);
+        state->ifstate = ifstate_reading_uncompressed_block_len;
+        break;
+
+    case btype_static:
+        /* Consecutive static blocks are common, e.g. when data is flushed often, so only build the tables if the last
+         * compressed block was not static as well */
+        if (!state->static_tables)
+        {
+            result = inflater_init_static_tables(stream);
+            if (result < 0)
+            {
+                return result; /* Error message, etc. already set */
+            }
+            state->static_tables = 1;
+        }
+
+        state->ifstate = ifstate_reading_literal_length_code;
+        break;
+
+    case btype_dynamic:
+        ++state->table_count;
+        if (state->limits.max_tables && (state->table_count > state->limits.max_tables))
+        {
+            return set_error(stream, INFLATELIB_ERRCODE_TABLE_LIMIT, state->limits.max_tables, 0, 0);
+        }
+
+        state->ifstate = ifstate_reading_num_lit_codes;
+        break;
+    }
+
+    return INFLATELIB_OK;
+}
+
 static int inflater_read_uncompressed(inflatelib_stream* stream)
 {
+    int result;
     inflatelib_state* state = stream->internal;
     size_t bytesCopied;
     uint16_t data;
@@ -441,18 +932,18 @@ static int inflater_read_uncompressed(inflatelib_stream* stream)
             return INFLATELIB_OK; /* Not enough data */
         }
 
-        if (state->data.uncompressed.block_len != (uint16_t)~data)
+        if ((uint16_t)(state->data.uncompressed.block_len ^ data) != 0xFFFF)
+        {
+            return set_error(stream, INFLATELIB_ERRCODE_BLOCK_LEN_MISMATCH, state->data.uncompressed.block_len, data, 0);
+        }
+
+        if ((state->window.total_bytes + state->data.uncompressed.block_len) > state->output_threshold)
         {
-            if (format_error_message(
-                    stream,
-                    "Uncompressed block length (%04X) does not match its encoded one's complement value (%04X)",
-                    state->data.uncompressed.block_len,
-                    data) < 0)
+            result = inflater_check_output_limits(stream, state->data.uncompressed.block_len);
+            if (result < 0)
             {
-                stream->error_msg = "Uncompressed block length does not match its encoded one's complement value";
+                return result; /* Error message, etc. already set */
             }
-            errno = EINVAL;
-            return INFLATELIB_ERROR_DATA;
         }
 
         state->ifstate = ifstate_reading_uncompressed_data;
@@ -463,7 +954,7 @@ static int inflater_read_uncompressed(inflatelib_stream* stream)
         state->data.uncompressed.block_len -=
             (uint16_t)window_copy_bytes(&state->window, &state->bitstream, state->data.uncompressed.block_len);
 
-        bytesCopied = window_copy_output(&state->window, (uint8_t*)stream->next_out, stream->avail_out);
+        bytesCopied = inflater_copy_output(state, (uint8_t*)stream->next_out, stream->avail_out);
         stream->next_out = (uint8_t*)stream->next_out + bytesCopied;
         stream->avail_out -= bytesCopied;
 
@@ -482,14 +973,12 @@ static int inflater_read_uncompressed(inflatelib_stream* stream)
     return INFLATELIB_OK;
 }
 
-static void inflater_init_static_tables(inflatelib_stream* stream)
+static int inflater_init_static_tables(inflatelib_stream* stream)
 {
     int result;
     uint8_t buffer[LITERAL_TREE_MAX_ELEMENT_COUNT];
     inflatelib_state* state = stream->internal;
 
-    (void)result; /* Only used for asserts */
-
     /* TODO: We can encode both of these tables in static data; it's not clear yet if/how much that might improve things
      * and all indications are that this code path is insignificant enough to warrent such optimizations */
 
@@ -499,14 +988,18 @@ static void inflater_init_static_tables(inflatelib_stream* stream)
     memset(buffer + 256, 7, 280 - 256); /* 256-279: 7 bits long */
     memset(buffer + 280, 8, 288 - 280); /* 280-287: 8 bits long */
 
-    result = huffman_tree_reset(&state->literal_length_tree, stream, buffer, 288);
-    assert(result == 0); /* We control the inputs; this can never fail */
+    /* NOTE: We control the inputs, so this can only fail if the tree's data is shared with a copy of the stream and
+     * allocating new data fails */
+    result = inflater_build_tree(&state->literal_length_tree, stream, buffer, 288);
+    if (result < 0)
+    {
+        return result;
+    }
 
     /* The distance code lengths are also specified by RFC 1951, section 3.2.6 as being 5 bits each */
     memset(buffer, 5, 32);
 
-    result = huffman_tree_reset(&state->distance_tree, stream, buffer, 32);
-    assert(result == 0); /* We control the inputs; this can never fail */
+    return inflater_build_tree(&state->distance_tree, stream, buffer, 32);
 }
 
 /* The order that the code length alphabe's code lengths are specified in, as per RFC 1951, section 3.2.7 */
@@ -576,7 +1069,7 @@ static int inflater_read_dynamic_header(inflatelib_stream* stream)
             ++state->data.dynamic_codes.loop_counter;
         }
 
-        result = huffman_tree_reset(&state->code_length_tree, stream, state->data.dynamic_codes.code_lengths, CODE_LENGTH_TREE_ELEMENT_COUNT);
+        result = inflater_build_tree(&state->code_length_tree, stream, state->data.dynamic_codes.code_lengths, CODE_LENGTH_TREE_ELEMENT_COUNT);
         if (result < 0)
         {
             state->ifstate = ifstate_reading_code_len_codes; /* TODO: Error state? */
@@ -628,25 +1121,15 @@ static int inflater_read_dynamic_header(inflatelib_stream* stream)
 
                 if (state->data.dynamic_codes.loop_counter == 0)
                 {
-                    stream->error_msg = "Code length repeat code encountered at beginning of data";
-                    errno = EINVAL;
-                    return INFLATELIB_ERROR_DATA;
+                    return set_error(stream, INFLATELIB_ERRCODE_REPEAT_AT_START, 0, 0, 0);
                 }
                 prevCode = state->data.dynamic_codes.code_lengths[state->data.dynamic_codes.loop_counter - 1];
 
                 data += 3;
                 if ((state->data.dynamic_codes.loop_counter + data) > codeArraySize)
                 {
-                    if (format_error_message(
-                            stream,
-                            "Code length repeat code specifies %u repetitions, but only %u codes remain",
-                            data,
-                            codeArraySize - state->data.dynamic_codes.loop_counter) < 0)
-                    {
-                        stream->error_msg = "Code length repeat code specifies more repetitions than codes remain";
-                    }
-                    errno = EINVAL;
-                    return INFLATELIB_ERROR_DATA;
+                    return set_error(
+                        stream, INFLATELIB_ERRCODE_REPEAT_OVERFLOW, data, codeArraySize - state->data.dynamic_codes.loop_counter, 0);
                 }
 
                 for (uint16_t i = 0; i < data; ++i)
@@ -684,16 +1167,8 @@ static int inflater_read_dynamic_header(inflatelib_stream* stream)
                 data += repeatBase;
                 if ((state->data.dynamic_codes.loop_counter + data) > codeArraySize)
                 {
-                    if (format_error_message(
-                            stream,
-                            "Zero repeat code specifies %u repetitions, but only %u codes remain",
-                            data,
-                            codeArraySize - state->data.dynamic_codes.loop_counter) < 0)
-                    {
-                        stream->error_msg = "Zero repeat code specifies more repetitions than codes remain";
-                    }
-                    errno = EINVAL;
-                    return INFLATELIB_ERROR_DATA;
+                    return set_error(
+                        stream, INFLATELIB_ERRCODE_ZERO_REPEAT_OVERFLOW, data, codeArraySize - state->data.dynamic_codes.loop_counter, 0);
                 }
 
                 for (uint16_t i = 0; i < data; ++i)
@@ -707,14 +1182,15 @@ static int inflater_read_dynamic_header(inflatelib_stream* stream)
         }
 
         /* If we break out of the loop, we're done reading the code lengths arrays and are ready to init & move on */
-        result = huffman_tree_reset(
+        state->static_tables = 0;
+        result = inflater_build_tree(
             &state->literal_length_tree, stream, state->data.dynamic_codes.code_lengths, state->data.dynamic_codes.literal_length_code_count);
         if (result < 0)
         {
             return result; /* Error message, etc. already set */
         }
 
-        result = huffman_tree_reset(
+        result = inflater_build_tree(
             &state->distance_tree,
             stream,
             state->data.dynamic_codes.code_lengths + state->data.dynamic_codes.literal_length_code_count,
@@ -790,8 +1266,41 @@ static const inflater_tables* const inflate_tables[] = {&deflate_tables, &deflat
  * Deflate64: 15 bit length + 16 extra bits + 15 bit distance + 14 extra bits = 60 bits = 8 bytes (rounded up) */
 static const size_t max_compressed_op_size[] = {6, 8};
 
-/* static int inflater_read_compressed_fast(inflatelib_stream* stream); */
+#ifdef INFLATELIB_TWO_PHASE_DECODE
+/* The fast path is split into two phases: symbols are first decoded into a small token buffer, which is then executed in
+ * a separate pass that performs the writes and copies. See 'inflater_read_compressed_two_phase' */
+static int inflater_read_compressed_two_phase(inflatelib_stream* stream);
+#define inflater_read_compressed_fast inflater_read_compressed_two_phase
+#else
 static int inflater_read_compressed_fast(inflatelib_stream* stream);
+#endif
+
+/* Called when writing 'length' more bytes to the window would cross 'output_threshold'. This either fails or updates the
+ * threshold using the amount of input read so far, which keeps the check on the hot path to a single comparison */
+INFLATELIB_COLD static int inflater_check_output_limits(inflatelib_stream* stream, size_t length)
+{
+    inflatelib_state* state = stream->internal;
+    uintmax_t outputBytes = state->window.total_bytes + length;
+
+    /* NOTE: 'stream->avail_in' does not get updated until the call completes, so the difference with the bitstream's
+     * remaining length is the input read so far during this call */
+    uintmax_t inputBytes = state->input_bytes + (stream->avail_in - state->bitstream.length);
+
+    if (state->limits.max_output && (outputBytes > state->limits.max_output))
+    {
+        return set_error(stream, INFLATELIB_ERRCODE_OUTPUT_LIMIT, state->limits.max_output, outputBytes, 0);
+    }
+
+    if (state->limits.max_ratio && (inputBytes <= (UINTMAX_MAX / state->limits.max_ratio)) &&
+        (outputBytes > (inputBytes * state->limits.max_ratio)))
+    {
+        return set_error(stream, INFLATELIB_ERRCODE_RATIO_LIMIT, state->limits.max_ratio, outputBytes, inputBytes);
+    }
+
+    update_output_threshold(state, inputBytes);
+
+    return INFLATELIB_OK;
+}
 
 static int inflater_read_compressed(inflatelib_stream* stream)
 {
@@ -805,32 +1314,47 @@ static int inflater_read_compressed(inflatelib_stream* stream)
     const size_t maxOpSize = max_compressed_op_size[state->mode];
 
     /* On entry, try and write any data we previously wrote to the window, but did not consume */
-    bytesCopied = window_copy_output(&state->window, out, outSize);
+    bytesCopied = inflater_copy_output(state, out, outSize);
     out += bytesCopied;
     outSize -= bytesCopied;
 
     while (keepGoing)
     {
-        switch (state->ifstate)
+        /* The fast path can start between symbols or part of the way through a copy */
+        if (((state->ifstate == ifstate_reading_literal_length_code) ||
+             (state->ifstate == ifstate_copying_length_distance_from_window)) &&
+            (state->bitstream.length >= maxOpSize) && outSize && state->symbol_budget)
         {
-        case ifstate_reading_literal_length_code:
-            /* The fast path requires that we start in 'ifstate_reading_literal_length_code' */
-            if ((state->bitstream.length >= maxOpSize) && outSize)
+            stream->next_out = out;
+            stream->avail_out = outSize;
+            INFLATELIB_TIME_ENTER(state, INFLATELIB_PHASE_FAST_DECODE);
+            result = inflater_read_compressed_fast(stream);
+            INFLATELIB_TIME_LEAVE(state);
+            out = stream->next_out;
+            outSize = stream->avail_out;
+
+            if (result < INFLATELIB_OK)
             {
-                stream->next_out = out;
-                stream->avail_out = outSize;
-                result = inflater_read_compressed_fast(stream);
-                out = stream->next_out;
-                outSize = stream->avail_out;
+                break; /* Error message, etc. already set */
+            }
 
-                if (result < INFLATELIB_OK)
-                {
-                    keepGoing = 0; /* Error message, etc. already set */
-                    break;
-                }
+            /* NOTE: 'inflater_read_compressed_fast' moves on to later blocks by itself, so it may exit at the start of a
+             * block, or at the end of the stream, that 'inflater_process_data' needs to take care of. Otherwise, it's
+             * possible for it to exit in a state other than 'ifstate_reading_literal_length_code', so need to
+             * re-evaluate */
+            if ((state->ifstate < ifstate_reading_literal_length_code) || (state->ifstate == ifstate_eof))
+            {
+                break;
+            }
+            continue;
+        }
 
-                /* NOTE: It's possible for 'inflater_read_compressed_fast' to exit in a state other than
-                 * 'ifstate_reading_literal_length_code', so need to re-evaluate */
+        switch (state->ifstate)
+        {
+        case ifstate_reading_literal_length_code:
+            if (!state->symbol_budget)
+            {
+                keepGoing = 0; /* Reached the per-call cap; the next call picks up from here */
                 break;
             }
 
@@ -842,13 +1366,15 @@ static int inflater_read_compressed(inflatelib_stream* stream)
                 keepGoing = 0; /* Not enough data in the input */
                 break;
             }
-            else if (opResult < 0)
+            else if (INFLATELIB_UNLIKELY(opResult < 0))
             {
                 /* Error in the data; NOTE: We've already set the error message */
                 keepGoing = 0;
                 result = INFLATELIB_ERROR_DATA;
                 break;
             }
+
+            --state->symbol_budget;
             /* Fallthrough */
 
         case ifstate_decoding_literal_length_code:
@@ -857,7 +1383,7 @@ static int inflater_read_compressed(inflatelib_stream* stream)
                 if (!window_write_byte(&state->window, (uint8_t)state->data.compressed.symbol))
                 {
                     /* Not enough data in the window; try and read some data to free up space */
-                    bytesCopied = window_copy_output(&state->window, out, outSize);
+                    bytesCopied = inflater_copy_output(state, out, outSize);
                     if (!bytesCopied)
                     {
                         keepGoing = 0; /* Not enough data in the output */
@@ -881,20 +1407,15 @@ static int inflater_read_compressed(inflatelib_stream* stream)
                 state->ifstate = ifstate_copying_output_from_window;
                 break;
             }
-            else if (state->data.compressed.symbol > 285)
+            else if (INFLATELIB_UNLIKELY(state->data.compressed.symbol > 285))
             {
                 /* NOTE: HLIT is 5 bits, which means that there are at most 288 code lengths specified for the
                  * literal/length tree (257 + 31). This means that in theory, someone could author a block where symbols
                  * can go from 0 to 287. If we move this error "up" and error out if HLIT is greater than 29, we can
                  * eliminate this error check, which could potentially give us some perf wins at the cost of potentially
                  * rejecting otherwise valid inputs. */
-                if (format_error_message(stream, "Invalid symbol '%u' from literal/length tree", state->data.compressed.symbol) < 0)
-                {
-                    stream->error_msg = "Invalid symbol from literal/length tree";
-                }
                 keepGoing = 0;
-                errno = EINVAL;
-                result = INFLATELIB_ERROR_DATA;
+                result = set_error(stream, INFLATELIB_ERRCODE_INVALID_SYMBOL, state->data.compressed.symbol, 0, 0);
                 break;
             }
 
@@ -930,7 +1451,7 @@ static int inflater_read_compressed(inflatelib_stream* stream)
                 state->ifstate = ifstate_reading_distance_code;
                 break;
             }
-            else if (opResult < 0)
+            else if (INFLATELIB_UNLIKELY(opResult < 0))
             {
                 /* Error in the data; NOTE: We've already set the error message */
                 keepGoing = 0;
@@ -943,15 +1464,10 @@ static int inflater_read_compressed(inflatelib_stream* stream)
             state->data.compressed.block_distance = tables->distances[symbol].base;
             state->data.compressed.extra_bits = tables->distances[symbol].extra_bits;
 
-            if (!state->data.compressed.block_distance)
+            if (INFLATELIB_UNLIKELY(!state->data.compressed.block_distance))
             {
                 keepGoing = 0;
-                if (format_error_message(stream, "Distance code %u is not valid in Deflate", symbol) < 0)
-                {
-                    stream->error_msg = "Distance code is not valid in Deflate";
-                }
-                errno = EINVAL;
-                result = INFLATELIB_ERROR_DATA;
+                result = set_error(stream, INFLATELIB_ERRCODE_INVALID_DISTANCE_CODE, symbol, 0, 0);
                 break;
             }
             /* Fallthrough */
@@ -969,32 +1485,34 @@ static int inflater_read_compressed(inflatelib_stream* stream)
 
                 state->data.compressed.block_distance += symbol;
             }
+
+            if (INFLATELIB_UNLIKELY((state->window.total_bytes + state->data.compressed.block_length) > state->output_threshold))
+            {
+                result = inflater_check_output_limits(stream, state->data.compressed.block_length);
+                if (result < 0)
+                {
+                    keepGoing = 0; /* Error message, etc. already set */
+                    break;
+                }
+            }
             /* Fallthrough */
 
             /* NOTE: It's not guaranteed we have enough space available in 'out' to write all data, hence the need for a
              * dedicated state for copying the data from the window */
         case ifstate_copying_length_distance_from_window:
             opResult =
-                window_copy_length_distance(&state->window, state->data.compressed.block_distance, state->data.compressed.block_length);
-            if (opResult < 0)
+                inflater_copy_length_distance(state, state->data.compressed.block_distance, state->data.compressed.block_length);
+            if (INFLATELIB_UNLIKELY(opResult < 0))
             {
                 keepGoing = 0;
-                if (format_error_message(
-                        stream,
-                        "Compressed block has a distance '%u' which exceeds the size of the window (%llu bytes)",
-                        state->data.compressed.block_distance,
-                        state->window.total_bytes) < 0)
-                {
-                    stream->error_msg = "Compressed block has a distance which exceeds the size of the window";
-                }
-                errno = EINVAL;
-                result = INFLATELIB_ERROR_DATA;
+                result = set_error(
+                    stream, INFLATELIB_ERRCODE_DISTANCE_TOO_FAR, state->data.compressed.block_distance, state->window.total_bytes, 0);
                 break;
             }
 
             state->data.compressed.block_length -= (uint32_t)opResult;
 
-            bytesCopied = window_copy_output(&state->window, out, outSize);
+            bytesCopied = inflater_copy_output(state, out, outSize);
             out += bytesCopied;
             outSize -= bytesCopied;
 
@@ -1020,8 +1538,19 @@ static int inflater_read_compressed(inflatelib_stream* stream)
             break;
 
         case ifstate_copying_output_from_window:
+            /* Literals are not checked against the limits as they are written, so account for them at the end of the block */
+            if (INFLATELIB_UNLIKELY(state->window.total_bytes > state->output_threshold))
+            {
+                result = inflater_check_output_limits(stream, 0);
+                if (result < 0)
+                {
+                    keepGoing = 0; /* Error message, etc. already set */
+                    break;
+                }
+            }
+
             /* This state means we've read all input; we just need to finish copying data to the output */
-            bytesCopied = window_copy_output(&state->window, out, outSize);
+            bytesCopied = inflater_copy_output(state, out, outSize);
             out += bytesCopied;
             outSize -= bytesCopied;
             if (state->window.unconsumed_bytes == 0)
@@ -1041,7 +1570,7 @@ static int inflater_read_compressed(inflatelib_stream* stream)
     }
 
     /* Copy as much data from the window as we can before returning */
-    bytesCopied = window_copy_output(&state->window, out, outSize);
+    bytesCopied = inflater_copy_output(state, out, outSize);
     out += bytesCopied;
     outSize -= bytesCopied;
 
@@ -1052,24 +1581,388 @@ static int inflater_read_compressed(inflatelib_stream* stream)
     return result;
 }
 
+/* Finishes copying a length/distance pair that did not fit in the output buffer during an earlier call. On success, the
+ * state is left in 'ifstate_copying_length_distance_from_window' if the output buffer fills up again before the copy
+ * completes and 'ifstate_reading_literal_length_code' otherwise. Output is written to 'next_out' */
+static int inflater_resume_copy_fast(inflatelib_stream* stream)
+{
+    inflatelib_state* state = stream->internal;
+    size_t bytesCopied;
+    int opResult;
+
+    assert(state->ifstate == ifstate_copying_length_distance_from_window);
+    while (1)
+    {
+        opResult =
+            inflater_copy_length_distance(state, state->data.compressed.block_distance, state->data.compressed.block_length);
+        if (INFLATELIB_UNLIKELY(opResult < 0))
+        {
+            return set_error(
+                stream, INFLATELIB_ERRCODE_DISTANCE_TOO_FAR, state->data.compressed.block_distance, state->window.total_bytes, 0);
+        }
+        state->data.compressed.block_length -= (uint32_t)opResult;
+
+        bytesCopied = inflater_copy_output(state, (uint8_t*)stream->next_out, stream->avail_out);
+        stream->next_out = (uint8_t*)stream->next_out + bytesCopied;
+        stream->avail_out -= bytesCopied;
+
+        if (state->window.unconsumed_bytes != 0)
+        {
+            return INFLATELIB_OK; /* Ran out of space in the output buffer */
+        }
+        else if (state->data.compressed.block_length == 0)
+        {
+            break;
+        }
+    }
+
+    state->ifstate = ifstate_reading_literal_length_code;
+    return INFLATELIB_OK;
+}
+
+/* Called by the fast path after decoding the end of block symbol to move on to the next block without going through
+ * 'inflater_process_data' and the checked bitstream functions. Static blocks are set up so that the fast path can
+ * continue with them directly, and stored blocks are copied in their entirety while there is enough input and output
+ * space. Otherwise, this stops at the point where the slow path needs to take over: at the start of a dynamic block's
+ * header, part of the way through a stored block, or when there is not enough input to read the next block header.
+ * Output is written to 'next_out' */
+static int inflater_next_block_fast(inflatelib_stream* stream)
+{
+    int result;
+    inflatelib_state* state = stream->internal;
+    size_t bytesCopied;
+    uint16_t data, complement;
+
+    /* NOTE: The fast path only ever exits a block having written all of its data to the output */
+    assert(state->window.unconsumed_bytes == 0);
+
+    while (1)
+    {
+        /* Literals are not checked against the limits as they are written, so account for them at the end of the block */
+        if (INFLATELIB_UNLIKELY(state->window.total_bytes > state->output_threshold))
+        {
+            result = inflater_check_output_limits(stream, 0);
+            if (result < 0)
+            {
+                return result; /* Error message, etc. already set */
+            }
+        }
+
+        if (state->bfinal)
+        {
+            state->ifstate = ifstate_eof;
+            return INFLATELIB_OK;
+        }
+
+        /* The fast path ensures there is enough input to read the header after the end of a compressed block, however
+         * a stored block may have consumed nearly all of the input */
+        state->ifstate = ifstate_reading_bfinal;
+        if (state->bitstream.length < 2)
+        {
+            return INFLATELIB_OK;
+        }
+
+        data = bitstream_read_bits_unchecked(&state->bitstream, 3);
+        state->bfinal = (uint8_t)(data & 0x01);
+        result = inflater_begin_block(stream, data >> 1);
+        if ((result < 0) || (state->btype != btype_uncompressed))
+        {
+            return result; /* Either an error, or the block is ready to be decoded */
+        }
+
+        /* Stored block. Both lengths are read with at most two buffer fills */
+        if (state->bitstream.length < 4)
+        {
+            return INFLATELIB_OK;
+        }
+
+        data = bitstream_read_bits_unchecked(&state->bitstream, 16);
+        complement = bitstream_read_bits_unchecked(&state->bitstream, 16);
+        if ((uint16_t)(data ^ complement) != 0xFFFF)
+        {
+            return set_error(stream, INFLATELIB_ERRCODE_BLOCK_LEN_MISMATCH, data, complement, 0);
+        }
+
+        if ((state->window.total_bytes + data) > state->output_threshold)
+        {
+            result = inflater_check_output_limits(stream, data);
+            if (result < 0)
+            {
+                return result; /* Error message, etc. already set */
+            }
+        }
+
+        state->data.uncompressed.block_len = data;
+        state->ifstate = ifstate_reading_uncompressed_data;
+        while (1)
+        {
+            /* NOTE: Both these function calls are safe to call with sizes of zero */
+            state->data.uncompressed.block_len -=
+                (uint16_t)window_copy_bytes(&state->window, &state->bitstream, state->data.uncompressed.block_len);
+
+            bytesCopied = inflater_copy_output(state, (uint8_t*)stream->next_out, stream->avail_out);
+            stream->next_out = (uint8_t*)stream->next_out + bytesCopied;
+            stream->avail_out -= bytesCopied;
+
+            if (state->window.unconsumed_bytes != 0)
+            {
+                return INFLATELIB_OK; /* Ran out of space in the output buffer */
+            }
+            else if (state->data.uncompressed.block_len == 0)
+            {
+                break; /* On to the next block */
+            }
+            else if ((state->bitstream.length == 0) && (state->bitstream.bits_in_buffer == 0))
+            {
+                return INFLATELIB_OK; /* Ran out of input */
+            }
+        }
+    }
+}
+
+#ifdef INFLATELIB_TWO_PHASE_DECODE
+/* Symbols decoded by the first phase of 'inflater_read_compressed_two_phase'. A distance of zero indicates a literal,
+ * whose value is stored in 'length' */
+typedef struct inflater_token
+{
+    uint32_t length;
+    uint32_t distance;
+} inflater_token;
+
+/* Small enough to comfortably fit in the L1 cache alongside the Huffman tables */
+#define INFLATER_TOKEN_BUFFER_SIZE 256
+
+static int inflater_read_compressed_two_phase(inflatelib_stream* stream)
+{
+    int result = INFLATELIB_OK;
+    inflatelib_state* state = stream->internal;
+    uint8_t* out = (uint8_t*)stream->next_out;
+    size_t bytesCopied, outSize = stream->avail_out;
+    size_t extraBits, symbolBudget = state->symbol_budget;
+    size_t tokenCount, decodedOutput;
+    uint16_t symbol;
+    uint32_t blockLength, blockDistance;
+    int opResult, decodeResult, endOfBlock = 0;
+    const inflater_tables* tables = inflate_tables[state->mode];
+    const size_t maxOpSize = max_compressed_op_size[state->mode];
+    inflater_token tokens[INFLATER_TOKEN_BUFFER_SIZE];
+
+    if (state->ifstate == ifstate_copying_length_distance_from_window)
+    {
+        result = inflater_resume_copy_fast(stream);
+        out = stream->next_out;
+        outSize = stream->avail_out;
+        if ((result < 0) || (state->ifstate != ifstate_reading_literal_length_code))
+        {
+            return result; /* Either an error, or we ran out of space in the output buffer */
+        }
+    }
+
+    assert(state->ifstate == ifstate_reading_literal_length_code);
+    while ((result == INFLATELIB_OK) && !endOfBlock && (state->bitstream.length >= maxOpSize) && outSize && symbolBudget)
+    {
+        /* Phase 1: Decode symbols into the token buffer. This loop only consumes input so that the dependent table
+         * lookups are not interleaved with the copies. We stop once the decoded tokens would fill the output buffer; only
+         * the last token is allowed to produce more output than there is space for, which the second phase handles the
+         * same way as the single-pass fast path */
+        tokenCount = 0;
+        decodedOutput = 0;
+        decodeResult = INFLATELIB_OK;
+        while ((tokenCount < INFLATER_TOKEN_BUFFER_SIZE) && (decodedOutput < outSize) &&
+               (state->bitstream.length >= maxOpSize) && symbolBudget)
+        {
+            --symbolBudget;
+            opResult = huffman_tree_lookup_unchecked(&state->literal_length_tree, stream, &symbol);
+            if (INFLATELIB_UNLIKELY(opResult < 0))
+            {
+                /* Error in the data; NOTE: We've already set the error message */
+                decodeResult = INFLATELIB_ERROR_DATA;
+                break;
+            }
+            assert(opResult != 0); /* Impossible to return 0 */
+
+            if (symbol < 256) /* Literal */
+            {
+                tokens[tokenCount].length = symbol;
+                tokens[tokenCount++].distance = 0;
+                ++decodedOutput;
+                continue;
+            }
+            else if (symbol == 256) /* End of block */
+            {
+                endOfBlock = 1;
+                break;
+            }
+            else if (INFLATELIB_UNLIKELY(symbol > 285))
+            {
+                decodeResult = set_error(stream, INFLATELIB_ERRCODE_INVALID_SYMBOL, symbol, 0, 0);
+                break;
+            }
+
+            /* Otherwise, 'symbol' references a length */
+            symbol -= 257;
+            assert(symbol < inflatelib_arraysize(tables->lengths)); /* Shouldn't have passed check above */
+            blockLength = tables->lengths[symbol].base;
+            extraBits = tables->lengths[symbol].extra_bits;
+
+            if (extraBits > 0)
+            {
+                blockLength += bitstream_read_bits_unchecked(&state->bitstream, extraBits);
+            }
+
+            opResult = huffman_tree_lookup_unchecked(&state->distance_tree, stream, &symbol);
+            if (INFLATELIB_UNLIKELY(opResult < 0))
+            {
+                /* Error in the data; NOTE: We've already set the error message */
+                decodeResult = INFLATELIB_ERROR_DATA;
+                break;
+            }
+            assert(opResult != 0); /* Impossible to return 0 */
+
+            assert(symbol < inflatelib_arraysize(tables->distances));
+            blockDistance = tables->distances[symbol].base;
+            extraBits = tables->distances[symbol].extra_bits;
+
+            if (INFLATELIB_UNLIKELY(!blockDistance))
+            {
+                decodeResult = set_error(stream, INFLATELIB_ERRCODE_INVALID_DISTANCE_CODE, symbol, 0, 0);
+                break;
+            }
+
+            if (extraBits > 0)
+            {
+                blockDistance += bitstream_read_bits_unchecked(&state->bitstream, extraBits);
+            }
+
+            tokens[tokenCount].length = blockLength;
+            tokens[tokenCount++].distance = blockDistance;
+            decodedOutput += blockLength;
+        }
+
+        /* Phase 2: Execute the tokens. Any tokens decoded before an error in the first phase are still executed so that
+         * the output matches what the single-pass fast path would produce */
+        for (size_t i = 0; i < tokenCount; ++i)
+        {
+            blockLength = tokens[i].length;
+            blockDistance = tokens[i].distance;
+
+            if (!blockDistance)
+            {
+                window_write_byte_consume(&state->window, (uint8_t)blockLength);
+                *out++ = (uint8_t)blockLength;
+                --outSize;
+                continue;
+            }
+
+            if (INFLATELIB_UNLIKELY((state->window.total_bytes + blockLength) > state->output_threshold))
+            {
+                result = inflater_check_output_limits(stream, blockLength);
+                if (result < 0)
+                {
+                    break; /* Error message, etc. already set */
+                }
+            }
+
+            /* NOTE: In Deflate64, the longest possible length is greater than the window size, in which case we need to
+             * drain the window before the rest of the match can be copied */
+            while (1)
+            {
+                opResult = inflater_copy_length_distance(state, blockDistance, blockLength);
+                if (INFLATELIB_UNLIKELY(opResult < 0))
+                {
+                    result = set_error(stream, INFLATELIB_ERRCODE_DISTANCE_TOO_FAR, blockDistance, state->window.total_bytes, 0);
+                    break;
+                }
+                blockLength -= (uint32_t)opResult;
+
+                bytesCopied = inflater_copy_output(state, out, outSize);
+                out += bytesCopied;
+                outSize -= bytesCopied;
+
+                if (state->window.unconsumed_bytes != 0)
+                {
+                    /* Ran out of space in the output buffer; let the slow path take care of the rest */
+                    assert(outSize == 0);
+                    assert(i == (tokenCount - 1)); /* Only the last token may exceed the output size */
+                    state->data.compressed.block_length = blockLength;
+                    state->data.compressed.block_distance = blockDistance;
+                    state->ifstate = ifstate_copying_length_distance_from_window;
+                    break;
+                }
+                else if (blockLength == 0)
+                {
+                    break;
+                }
+            }
+
+            if ((result < 0) || (state->ifstate != ifstate_reading_literal_length_code))
+            {
+                break;
+            }
+        }
+
+        if (result == INFLATELIB_OK)
+        {
+            result = decodeResult;
+        }
+
+        if ((result == INFLATELIB_OK) && endOfBlock && (state->ifstate == ifstate_reading_literal_length_code))
+        {
+            /* NOTE: The end of block symbol is at most 15 bits, so there's still enough input to read the next header */
+            stream->next_out = out;
+            stream->avail_out = outSize;
+            result = inflater_next_block_fast(stream);
+            out = stream->next_out;
+            outSize = stream->avail_out;
+
+            /* Static blocks can continue to be decoded here */
+            endOfBlock = 0;
+        }
+
+        if (state->ifstate != ifstate_reading_literal_length_code)
+        {
+            break;
+        }
+    }
+
+    /* Update the output buffers to reflect what we wrote */
+    stream->next_out = out;
+    stream->avail_out = outSize;
+    state->symbol_budget = symbolBudget;
+
+    return result;
+}
+#else
 static int inflater_read_compressed_fast(inflatelib_stream* stream)
 {
     int result = INFLATELIB_OK;
     inflatelib_state* state = stream->internal;
     uint8_t* out = (uint8_t*)stream->next_out;
     size_t bytesCopied, outSize = stream->avail_out;
-    size_t extraBits;
+    size_t extraBits, symbolBudget = state->symbol_budget;
     uint16_t symbol;
     uint32_t blockLength, blockDistance;
     int opResult;
     const inflater_tables* tables = inflate_tables[state->mode];
     const size_t maxOpSize = max_compressed_op_size[state->mode];
 
+    if (state->ifstate == ifstate_copying_length_distance_from_window)
+    {
+        result = inflater_resume_copy_fast(stream);
+        out = stream->next_out;
+        outSize = stream->avail_out;
+        if ((result < 0) || (state->ifstate != ifstate_reading_literal_length_code))
+        {
+            return result; /* Either an error, or we ran out of space in the output buffer */
+        }
+    }
+
     assert(state->ifstate == ifstate_reading_literal_length_code);
-    while ((state->bitstream.length >= maxOpSize) && outSize)
+    while ((state->bitstream.length >= maxOpSize) && outSize && symbolBudget)
     {
+        --symbolBudget;
         opResult = huffman_tree_lookup_unchecked(&state->literal_length_tree, stream, &symbol);
-        if (opResult < 0)
+        if (INFLATELIB_UNLIKELY(opResult < 0))
         {
             /* Error in the data; NOTE: We've already set the error message */
             result = INFLATELIB_ERROR_DATA;
@@ -1088,13 +1981,22 @@ static int inflater_read_compressed_fast(inflatelib_stream* stream)
         }
         else if (symbol == 256) /* End of block */
         {
-            /* Let the slow path take care of copying data */
-            /* NOTE: We should only be in this state if we've already read all data from the window, however this will
-             * correctly take care of transitioning to EOF state etc. */
-            state->ifstate = ifstate_copying_output_from_window;
-            break;
+            /* NOTE: The end of block symbol is at most 15 bits, so there's still enough input to read the next header */
+            stream->next_out = out;
+            stream->avail_out = outSize;
+            result = inflater_next_block_fast(stream);
+            out = stream->next_out;
+            outSize = stream->avail_out;
+
+            if ((result < 0) || (state->ifstate != ifstate_reading_literal_length_code))
+            {
+                break; /* Error, end of the stream, or a block that the slow path needs to take care of */
+            }
+
+            /* Otherwise, this is a static block that we can continue decoding */
+            continue;
         }
-        else if (symbol > 285)
+        else if (INFLATELIB_UNLIKELY(symbol > 285))
         {
             /* NOTE: HLIT is 5 bits, which means that there are at most 288 code lengths specified for the
              * literal/length tree (257 + 31). This means that in theory, someone could author a block where symbols can
@@ -1102,12 +2004,7 @@ static int inflater_read_compressed_fast(inflatelib_stream* stream)
              * this error check, which could potentially give us some perf wins at the cost of potentially rejecting
              * otherwise valid inputs. */
             /* NOTE: From experimentation, the benefit is very minor - slightly over a 1% speed up */
-            if (format_error_message(stream, "Invalid symbol '%u' from literal/length tree", symbol) < 0)
-            {
-                stream->error_msg = "Invalid symbol from literal/length tree";
-            }
-            errno = EINVAL;
-            result = INFLATELIB_ERROR_DATA;
+            result = set_error(stream, INFLATELIB_ERRCODE_INVALID_SYMBOL, symbol, 0, 0);
             break;
         }
 
@@ -1124,7 +2021,7 @@ static int inflater_read_compressed_fast(inflatelib_stream* stream)
 
         /* Now we need to read a distance */
         opResult = huffman_tree_lookup_unchecked(&state->distance_tree, stream, &symbol);
-        if (opResult < 0)
+        if (INFLATELIB_UNLIKELY(opResult < 0))
         {
             /* Error in the data; NOTE: We've already set the error message */
             result = INFLATELIB_ERROR_DATA;
@@ -1137,14 +2034,9 @@ static int inflater_read_compressed_fast(inflatelib_stream* stream)
         blockDistance = tables->distances[symbol].base;
         extraBits = tables->distances[symbol].extra_bits;
 
-        if (!blockDistance)
+        if (INFLATELIB_UNLIKELY(!blockDistance))
         {
-            if (format_error_message(stream, "Distance code %u is not valid in Deflate", symbol) < 0)
-            {
-                stream->error_msg = "Distance code is not valid in Deflate";
-            }
-            errno = EINVAL;
-            result = INFLATELIB_ERROR_DATA;
+            result = set_error(stream, INFLATELIB_ERRCODE_INVALID_DISTANCE_CODE, symbol, 0, 0);
             break;
         }
 
@@ -1153,27 +2045,27 @@ static int inflater_read_compressed_fast(inflatelib_stream* stream)
             blockDistance += bitstream_read_bits_unchecked(&state->bitstream, extraBits);
         }
 
+        if (INFLATELIB_UNLIKELY((state->window.total_bytes + blockLength) > state->output_threshold))
+        {
+            result = inflater_check_output_limits(stream, blockLength);
+            if (result < 0)
+            {
+                break; /* Error message, etc. already set */
+            }
+        }
+
         /* NOTE: In Deflate64, the longest possible length is greater than the window size by two bytes, meaning we may
          * not be able to copy a full length/distance with a single copy call. This is assumed to be unlikely and we
          * optimize for the case where a single copy can copy all bytes */
-        opResult = window_copy_length_distance(&state->window, blockDistance, blockLength);
+        opResult = inflater_copy_length_distance(state, blockDistance, blockLength);
 
-        if (opResult < 0)
+        if (INFLATELIB_UNLIKELY(opResult < 0))
         {
-            if (format_error_message(
-                    stream,
-                    "Compressed block has a distance '%u' which exceeds the size of the window (%llu bytes)",
-                    blockDistance,
-                    state->window.total_bytes) < 0)
-            {
-                stream->error_msg = "Compressed block has a distance which exceeds the size of the window";
-            }
-            errno = EINVAL;
-            result = INFLATELIB_ERROR_DATA;
+            result = set_error(stream, INFLATELIB_ERRCODE_DISTANCE_TOO_FAR, blockDistance, state->window.total_bytes, 0);
             break;
         }
 
-        bytesCopied = window_copy_output(&state->window, out, outSize);
+        bytesCopied = inflater_copy_output(state, out, outSize);
         out += bytesCopied;
         outSize -= bytesCopied;
 
@@ -1194,6 +2086,8 @@ static int inflater_read_compressed_fast(inflatelib_stream* stream)
     /* Update the output buffers to reflect what we wrote */
     stream->next_out = out;
     stream->avail_out = outSize;
+    state->symbol_budget = symbolBudget;
 
     return result;
 }
+#endif
@@ -0,0 +1,21 @@
+/*
+ *    Copyright (c) Microsoft. All rights reserved.
+ *    This code is licensed under the MIT License.
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF
+ *    ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+ *    TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ *    PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ */
+
+/*
+ * Root of the amalgamated build of the library, used when INFLATELIB_AMALGAMATED is enabled. 'amalgamate.cmake' replaces
+ * each of the includes below, and the internal headers they include, with the file's contents to produce a single
+ * source file. Compiling all sources as a single translation unit lets the compiler inline the window and Huffman
+ * routines into the decode loop without relying on LTO. 'window.c' must come first since it defines '_GNU_SOURCE' before
+ * any system headers are included.
+ */
+#include "window.c"
+
+#include "bitstream.c"
+#include "huffman_tree.c"
+#include "inflate.c"
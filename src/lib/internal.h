@@ -18,8 +18,50 @@
 #include "huffman_tree.h"
 #include "window.h"
 
+#ifdef INFLATELIB_PHASE_TIMING
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define INFLATELIB_PHASE_TIMING_TSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define INFLATELIB_PHASE_TIMING_TSC
+#else
+#include <time.h>
+#endif
+#endif
+
 #define inflatelib_arraysize(arr) (sizeof(arr) / sizeof(*arr))
 
+/* Branch hints for the decode loops. Error checks are marked unlikely so that the compiler keeps the error handling out of
+ * the straight-line code */
+#ifdef __has_builtin
+#if __has_builtin(__builtin_expect)
+#define INFLATELIB_LIKELY(expr) __builtin_expect(!!(expr), 1)
+#define INFLATELIB_UNLIKELY(expr) __builtin_expect(!!(expr), 0)
+#endif
+#endif
+
+#ifndef INFLATELIB_LIKELY
+#define INFLATELIB_LIKELY(expr) (expr)
+#define INFLATELIB_UNLIKELY(expr) (expr)
+#endif
+
+/* Marks functions that are only called on error or other rare paths. These are never inlined into their callers and get
+ * placed away from the hot code */
+#ifdef __has_attribute
+#if __has_attribute(cold) && __has_attribute(noinline)
+#define INFLATELIB_COLD __attribute__((cold, noinline))
+#endif
+#endif
+
+#ifndef INFLATELIB_COLD
+#ifdef _MSC_VER
+#define INFLATELIB_COLD __declspec(noinline)
+#else
+#define INFLATELIB_COLD
+#endif
+#endif
+
 typedef enum block_type
 {
     /* NOTE: Values must be kept identical to how they appear in the format */
@@ -63,34 +105,120 @@ typedef enum inflate_state
     ifstate_eof,
 } inflate_state;
 
+#ifdef INFLATELIB_PHASE_TIMING
+/* Phases can be entered from within other phases, e.g. a table build from the fast path or from a dynamic header read
+ * by the slow path. This is the deepest that they nest */
+#define PHASE_TIMER_MAX_DEPTH 4
+
+/* Accumulates the time spent in each 'INFLATELIB_PHASE_*'. Time is charged to a phase when decoding moves on to another
+ * one, so that each tick is only counted once */
+typedef struct phase_timer
+{
+    uintmax_t ticks[INFLATELIB_PHASE_COUNT];
+    uint64_t last_switch;
+    uint8_t current;
+    uint8_t depth;
+    uint8_t stack[PHASE_TIMER_MAX_DEPTH];
+} phase_timer;
+
+static inline uint64_t phase_timer_now(void)
+{
+#ifdef INFLATELIB_PHASE_TIMING_TSC
+    return __rdtsc();
+#else
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+#endif
+}
+
+static inline void phase_timer_switch(phase_timer* timer, uint8_t phase)
+{
+    uint64_t now = phase_timer_now();
+    timer->ticks[timer->current] += now - timer->last_switch;
+    timer->last_switch = now;
+    timer->current = phase;
+}
+
+/* Called at the start of each inflate call; time between calls is not attributed to any phase */
+static inline void phase_timer_start(phase_timer* timer)
+{
+    timer->last_switch = phase_timer_now();
+    timer->current = INFLATELIB_PHASE_SLOW_DECODE;
+    timer->depth = 0;
+}
+
+static inline void phase_timer_enter(phase_timer* timer, uint8_t phase)
+{
+    assert(timer->depth < PHASE_TIMER_MAX_DEPTH);
+    timer->stack[timer->depth++] = timer->current;
+    phase_timer_switch(timer, phase);
+}
+
+static inline void phase_timer_leave(phase_timer* timer)
+{
+    assert(timer->depth > 0);
+    phase_timer_switch(timer, timer->stack[--timer->depth]);
+}
+
+#define INFLATELIB_TIME_START(state) phase_timer_start(&(state)->phase_timer)
+#define INFLATELIB_TIME_STOP(state) phase_timer_switch(&(state)->phase_timer, INFLATELIB_PHASE_SLOW_DECODE)
+#define INFLATELIB_TIME_ENTER(state, phase) phase_timer_enter(&(state)->phase_timer, (phase))
+#define INFLATELIB_TIME_LEAVE(state) phase_timer_leave(&(state)->phase_timer)
+#else
+#define INFLATELIB_TIME_START(state) ((void)0)
+#define INFLATELIB_TIME_STOP(state) ((void)0)
+#define INFLATELIB_TIME_ENTER(state, phase) ((void)0)
+#define INFLATELIB_TIME_LEAVE(state) ((void)0)
+#endif
+
+/* Large enough to hold the longest detailed error message; longer messages are truncated */
+#define INFLATELIB_ERROR_MSG_BUFFER_SIZE 128
+
 #define INFLATELIB_MODE_DEFLATE 0x0000
 #define INFLATELIB_MODE_DEFLATE64 0x0001
 
-/* Internal state */
+/* Internal state
+ *
+ * NOTE: Fields are ordered by how often they are accessed. Everything the fast path touches for each symbol comes first
+ * so that it spans as few cache lines as possible (the first 128 bytes on 64-bit targets), with the window's offsets
+ * last so that its 64K data buffer immediately follows them. State that is only accessed once per call or once per block
+ * comes after the window, and error details and other rarely accessed data are at the very end */
 typedef struct inflatelib_state
 {
+    /* Per-symbol state */
     struct bitstream bitstream;
+    huffman_tree literal_length_tree;
+    huffman_tree distance_tree;
+    uintmax_t output_threshold; /* Limits only need to be re-evaluated once 'window.total_bytes' would exceed this */
     struct window window;
 
-    /* Formatted (allocated) error message */
-    char* error_msg_fmt;
-    size_t error_msg_len;
-
     /* Inflater state */
     inflate_state ifstate;
     uint8_t mode : 1;  /* See 'INFLATELIB_MODE*' for possible values */
     uint8_t btype : 2; /* block_type, but 'block_type' is signed and any value gretaer than 1 is negative... */
     uint8_t bfinal : 1;
     uint8_t need_more_data : 1; /* Set when we are terminating due to not enough input data & we need to mark all as consumed */
+    uint8_t static_tables : 1;  /* Set while the literal/length and distance trees hold the static Huffman codes */
 
-    /* Compressed block state */
-    huffman_tree code_length_tree;
-    huffman_tree literal_length_tree;
-    huffman_tree distance_tree;
+    /* Per-call work caps set by the caller, and the number of symbols that may still be decoded during the current call */
+    size_t symbol_budget;
+    size_t call_max_output;
+    size_t call_max_symbols;
 
-    /* Reusable data, depending on the operation being done */
+    /* Reusable data, depending on the operation being done. The fields used while decoding compressed blocks come first
+     * so that the slow path does not touch the cold code length array */
     union
     {
+        /* Info when reading compressed blocks */
+        struct
+        {
+            uint8_t extra_bits;
+            uint16_t symbol;
+            uint32_t block_length;
+            uint32_t block_distance;
+        } compressed;
+
         /* Info when reading an uncompressed block */
         struct
         {
@@ -114,19 +242,77 @@ typedef struct inflatelib_state
              * distance and literal/length codes are specified in "one chunk" which dictates the array size */
             uint8_t code_lengths[LITERAL_TREE_MAX_ELEMENT_COUNT + DIST_TREE_MAX_ELEMENT_COUNT];
         } dynamic_codes;
-
-        /* Info when reading compressed blocks */
-        struct
-        {
-            uint8_t extra_bits;
-            uint16_t symbol;
-            uint32_t block_length;
-            uint32_t block_distance;
-        } compressed;
     } data;
+
+    /* Per-block state */
+    huffman_tree code_length_tree;
+
+    /* Resource limits and the counters used to enforce them. The counters are cleared on reset, the limits are not */
+    inflatelib_limits limits;
+    uintmax_t input_bytes; /* Bytes of input consumed since the last reset; the window tracks the output count */
+    uintmax_t block_count;
+    uintmax_t table_count;
+
+#ifdef INFLATELIB_PHASE_TIMING
+    /* Time spent in each phase of decoding since the last reset */
+    phase_timer phase_timer;
+#endif
+
+    /* Details of the last error encountered. These are stored inline so that the error path never allocates; the
+     * detailed error message is only rendered into 'error_msg_buffer' on demand */
+    inflatelib_error_info error;
+    char error_msg_buffer[INFLATELIB_ERROR_MSG_BUFFER_SIZE];
 } inflatelib_state;
 
-int format_error_message(inflatelib_stream* stream, const char* fmt, ...);
+/* Records the error in the stream's internal state, sets 'errno' and 'error_msg', and returns the appropriate
+ * 'INFLATELIB_ERROR_*' value. Use the 'INFLATELIB_ERRCODE_*' definitions to determine the meaning of each value */
+INFLATELIB_COLD int set_error(inflatelib_stream* stream, int code, uintmax_t value0, uintmax_t value1, uintmax_t value2);
+
+/* Same as 'huffman_tree_lookup', only it assumes that there's enough bits in the input to read any given symbol and
+ * therefore never returns 0. This is defined here, and not in 'huffman_tree.h', so that it can be inlined into the fast
+ * path since it needs access to the stream's internal state */
+static inline int huffman_tree_lookup_unchecked(huffman_tree* tree, inflatelib_stream* stream, uint16_t* symbol)
+{
+    bitstream* bitstream = &stream->internal->bitstream;
+    huffman_table_entry* tableEntry;
+    size_t input;
+
+    input = bitstream_peek_unchecked(bitstream);
+    tableEntry = &tree->data[input & tree->table_mask];
+
+    if (tableEntry->code_length > tree->table_bits)
+    {
+        /* This is a "pointer" inside the tree */
+        huffman_table_entry* tableBase = tree->data + ((size_t)0x01 << tree->table_bits);
+        size_t bitsRead = tree->table_bits;
+        size_t remainingInput = input >> tree->table_bits;
+
+        do
+        {
+            assert(bitsRead < 15); /* Largest code is 15 bits */
+
+            tableEntry = tableBase + (2 * (size_t)tableEntry->symbol) + (remainingInput & 0x01);
+            assert(tableEntry < (tree->data + tree->data_size)); /* Otherwise data in the table is corrupt */
+            ++bitsRead;
+            remainingInput >>= 1;
+        } while (tableEntry->code_length > bitsRead);
+
+        assert((tableEntry->code_length == bitsRead) || !tableEntry->code_length); /* Otherwise we wrote bad data or indexed something wrong */
+    }
+    /* Otherwise, error or the data fit in the table */
+
+    if (INFLATELIB_UNLIKELY(tableEntry->code_length == 0))
+    {
+        /* Zero means unassigned; this is an error */
+        set_error(stream, INFLATELIB_ERRCODE_INVALID_CODE, input, 16, 0);
+        return -1;
+    }
+
+    /* Success if we've gotten this far */
+    *symbol = tableEntry->symbol;
+    bitstream_consume_bits(bitstream, tableEntry->code_length);
+    return 1;
+}
 
 #define INFLATELIB_ALLOC(stream, type, count) (type*)stream->alloc(stream->user_data, sizeof(type) * count, alignof(type))
 #define INFLATELIB_FREE(stream, type, ptr, count) stream->free(stream->user_data, ptr, sizeof(type) * count, alignof(type))
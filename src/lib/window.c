@@ -6,16 +6,115 @@
  *    TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
  *    PARTICULAR PURPOSE AND NONINFRINGEMENT.
  */
+#ifdef INFLATELIB_MIRRORED_WINDOW
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* For memfd_create */
+#endif
+#endif
+
 #include <assert.h>
 #include <string.h>
 
 #include "window.h"
 
+#ifdef INFLATELIB_MIRRORED_WINDOW
+#include <sys/mman.h>
+#include <unistd.h>
+
+static int window_is_mirrored(const window* window)
+{
+    return window->data != window->storage;
+}
+
+static uint8_t* window_map_mirror(void)
+{
+    uint8_t* result = NULL;
+    void* reservation;
+    long pageSize = sysconf(_SC_PAGESIZE);
+    int fd;
+
+    if ((pageSize <= 0) || ((WINDOW_SIZE % pageSize) != 0))
+    {
+        return NULL; /* Each half must start on a page boundary */
+    }
+
+    fd = memfd_create("inflatelib-window", MFD_CLOEXEC);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+
+    if (ftruncate(fd, WINDOW_SIZE) == 0)
+    {
+        /* Reserve enough contiguous address space for both halves and then map the same pages over each half */
+        reservation = mmap(NULL, 2 * WINDOW_SIZE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (reservation != MAP_FAILED)
+        {
+            uint8_t* base = (uint8_t*)reservation;
+            /* The halves must be shared mappings in order to alias one another, so a forked child would otherwise
+             * write into the parent's window. Keep the mapping out of the child so that misuse faults instead */
+            if ((mmap(base, WINDOW_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED) &&
+                (mmap(base + WINDOW_SIZE, WINDOW_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) !=
+                 MAP_FAILED) &&
+                (madvise(base, 2 * WINDOW_SIZE, MADV_DONTFORK) == 0))
+            {
+                result = base;
+            }
+            else
+            {
+                munmap(reservation, 2 * WINDOW_SIZE);
+            }
+        }
+    }
+
+    /* The mappings keep the memory alive */
+    close(fd);
+    return result;
+}
+#else
+#define window_is_mirrored(window) 0
+#endif
+
 void window_init(window* window)
 {
+    window->data = window->storage;
     window_reset(window);
 }
 
+void window_destroy(window* window)
+{
+#ifdef INFLATELIB_MIRRORED_WINDOW
+    /* NOTE: 'data' may be null if the window was zero-initialized, but never initialized */
+    if (window->data && window_is_mirrored(window))
+    {
+        munmap(window->data, 2 * WINDOW_SIZE);
+    }
+#endif
+    window->data = window->storage;
+}
+
+int window_enable_mirror(window* window)
+{
+#ifdef INFLATELIB_MIRRORED_WINDOW
+    uint8_t* mirror;
+
+    assert(window->total_bytes == 0); /* Otherwise we would lose data */
+    if (!window_is_mirrored(window))
+    {
+        mirror = window_map_mirror();
+        if (mirror)
+        {
+            window->data = mirror;
+        }
+    }
+
+    return window_is_mirrored(window);
+#else
+    (void)window;
+    return 0;
+#endif
+}
+
 void window_reset(window* window)
 {
     window->read_offset = 0;
@@ -24,23 +123,50 @@ void window_reset(window* window)
     window->total_bytes = 0;
 }
 
+void window_copy(window* dest, const window* source)
+{
+    size_t validBytes = (source->total_bytes < WINDOW_SIZE) ? (size_t)source->total_bytes : WINDOW_SIZE;
+    size_t startOffset = (source->write_offset - validBytes) & WINDOW_MASK;
+    size_t firstBytes = (validBytes <= (WINDOW_SIZE - startOffset)) ? validBytes : (WINDOW_SIZE - startOffset);
+
+    assert(dest->total_bytes == 0); /* Otherwise we would be overwriting data */
+
+    /* The valid bytes end at the write offset and may wrap around the end of the buffer. When the window is mirrored,
+     * writing the first half is sufficient */
+    memcpy(dest->data + startOffset, source->data + startOffset, firstBytes);
+    memcpy(dest->data, source->data, validBytes - firstBytes);
+
+    dest->read_offset = source->read_offset;
+    dest->write_offset = source->write_offset;
+    dest->unconsumed_bytes = source->unconsumed_bytes;
+    dest->total_bytes = source->total_bytes;
+}
+
 size_t window_copy_output(window* window, uint8_t* output, size_t outputSize)
 {
     size_t totalBytesToCopy = (outputSize <= window->unconsumed_bytes) ? outputSize : window->unconsumed_bytes;
 
+    if (window_is_mirrored(window))
+    {
+        memcpy(output, window->data + window->read_offset, totalBytesToCopy);
+        window->read_offset = (uint16_t)((window->read_offset + totalBytesToCopy) & WINDOW_MASK);
+        window->unconsumed_bytes -= (uint32_t)totalBytesToCopy;
+        return totalBytesToCopy;
+    }
+
     for (size_t bytesRemaining = totalBytesToCopy; bytesRemaining > 0;)
     {
-        uint32_t buffRemaining = DEFLATE64_WINDOW_SIZE - window->read_offset; /* Space until end of buffer */
+        uint32_t buffRemaining = WINDOW_SIZE - window->read_offset; /* Space until end of buffer */
         size_t bytesToCopy = (bytesRemaining <= buffRemaining) ? bytesRemaining : buffRemaining;
 
         memcpy(output, window->data + window->read_offset, bytesToCopy);
         output += bytesToCopy;
         bytesRemaining -= bytesToCopy;
-        window->read_offset += (uint16_t)bytesToCopy; /* This will overflow back to zero correctly */
+        window->read_offset = (uint16_t)((window->read_offset + bytesToCopy) & WINDOW_MASK);
         /* Wait until after the loop to update 'unconsumed_bytes' since it's not used by the loop*/
     }
 
-    window->unconsumed_bytes -= totalBytesToCopy;
+    window->unconsumed_bytes -= (uint32_t)totalBytesToCopy;
 
     return totalBytesToCopy;
 }
@@ -49,17 +175,28 @@ size_t window_copy_bytes(window* window, bitstream* bitstream, size_t count)
 {
     size_t result = 0;
 
-    assert((window->unconsumed_bytes + count) <= DEFLATE64_WINDOW_SIZE); /* Otherwise we will clobber data */
+    /* Only copy as much as there is space for. Uncompressed blocks can be larger than the window when it's 32k */
+    if (count > (WINDOW_SIZE - window->unconsumed_bytes))
+    {
+        count = WINDOW_SIZE - window->unconsumed_bytes;
+    }
+
+    if (window_is_mirrored(window) && (count > 0))
+    {
+        result = bitstream_copy_bytes(bitstream, count, window->data + window->write_offset);
+        count = 0;
+        window->write_offset = (uint16_t)((window->write_offset + result) & WINDOW_MASK);
+    }
 
     while (count > 0)
     {
-        size_t buffRemaining = DEFLATE64_WINDOW_SIZE - window->write_offset; /* Space until end of buffer */
+        size_t buffRemaining = WINDOW_SIZE - window->write_offset; /* Space until end of buffer */
         size_t bytesToCopy = (count <= buffRemaining) ? count : buffRemaining;
 
         size_t bytesCopied = bitstream_copy_bytes(bitstream, bytesToCopy, window->data + window->write_offset);
         count -= bytesCopied;
         result += bytesCopied;
-        window->write_offset = (uint16_t)(window->write_offset + bytesCopied); /* This will overflow back to zero correctly */
+        window->write_offset = (uint16_t)((window->write_offset + bytesCopied) & WINDOW_MASK);
         /* Wait until after the loop to update other counts as these values are not used by the loop */
 
         if (bytesCopied < bytesToCopy)
@@ -70,7 +207,7 @@ size_t window_copy_bytes(window* window, bitstream* bitstream, size_t count)
     }
 
     window->total_bytes += result;
-    window->unconsumed_bytes += result;
+    window->unconsumed_bytes += (uint32_t)result;
 
     return result;
 }
@@ -79,9 +216,9 @@ int window_copy_length_distance(window* window, size_t distance, size_t length)
 {
     size_t result = 0;
     uint16_t copyIndex;
-    size_t writeSpaceRemaining = DEFLATE64_WINDOW_SIZE - window->unconsumed_bytes;
-    assert(window->unconsumed_bytes <= DEFLATE64_WINDOW_SIZE);
-    assert(distance <= DEFLATE64_WINDOW_SIZE);
+    size_t writeSpaceRemaining = WINDOW_SIZE - window->unconsumed_bytes;
+    assert(window->unconsumed_bytes <= WINDOW_SIZE);
+    assert(distance <= WINDOW_SIZE);
 
     /* The distance can't reference data that hasn't been written yet */
     if ((distance > window->total_bytes))
@@ -89,9 +226,35 @@ int window_copy_length_distance(window* window, size_t distance, size_t length)
         return -1; /* Invalid distance */
     }
 
-    /* Figure out the index where we should start copying data from. This is rather easy since we can rely on unsigned
-     * integer overflow to give us the correct value */
-    copyIndex = (uint16_t)(window->write_offset - distance);
+    /* Figure out the index where we should start copying data from. This is rather easy since the window size is a power
+     * of two and we can rely on unsigned integer overflow to give us the correct value */
+    copyIndex = (uint16_t)((window->write_offset - distance) & WINDOW_MASK);
+
+    if (window_is_mirrored(window) && (distance <= WINDOW_SIZE / 2))
+    {
+        /* Neither the source nor the destination need to wrap around, so the only reason to split the copy is when
+         * 'length' is greater than 'distance'. Copying at most 'distance' bytes at a time reads bytes written by previous
+         * iterations, as required. Both halves of the mapping alias the same pages, so the physical ranges are only
+         * disjoint if each copy is also no larger than 'WINDOW_SIZE - distance'. That limit is only smaller when the
+         * distance exceeds half the window (Deflate64 only), which is handled by the general loop below instead */
+        uint8_t* dest = window->data + window->write_offset;
+        const uint8_t* source = window->data + copyIndex;
+
+        result = (length <= writeSpaceRemaining) ? length : writeSpaceRemaining;
+        for (size_t bytesRemaining = result; bytesRemaining > 0;)
+        {
+            size_t copySize = (bytesRemaining <= distance) ? bytesRemaining : distance;
+            memcpy(dest, source, copySize);
+            dest += copySize;
+            source += copySize;
+            bytesRemaining -= copySize;
+        }
+
+        window->write_offset = (uint16_t)((window->write_offset + result) & WINDOW_MASK);
+        window->unconsumed_bytes += (uint32_t)result;
+        window->total_bytes += result;
+        return (int)result;
+    }
 
     /*
      * We can't just copy all bytes in one fell swoop for several reasons:
@@ -101,6 +264,7 @@ int window_copy_length_distance(window* window, size_t distance, size_t length)
      *          yet.
      *      3.  With Deflate64, the maximum length is greater than 65,536 - the size of the buffer - and we can't write
      *          all of that data without writing over data that hasn't been consumed yet.
+     * This loop only addresses the first half of a mirrored window, so it is also correct in that case.
      */
     while ((length > 0) && (writeSpaceRemaining > 0))
     {
@@ -114,10 +278,10 @@ int window_copy_length_distance(window* window, size_t distance, size_t length)
         else
         {
             /* All data up to the end of the buffer can be copied in a single operation */
-            readRemaining = DEFLATE64_WINDOW_SIZE - copyIndex;
+            readRemaining = WINDOW_SIZE - copyIndex;
         }
 
-        writeRemaining = DEFLATE64_WINDOW_SIZE - window->write_offset;
+        writeRemaining = WINDOW_SIZE - window->write_offset;
         if (writeRemaining > writeSpaceRemaining)
         {
             /* Prevent ourselves from overwriting data */
@@ -139,11 +303,11 @@ int window_copy_length_distance(window* window, size_t distance, size_t length)
         /* We need to use a memmove because the data we are copying from may overlap with what we are copying to */
         memmove(window->data + window->write_offset, window->data + copyIndex, copySize);
 
-        /* Integer overflow will take care of resetting each of these back to zero properly */
-        window->write_offset = (uint16_t)(window->write_offset + copySize);
-        window->unconsumed_bytes += copySize;
+        /* Masking will take care of resetting each of these back to zero properly */
+        window->write_offset = (uint16_t)((window->write_offset + copySize) & WINDOW_MASK);
+        window->unconsumed_bytes += (uint32_t)copySize;
         window->total_bytes += copySize;
-        copyIndex = (uint16_t)(copyIndex + copySize);
+        copyIndex = (uint16_t)((copyIndex + copySize) & WINDOW_MASK);
         writeSpaceRemaining -= copySize;
         length -= copySize;
         result += copySize;
@@ -151,29 +315,3 @@ int window_copy_length_distance(window* window, size_t distance, size_t length)
 
     return (int)result;
 }
-
-int window_write_byte(window* window, uint8_t byte)
-{
-    if (window->unconsumed_bytes >= DEFLATE64_WINDOW_SIZE)
-    {
-        return 0; /* Buffer is full */
-    }
-
-    window->data[window->write_offset] = byte;
-    ++window->write_offset; /* This will overflow back to zero correctly */
-    ++window->unconsumed_bytes;
-    ++window->total_bytes;
-
-    return 1;
-}
-
-void window_write_byte_consume(window* window, uint8_t byte)
-{
-    assert(window->unconsumed_bytes == 0);               /* Pre-condition */
-    assert(window->write_offset == window->read_offset); /* Sanity check */
-
-    window->data[window->write_offset] = byte;
-    ++window->write_offset; /* These will overflow back to zero correctly */
-    ++window->read_offset;
-    ++window->total_bytes;
-}
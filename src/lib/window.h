@@ -9,6 +9,7 @@
 #ifndef INFLATELIB_WINDOW_H
 #define INFLATELIB_WINDOW_H
 
+#include <assert.h>
 #include <stdint.h>
 
 #include "bitstream.h"
@@ -18,6 +19,16 @@
 #define DEFLATE64_WINDOW_SIZE 0x10000
 #define DEFLATE64_WINDOW_MASK 0x0FFFF
 
+/* Deflate only allows up to a 32k offset. Small footprint builds only support Deflate and can use a window of this size */
+#define DEFLATE_WINDOW_SIZE 0x8000
+
+#ifdef INFLATELIB_SMALL_FOOTPRINT
+#define WINDOW_SIZE DEFLATE_WINDOW_SIZE
+#else
+#define WINDOW_SIZE DEFLATE64_WINDOW_SIZE
+#endif
+#define WINDOW_MASK (WINDOW_SIZE - 1)
+
 #ifdef __cplusplus
 // Needed for the tests
 extern "C"
@@ -38,7 +49,7 @@ extern "C"
 
         /* NOTE: We can't infer this from the two offsets because it's possible the window is full and therefore the two
          * offsets are the same (would be ambiguous if empty or full). This is also why this can't be 16-bits */
-        size_t unconsumed_bytes;
+        uint32_t unconsumed_bytes;
 
         /* Total bytes written to 'data' that should be considered valid. This is used to ensure that a length/distance
          * pair does not refer to garbage data. This may be larger than the buffer size, which is okay; we still enforce
@@ -46,11 +57,30 @@ extern "C"
          * value is greater than the buffer size */
         uintmax_t total_bytes;
 
-        uint8_t data[DEFLATE64_WINDOW_SIZE];
+        /* The ring buffer. This either points to 'storage' or, when 'window_enable_mirror' succeeds, to a mapping that is
+         * twice the size of the window where the second half maps the same memory as the first. In the mirrored case,
+         * 'data[i]' and 'data[i + WINDOW_SIZE]' always refer to the same byte, so any range of up to the size
+         * of the window that begins in the first half can be accessed contiguously without needing to wrap around.
+         * 'storage' is kept in either case so that the layout of the state does not depend on whether the mapping
+         * succeeded; its pages are never touched when the window is mirrored */
+        uint8_t* data;
+        uint8_t storage[WINDOW_SIZE];
     } window;
 
+    /* The order of calls must follow: init, [enable_mirror], reset, reset, ..., reset, destroy */
     void window_init(window* window);
     void window_reset(window* window);
+    void window_destroy(window* window);
+
+    /* Attempts to switch the window to a mirrored mapping, returning 1 on success and 0 if the window continues to use
+     * its built-in storage. This must be called before any data is written to the window. This is only supported on
+     * Linux when built with 'INFLATELIB_MIRRORED_WINDOW' and fails if the memory cannot be mapped */
+    int window_enable_mirror(window* window);
+
+    /* Copies the offsets and valid contents of 'source' into 'dest', which must be initialized and empty. Only bytes
+     * that could still be referenced by a length/distance pair or that are waiting to be written to the output are
+     * copied; this is less than the size of the window if fewer bytes than that have been written */
+    void window_copy(window* dest, const window* source);
 
     /* Copies up to 'outputSize' bytes to 'output', returning the number of bytes that were copied */
     size_t window_copy_output(window* window, uint8_t* output, size_t outputSize);
@@ -64,10 +94,32 @@ extern "C"
     int window_copy_length_distance(window* window, size_t distance, size_t length);
 
     /* Writes a single byte to the window */
-    int window_write_byte(window* window, uint8_t byte);
+    static inline int window_write_byte(window* window, uint8_t byte)
+    {
+        if (window->unconsumed_bytes >= WINDOW_SIZE)
+        {
+            return 0; /* Buffer is full */
+        }
+
+        window->data[window->write_offset] = byte;
+        window->write_offset = (uint16_t)((window->write_offset + 1) & WINDOW_MASK);
+        ++window->unconsumed_bytes;
+        ++window->total_bytes;
+
+        return 1;
+    }
 
     /* Same as the above, only it assumes that 'unconsumed_bytes' is 0 and it immediately consumes the byte */
-    void window_write_byte_consume(window* window, uint8_t byte);
+    static inline void window_write_byte_consume(window* window, uint8_t byte)
+    {
+        assert(window->unconsumed_bytes == 0);               /* Pre-condition */
+        assert(window->write_offset == window->read_offset); /* Sanity check */
+
+        window->data[window->write_offset] = byte;
+        window->write_offset = (uint16_t)((window->write_offset + 1) & WINDOW_MASK);
+        window->read_offset = (uint16_t)((window->read_offset + 1) & WINDOW_MASK);
+        ++window->total_bytes;
+    }
 
 #ifdef __cplusplus
 }
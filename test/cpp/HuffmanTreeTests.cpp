@@ -585,7 +585,7 @@ TEST_CASE("HuffmanTreeFailureTests", "[huffman_tree]")
             doFailingTest(std::size(lens), [&](inflatelib_stream& stream, huffman_tree& tree) {
                 REQUIRE(huffman_tree_reset(&tree, &stream, lens, std::size(lens)) == INFLATELIB_ERROR_DATA);
                 REQUIRE(errno == EINVAL);
-                REQUIRE(stream.error_msg == "Too many symbols with code length 1. 3 symbols starting at 0x0 exceeds the specified number of bits"sv);
+                REQUIRE(inflatelib_error_message(&stream) == "Too many symbols with code length 1. 3 symbols starting at 0x0 exceeds the specified number of bits"sv);
             });
         }
 
@@ -596,7 +596,7 @@ TEST_CASE("HuffmanTreeFailureTests", "[huffman_tree]")
             doFailingTest(std::size(lens), [&](inflatelib_stream& stream, huffman_tree& tree) {
                 REQUIRE(huffman_tree_reset(&tree, &stream, lens, std::size(lens)) == INFLATELIB_ERROR_DATA);
                 REQUIRE(errno == EINVAL);
-                REQUIRE(stream.error_msg == "Too many symbols with code length 2. 5 symbols starting at 0x0 exceeds the specified number of bits"sv);
+                REQUIRE(inflatelib_error_message(&stream) == "Too many symbols with code length 2. 5 symbols starting at 0x0 exceeds the specified number of bits"sv);
             });
         }
 
@@ -608,7 +608,7 @@ TEST_CASE("HuffmanTreeFailureTests", "[huffman_tree]")
             doFailingTest(std::size(lens), [&](inflatelib_stream& stream, huffman_tree& tree) {
                 REQUIRE(huffman_tree_reset(&tree, &stream, lens, std::size(lens)) == INFLATELIB_ERROR_DATA);
                 REQUIRE(errno == EINVAL);
-                REQUIRE(stream.error_msg == "Too many symbols with code length 4. 1 symbols starting at 0x10 exceeds the specified number of bits"sv);
+                REQUIRE(inflatelib_error_message(&stream) == "Too many symbols with code length 4. 1 symbols starting at 0x10 exceeds the specified number of bits"sv);
             });
         }
 
@@ -619,7 +619,7 @@ TEST_CASE("HuffmanTreeFailureTests", "[huffman_tree]")
             doFailingTest(std::size(lens), [&](inflatelib_stream& stream, huffman_tree& tree) {
                 REQUIRE(huffman_tree_reset(&tree, &stream, lens, std::size(lens)) == INFLATELIB_ERROR_DATA);
                 REQUIRE(errno == EINVAL);
-                REQUIRE(stream.error_msg == "Too many symbols with code length 15. 3 symbols starting at 0x7FFE exceeds the specified number of bits"sv);
+                REQUIRE(inflatelib_error_message(&stream) == "Too many symbols with code length 15. 3 symbols starting at 0x7FFE exceeds the specified number of bits"sv);
             });
         }
     }
@@ -639,7 +639,7 @@ TEST_CASE("HuffmanTreeFailureTests", "[huffman_tree]")
                 bitstream_set_data(&stream.internal->bitstream, &input, 1);
                 REQUIRE(huffman_tree_lookup(&tree, &stream, &output) < 0);
                 REQUIRE(errno == EINVAL);
-                REQUIRE(stream.error_msg == "Input bit sequence 0x38 is not a valid Huffman code for the encoded table"sv);
+                REQUIRE(inflatelib_error_message(&stream) == "Input bit sequence 0x38 is not a valid Huffman code for the encoded table"sv);
             });
 
             doFailingTest(19, [](inflatelib_stream& stream, huffman_tree& tree) {
@@ -652,7 +652,7 @@ TEST_CASE("HuffmanTreeFailureTests", "[huffman_tree]")
                 bitstream_set_data(&stream.internal->bitstream, &input, 1);
                 REQUIRE(huffman_tree_lookup(&tree, &stream, &output) < 0);
                 REQUIRE(errno == EINVAL);
-                REQUIRE(stream.error_msg == "Input bit sequence 0x64 is not a valid Huffman code for the encoded table"sv);
+                REQUIRE(inflatelib_error_message(&stream) == "Input bit sequence 0x64 is not a valid Huffman code for the encoded table"sv);
             });
 
             doFailingTest(32, [](inflatelib_stream& stream, huffman_tree& tree) {
@@ -666,7 +666,7 @@ TEST_CASE("HuffmanTreeFailureTests", "[huffman_tree]")
                 bitstream_set_data(&stream.internal->bitstream, input, std::size(input));
                 REQUIRE(huffman_tree_lookup(&tree, &stream, &output) < 0);
                 REQUIRE(errno == EINVAL);
-                REQUIRE(stream.error_msg == "Input bit sequence 0x200 is not a valid Huffman code for the encoded table"sv);
+                REQUIRE(inflatelib_error_message(&stream) == "Input bit sequence 0x200 is not a valid Huffman code for the encoded table"sv);
             });
         }
 
@@ -685,7 +685,7 @@ TEST_CASE("HuffmanTreeFailureTests", "[huffman_tree]")
 
                 REQUIRE(huffman_tree_lookup(&tree, &stream, &output) < 0);
                 REQUIRE(errno == EINVAL);
-                REQUIRE(stream.error_msg == "Input bit sequence 0x4 is not a valid Huffman code for the encoded table"sv);
+                REQUIRE(inflatelib_error_message(&stream) == "Input bit sequence 0x4 is not a valid Huffman code for the encoded table"sv);
             });
 
             doFailingTest(32, [](inflatelib_stream& stream, huffman_tree& tree) {
@@ -715,7 +715,7 @@ TEST_CASE("HuffmanTreeFailureTests", "[huffman_tree]")
                 // Invalid input is 010001000000000
                 REQUIRE(huffman_tree_lookup(&tree, &stream, &output) < 0);
                 REQUIRE(errno == EINVAL);
-                REQUIRE(stream.error_msg == "Input bit sequence 0x2200 is not a valid Huffman code for the encoded table"sv);
+                REQUIRE(inflatelib_error_message(&stream) == "Input bit sequence 0x2200 is not a valid Huffman code for the encoded table"sv);
             });
         }
     }
@@ -21,7 +21,15 @@ static int fopen_s(FILE** streamptr, const char* filename, const char* mode)
 #endif
 
 #include <inflatelib.hpp>
+#include <inflatelib_executor.hpp>
+#include <inflatelib_generator.hpp>
+#include <inflatelib_istreambuf.hpp>
+#include <inflatelib_zip.hpp>
+#include <algorithm>
 #include <filesystem>
+#include <optional>
+#include <sstream>
+#include <vector>
 
 // These tests have backing test files compiled from 'test/data' and placed into '${buildRoot}/test/data'. When running
 // this test, that path is '../data' relative to the test executable.
@@ -195,15 +203,15 @@ static void inflate_test_worker(
 
     if (result < 0)
     {
-        UNSCOPED_INFO("The error message is: " << stream.error_msg());
+        UNSCOPED_INFO("The error message is: " << stream.error_detail());
     }
 
     if (errFragment)
     {
         INFO("Expecting error message: " << errFragment);
-        INFO("Actual error message: " << stream.error_msg());
+        INFO("Actual error message: " << stream.error_detail());
         REQUIRE(result == INFLATELIB_ERROR_DATA);
-        REQUIRE(std::strstr(stream.error_msg(), errFragment) != nullptr);
+        REQUIRE(stream.error_detail().find(errFragment) != std::string::npos);
     }
     else
     {
@@ -250,12 +258,14 @@ static void inflate_test(const char* inputFileName, const char* outputFileName)
     do_inflate_test<&inflatelib::stream::try_inflate>(input, output, nullptr);
 }
 
+#ifndef INFLATELIB_SMALL_FOOTPRINT
 static void inflate64_test(const char* inputFileName, const char* outputFileName)
 {
     auto input = read_file(data_directory / inputFileName);
     auto output = read_file(data_directory / outputFileName);
     do_inflate_test<&inflatelib::stream::try_inflate64>(input, output, nullptr);
 }
+#endif
 
 static void inflate_error_test(const char* inputFileName, const char* errFragment)
 {
@@ -263,11 +273,13 @@ static void inflate_error_test(const char* inputFileName, const char* errFragmen
     do_inflate_test<&inflatelib::stream::try_inflate>(input, {}, errFragment);
 }
 
+#ifndef INFLATELIB_SMALL_FOOTPRINT
 static void inflate64_error_test(const char* inputFileName, const char* errFragment)
 {
     auto input = read_file(data_directory / inputFileName);
     do_inflate_test<&inflatelib::stream::try_inflate64>(input, {}, errFragment);
 }
+#endif
 
 TEST_CASE("InflateErrors", "[inflate]")
 {
@@ -278,6 +290,62 @@ TEST_CASE("InflateErrors", "[inflate]")
     REQUIRE(inflatelib_inflate(&stream) == INFLATELIB_ERROR_ARG);
 }
 
+TEST_CASE("InflateErrorInfo", "[inflate]")
+{
+    // Reporting an error should never allocate memory, so keep track of allocations made by the stream
+    std::size_t allocCount = 0;
+    auto alloc = [](void* userData, size_t bytes, size_t alignment) -> void* {
+        ++*static_cast<std::size_t*>(userData);
+        return ::operator new(bytes, std::align_val_t{alignment});
+    };
+    auto free = [](void*, void* ptr, size_t, size_t alignment) {
+        ::operator delete(ptr, std::align_val_t{alignment});
+    };
+
+    inflatelib::stream stream(&allocCount, alloc, free);
+    auto file = read_file(data_directory / "error.invalid-block-type.in.bin");
+    std::byte outputBuffer[1024];
+    std::span<const std::byte> input(file.buffer.get(), file.size);
+    std::span<std::byte> output(outputBuffer);
+
+    auto allocsBefore = allocCount;
+    REQUIRE(stream.try_inflate(input, output) == INFLATELIB_ERROR_DATA);
+    REQUIRE(allocCount == allocsBefore);
+
+    auto info = stream.error_info();
+    REQUIRE(info.code == INFLATELIB_ERRCODE_INVALID_BLOCK_TYPE);
+    REQUIRE(info.values[0] == 3);
+    REQUIRE(info.bit_offset == 3); // BFINAL + BTYPE
+
+    // The static message is set eagerly; the detailed message is rendered on demand
+    REQUIRE(std::strcmp(stream.get()->error_msg, "Unexpected block type") == 0);
+    REQUIRE(std::strcmp(inflatelib_error_message(stream.get()), "Unexpected block type '3'") == 0);
+    REQUIRE(allocCount == allocsBefore);
+
+    // The C++ accessors are usable through a const reference
+    const auto& constStream = stream;
+    REQUIRE(std::strcmp(constStream.error_msg(), "Unexpected block type") == 0);
+    REQUIRE(constStream.error_detail() == "Unexpected block type '3'");
+
+    // Formatting into a buffer follows 'snprintf' semantics
+    char buffer[11];
+    REQUIRE(inflatelib_format_error(stream.get(), buffer, sizeof(buffer)) == 25);
+    REQUIRE(std::strcmp(buffer, "Unexpected") == 0);
+    REQUIRE(inflatelib_format_error(stream.get(), nullptr, 0) == 25);
+
+#ifndef INFLATELIB_SMALL_FOOTPRINT
+    // Switching modes without a reset is reported as a mode mismatch
+    stream.reset();
+    input = {file.buffer.get(), file.size};
+    REQUIRE(stream.try_inflate64(input, output) == INFLATELIB_ERROR_DATA);
+    REQUIRE(stream.try_inflate(input, output) == INFLATELIB_ERROR_ARG);
+    info = stream.error_info();
+    REQUIRE(info.code == INFLATELIB_ERRCODE_MODE_MISMATCH);
+    REQUIRE(info.values[0] == 1);
+#endif
+}
+
+#ifndef INFLATELIB_SMALL_FOOTPRINT
 TEST_CASE("Inflate64Errors", "[inflate64]")
 {
     inflate64_error_test("error.invalid-block-type.in.bin", "Unexpected block type '3'");
@@ -286,6 +354,42 @@ TEST_CASE("Inflate64Errors", "[inflate64]")
     inflatelib_stream stream = {};
     REQUIRE(inflatelib_inflate64(&stream) == INFLATELIB_ERROR_ARG);
 }
+#endif
+
+#ifdef INFLATELIB_SMALL_FOOTPRINT
+TEST_CASE("Inflate64Unsupported", "[inflate64]")
+{
+    // Small footprint builds only support Deflate; asking for Deflate64 is an argument error that consumes no data
+    auto file = read_file(data_directory / "dynamic.single.deflate64.in.bin");
+    inflatelib::stream stream;
+    std::byte outputBuffer[1024];
+    std::span<const std::byte> input(file.buffer.get(), file.size);
+    std::span<std::byte> output(outputBuffer);
+    REQUIRE(stream.try_inflate64(input, output) == INFLATELIB_ERROR_ARG);
+    REQUIRE(input.size() == file.size);
+    REQUIRE(output.size() == sizeof(outputBuffer));
+
+    auto info = stream.error_info();
+    REQUIRE(info.code == INFLATELIB_ERRCODE_UNSUPPORTED_MODE);
+    REQUIRE(info.values[0] == 1);
+    REQUIRE(stream.error_detail() == "Deflate64 is not supported by this build of inflatelib");
+
+    // The scatter/gather and throwing versions fail the same way
+    inflatelib_input_buffer inputs[] = {{file.buffer.get(), file.size}};
+    inflatelib_output_buffer outputs[] = {{outputBuffer, sizeof(outputBuffer)}};
+    REQUIRE(stream.try_inflatev64(inputs, outputs) == INFLATELIB_ERROR_ARG);
+    REQUIRE(inputs[0].size == file.size);
+    REQUIRE_THROWS_AS(stream.inflate64(input, output), std::invalid_argument);
+
+    // The stream can still be used for Deflate data
+    auto deflateInput = read_file(data_directory / "dynamic.single.deflate.in.bin");
+    auto deflateOutput = read_file(data_directory / "dynamic.single.deflate.out.bin");
+    input = {deflateInput.buffer.get(), deflateInput.size};
+    output = {outputBuffer, deflateOutput.size};
+    REQUIRE(stream.try_inflate(input, output) == INFLATELIB_EOF);
+    REQUIRE(std::memcmp(outputBuffer, deflateOutput.buffer.get(), deflateOutput.size) == 0);
+}
+#endif
 
 TEST_CASE("InflateUncompressed", "[inflate]")
 {
@@ -298,6 +402,7 @@ TEST_CASE("InflateUncompressed", "[inflate]")
         "uncompressed.error.nlen.in.bin", "Uncompressed block length (7FFF) does not match its encoded one's complement value (0000)");
 }
 
+#ifndef INFLATELIB_SMALL_FOOTPRINT
 TEST_CASE("Inflate64Uncompressed", "[inflate64]")
 {
     inflate64_test("uncompressed.empty.in.bin", "uncompressed.empty.out.bin");
@@ -308,6 +413,7 @@ TEST_CASE("Inflate64Uncompressed", "[inflate64]")
     inflate64_error_test(
         "uncompressed.error.nlen.in.bin", "Uncompressed block length (7FFF) does not match its encoded one's complement value (0000)");
 }
+#endif
 
 TEST_CASE("InflateCompressedDynamic", "[inflate]")
 {
@@ -368,6 +474,7 @@ TEST_CASE("InflateCompressedDynamic", "[inflate]")
         "Compressed block has a distance '32768' which exceeds the size of the window (32767 bytes)");
 }
 
+#ifndef INFLATELIB_SMALL_FOOTPRINT
 TEST_CASE("Inflate64CompressedDynamic", "[inflate64]")
 {
     inflate64_test("dynamic.empty.in.bin", "dynamic.empty.out.bin");
@@ -424,6 +531,7 @@ TEST_CASE("Inflate64CompressedDynamic", "[inflate64]")
         "dynamic.error.distance-oob.long.deflate64.in.bin",
         "Compressed block has a distance '65536' which exceeds the size of the window (65535 bytes)");
 }
+#endif
 
 TEST_CASE("InflateCompressedStatic", "[inflate]")
 {
@@ -432,6 +540,7 @@ TEST_CASE("InflateCompressedStatic", "[inflate]")
     inflate_test("static.multiple.deflate.in.bin", "static.multiple.deflate.out.bin");
     inflate_test("static.overlap.deflate.in.bin", "static.overlap.deflate.out.bin");
     inflate_test("static.length-distance-stress.deflate.in.bin", "static.length-distance-stress.deflate.out.bin");
+    inflate_test("static.consecutive.in.bin", "static.consecutive.out.bin");
 
     inflate_error_test("static.error.invalid-symbol.286.in.bin", "Invalid symbol '286' from literal/length tree");
     inflate_error_test("static.error.invalid-symbol.287.in.bin", "Invalid symbol '287' from literal/length tree");
@@ -445,6 +554,7 @@ TEST_CASE("InflateCompressedStatic", "[inflate]")
         "Compressed block has a distance '32768' which exceeds the size of the window (32767 bytes)");
 }
 
+#ifndef INFLATELIB_SMALL_FOOTPRINT
 TEST_CASE("Inflate64CompressedStatic", "[inflate64]")
 {
     inflate64_test("static.empty.in.bin", "static.empty.out.bin");
@@ -452,6 +562,7 @@ TEST_CASE("Inflate64CompressedStatic", "[inflate64]")
     inflate64_test("static.multiple.deflate64.in.bin", "static.multiple.deflate64.out.bin");
     inflate64_test("static.overlap.deflate64.in.bin", "static.overlap.deflate64.out.bin");
     inflate64_test("static.length-distance-stress.deflate64.in.bin", "static.length-distance-stress.deflate64.out.bin");
+    inflate64_test("static.consecutive.in.bin", "static.consecutive.out.bin");
 
     inflate64_error_test("static.error.invalid-symbol.286.in.bin", "Invalid symbol '286' from literal/length tree");
     inflate64_error_test("static.error.invalid-symbol.287.in.bin", "Invalid symbol '287' from literal/length tree");
@@ -462,12 +573,15 @@ TEST_CASE("Inflate64CompressedStatic", "[inflate64]")
         "static.error.distance-oob.long.deflate64.in.bin",
         "Compressed block has a distance '65536' which exceeds the size of the window (65535 bytes)");
 }
+#endif
 
 TEST_CASE("InflateCompressedMixed", "[inflate]")
 {
     inflate_test("mixed.empty.in.bin", "mixed.empty.out.bin");
     inflate_test("mixed.simple.in.bin", "mixed.simple.out.bin");
     inflate_test("mixed.overlap.deflate.in.bin", "mixed.overlap.deflate.out.bin");
+    inflate_test("mixed.static-dynamic-static.in.bin", "mixed.static-dynamic-static.out.bin");
+    inflate_test("mixed.static-uncompressed.in.bin", "mixed.static-uncompressed.out.bin");
 
     // Verify nothing bad happens if we call with no data
     {
@@ -487,11 +601,14 @@ TEST_CASE("InflateCompressedMixed", "[inflate]")
     }
 }
 
+#ifndef INFLATELIB_SMALL_FOOTPRINT
 TEST_CASE("Inflate64CompressedMixed", "[inflate64]")
 {
     inflate64_test("mixed.empty.in.bin", "mixed.empty.out.bin");
     inflate64_test("mixed.simple.in.bin", "mixed.simple.out.bin");
     inflate64_test("mixed.overlap.deflate64.in.bin", "mixed.overlap.deflate64.out.bin");
+    inflate64_test("mixed.static-dynamic-static.in.bin", "mixed.static-dynamic-static.out.bin");
+    inflate64_test("mixed.static-uncompressed.in.bin", "mixed.static-uncompressed.out.bin");
 
     // Verify nothing bad happens if we call with no data
     {
@@ -510,6 +627,80 @@ TEST_CASE("Inflate64CompressedMixed", "[inflate64]")
         inflatelib_destroy(&stream);
     }
 }
+#endif
+
+TEST_CASE("InflateBlockTransitions", "[inflate][inflate64]")
+{
+    // The fast path moves on to static and uncompressed blocks by itself, reusing the static tables when it can, and it
+    // can start part of the way through a copy. The tests above cover this with various strides; these target specific
+    // transitions with all of the input available so that the fast path is used wherever possible
+    auto doTestWorker = []<try_inflate_t inflateFunc>() {
+        inflatelib::stream stream;
+
+        // Inflates the file 'outputStride' bytes at a time, stopping early once 'stopOffset' bytes have been written
+        auto doInflate = [&](const char* inputFileName,
+                             const char* outputFileName,
+                             std::size_t outputStride,
+                             std::size_t stopOffset = SIZE_MAX) {
+            auto input = read_file(data_directory / inputFileName);
+            auto output = read_file(data_directory / outputFileName);
+            auto outputBuffer = std::make_unique<std::byte[]>(output.size);
+
+            std::span<const std::byte> inputSpan = {input.buffer.get(), input.size};
+            std::size_t offset = 0, calls = 0;
+            int result;
+            do
+            {
+                std::span<std::byte> outputSpan = {outputBuffer.get() + offset, std::min(outputStride, output.size - offset)};
+                auto outputSizeBefore = outputSpan.size();
+                result = (stream.*inflateFunc)(inputSpan, outputSpan);
+                offset += outputSizeBefore - outputSpan.size();
+
+                REQUIRE(result >= INFLATELIB_OK);
+                REQUIRE(++calls <= output.size + 1); // Each call other than the last must write something
+                if (offset >= stopOffset)
+                {
+                    REQUIRE(result == INFLATELIB_OK);
+                    return;
+                }
+            } while (result == INFLATELIB_OK);
+
+            REQUIRE(inputSpan.empty());
+            REQUIRE(offset == output.size);
+            REQUIRE(std::memcmp(outputBuffer.get(), output.buffer.get(), output.size) == 0);
+        };
+
+        // Copies resumed one byte of output at a time, including a copy that overlaps the data being written and copies
+        // that reference data from earlier blocks
+        doInflate("static.consecutive.in.bin", "static.consecutive.out.bin", 1);
+        stream.reset();
+        doInflate("mixed.static-dynamic-static.in.bin", "mixed.static-dynamic-static.out.bin", 1);
+        stream.reset();
+        doInflate("mixed.static-uncompressed.in.bin", "mixed.static-uncompressed.out.bin", 1);
+        stream.reset();
+
+        // Static blocks after a reset, both when the last block before the reset used the static tables, and when the
+        // tables were last built for a dynamic block
+        doInflate("static.consecutive.in.bin", "static.consecutive.out.bin", 0x1000);
+        stream.reset();
+        doInflate("static.consecutive.in.bin", "static.consecutive.out.bin", 0x1000);
+        stream.reset();
+        doInflate("dynamic.empty.in.bin", "dynamic.empty.out.bin", 0x1000);
+        stream.reset();
+        doInflate("static.consecutive.in.bin", "static.consecutive.out.bin", 0x1000);
+        stream.reset();
+
+        // Reset part of the way through the dynamic block, after the first static block has been decoded
+        doInflate("mixed.static-dynamic-static.in.bin", "mixed.static-dynamic-static.out.bin", 1, 300);
+        stream.reset();
+        doInflate("static.consecutive.in.bin", "static.consecutive.out.bin", 0x1000);
+    };
+
+    doTestWorker.operator()<&inflatelib::stream::try_inflate>();
+#ifndef INFLATELIB_SMALL_FOOTPRINT
+    doTestWorker.operator()<&inflatelib::stream::try_inflate64>();
+#endif
+}
 
 TEST_CASE("InflateRealWorldData", "[inflate]")
 {
@@ -519,6 +710,7 @@ TEST_CASE("InflateRealWorldData", "[inflate]")
     inflate_test("file.us-constitution.deflate.txt.in.bin", "file.us-constitution.txt.out.bin");
 }
 
+#ifndef INFLATELIB_SMALL_FOOTPRINT
 TEST_CASE("Inflate64RealWorldData", "[inflate64]")
 {
     // Tests a collection of files compressed with 7-Zip in an attempt to test scenarios that represent "real world data"
@@ -526,6 +718,7 @@ TEST_CASE("Inflate64RealWorldData", "[inflate64]")
     inflate64_test("file.magna-carta.deflate64.txt.in.bin", "file.magna-carta.txt.out.bin");
     inflate64_test("file.us-constitution.deflate64.txt.in.bin", "file.us-constitution.txt.out.bin");
 }
+#endif
 
 TEST_CASE("InflateTruncation", "[inflate][inflate64]")
 {
@@ -553,7 +746,9 @@ TEST_CASE("InflateTruncation", "[inflate][inflate64]")
 
     auto doTest = [&](const char* inputPath, const char* outputPath) {
         doTestWorker.operator()<&inflatelib::stream::inflate>(inputPath, outputPath);
+#ifndef INFLATELIB_SMALL_FOOTPRINT
         doTestWorker.operator()<&inflatelib::stream::inflate64>(inputPath, outputPath);
+#endif
     };
 
     doTest("truncated.uncompressed.block.in.bin", "truncated.uncompressed.block.out.bin");
@@ -589,7 +784,9 @@ TEST_CASE("InflateExtraData", "[inflate][inflate64]")
 
     auto doTest = [&](const char* inputPath, const char* outputPath) {
         doTestWorker.operator()<&inflatelib::stream::inflate>(inputPath, outputPath);
+#ifndef INFLATELIB_SMALL_FOOTPRINT
         doTestWorker.operator()<&inflatelib::stream::inflate64>(inputPath, outputPath);
+#endif
     };
 
     doTest("extra.uncompressed.in.bin", "extra.uncompressed.out.bin");
@@ -639,9 +836,6 @@ TEST_CASE("InflateReset", "[inflate][inflate64]")
     auto doInflate = [&](std::size_t inputSize = 0) {
         doInflateWorker.operator()<&inflatelib::stream::try_inflate>(inputSize);
     };
-    auto doInflate64 = [&](std::size_t inputSize = 0) {
-        doInflateWorker.operator()<&inflatelib::stream::try_inflate64>(inputSize);
-    };
 
     // The scenarios that this test:
     //  1.  'reset' after EOF allows us to read new data
@@ -649,6 +843,11 @@ TEST_CASE("InflateReset", "[inflate][inflate64]")
     //  3.  'reset' in the middle of a stream allows us to read new data
     //  4.  'reset' after reading Deflate64 data allows us to read Deflate data & vice-versa
 
+#ifndef INFLATELIB_SMALL_FOOTPRINT
+    auto doInflate64 = [&](std::size_t inputSize = 0) {
+        doInflateWorker.operator()<&inflatelib::stream::try_inflate64>(inputSize);
+    };
+
     // Test 1: Reset after EOF
     // NOTE: For all of these tests, we read archives that use Huffman tables to ensure proper re-use
     input = read_file(data_directory / "dynamic.single.deflate64.in.bin"); // Just a simple, small file to test
@@ -696,4 +895,1140 @@ TEST_CASE("InflateReset", "[inflate][inflate64]")
     output = read_file(data_directory / "static.overlap.deflate64.out.bin");
     doInflate64();
     stream.reset();
+#else
+    // Small footprint builds only support Deflate, so scenario 4 does not apply and the rest use the Deflate data
+
+    // Test 1: Reset after EOF
+    input = read_file(data_directory / "dynamic.single.deflate.in.bin");
+    output = read_file(data_directory / "dynamic.single.deflate.out.bin");
+    doInflate();
+    stream.reset();
+
+    input = read_file(data_directory / "static.single.deflate.in.bin");
+    output = read_file(data_directory / "static.single.deflate.out.bin");
+    doInflate();
+    stream.reset();
+
+    // Test 2: Reset after error
+    input = read_file(data_directory / "dynamic.error.distance-oob.long.deflate.in.bin");
+    output = {}; // Error; no output
+    doInflate();
+    stream.reset();
+
+    input = read_file(data_directory / "static.multiple.deflate.in.bin");
+    output = read_file(data_directory / "static.multiple.deflate.out.bin");
+    doInflate();
+    stream.reset();
+
+    // Test 3: Reset in the middle of a stream
+    input = read_file(data_directory / "file.us-constitution.deflate.txt.in.bin");
+    output = read_file(data_directory / "file.us-constitution.txt.out.bin");
+    doInflate(256);
+    stream.reset();
+
+    input = read_file(data_directory / "dynamic.multiple.deflate.in.bin");
+    output = read_file(data_directory / "dynamic.multiple.deflate.out.bin");
+    doInflate();
+    stream.reset();
+#endif
+}
+
+TEST_CASE("InflateCopy", "[inflate][inflate64]")
+{
+    // Copying a stream that has not been initialized produces another stream that has not been initialized
+    inflatelib::stream empty{nullptr};
+    inflatelib::stream emptyCopy(empty);
+    REQUIRE(!emptyCopy);
+
+    auto doTestWorker = [&]<try_inflate_t inflateFunc>(
+                            const char* inputFileName, const char* outputFileName, std::size_t copyInterval) {
+        auto input = read_file(data_directory / inputFileName);
+        auto output = read_file(data_directory / outputFileName);
+        auto outputBuffer = std::make_unique<std::byte[]>(output.size);
+
+        // A copy, along with the input and output offsets at the point it was made
+        struct stream_copy
+        {
+            inflatelib::stream stream;
+            std::span<const std::byte> input;
+            std::size_t output_offset;
+        };
+
+        // Inflates the rest of the data using the copy and verifies it matches the output from the point it was made
+        auto finish = [&](stream_copy& copy) {
+            auto size = output.size - copy.output_offset;
+            auto buffer = std::make_unique<std::byte[]>(size);
+            std::span<std::byte> outputSpan = {buffer.get(), size};
+
+            copy.stream.set_call_budget(0, 0);
+            REQUIRE((copy.stream.*inflateFunc)(copy.input, outputSpan) == INFLATELIB_EOF);
+            REQUIRE(copy.input.empty());
+            REQUIRE(outputSpan.empty());
+            REQUIRE(std::memcmp(buffer.get(), output.buffer.get() + copy.output_offset, size) == 0);
+        };
+
+        // The call budget gives us places to copy the stream part of the way through. Each copy is kept alive while the
+        // original stream continues, which may rebuild the Huffman tables that the two share, before it is finished
+        inflatelib::stream stream;
+        stream.set_call_budget(copyInterval, 0);
+
+        std::span<const std::byte> inputSpan = {input.buffer.get(), input.size};
+        std::span<std::byte> outputSpan = {outputBuffer.get(), output.size};
+        std::optional<stream_copy> pending;
+        std::size_t copies = 0;
+        while (true)
+        {
+            auto result = (stream.*inflateFunc)(inputSpan, outputSpan);
+            REQUIRE(result >= INFLATELIB_OK);
+
+            if (pending)
+            {
+                finish(*pending);
+                pending.reset();
+            }
+
+            if (result == INFLATELIB_EOF)
+            {
+                break;
+            }
+
+            pending.emplace(stream, inputSpan, output.size - outputSpan.size());
+            ++copies;
+        }
+
+        REQUIRE(copies > 1);
+        REQUIRE(inputSpan.empty());
+        REQUIRE(outputSpan.empty());
+        REQUIRE(std::memcmp(outputBuffer.get(), output.buffer.get(), output.size) == 0);
+
+        // The copy can also continue after the original stream is destroyed
+        stream.reset();
+        stream.set_call_budget(copyInterval, 0);
+        inputSpan = {input.buffer.get(), input.size};
+        outputSpan = {outputBuffer.get(), output.size};
+        REQUIRE((stream.*inflateFunc)(inputSpan, outputSpan) == INFLATELIB_OK);
+
+        stream_copy copy = {stream, inputSpan, output.size - outputSpan.size()};
+        stream = inflatelib::stream{nullptr};
+        finish(copy);
+    };
+
+    auto doTest = [&](const char* inputFileName, const char* outputFileName, std::size_t copyInterval) {
+        doTestWorker.operator()<&inflatelib::stream::try_inflate>(inputFileName, outputFileName, copyInterval);
+    };
+
+    // Multiple blocks of various types, copied at many points including the middle of block headers and copies
+    doTest("mixed.simple.in.bin", "mixed.simple.out.bin", 3);
+
+    // Real world data with a full window
+    doTest("file.us-constitution.deflate.txt.in.bin", "file.us-constitution.txt.out.bin", 0x4000);
+
+#ifndef INFLATELIB_SMALL_FOOTPRINT
+    auto doTest64 = [&](const char* inputFileName, const char* outputFileName, std::size_t copyInterval) {
+        doTestWorker.operator()<&inflatelib::stream::try_inflate64>(inputFileName, outputFileName, copyInterval);
+    };
+
+    doTest64("mixed.overlap.deflate64.in.bin", "mixed.overlap.deflate64.out.bin", 97);
+    doTest64("static.multiple.deflate64.in.bin", "static.multiple.deflate64.out.bin", 5);
+    doTest64("dynamic.multiple.deflate64.in.bin", "dynamic.multiple.deflate64.out.bin", 5);
+    doTest64("file.us-constitution.deflate64.txt.in.bin", "file.us-constitution.txt.out.bin", 0x4000);
+#endif
+
+    // Errors are copied along with the rest of the state
+    auto input = read_file(data_directory / "dynamic.error.distance-oob.long.deflate.in.bin");
+    auto outputBuffer = std::make_unique<std::byte[]>(0x20000);
+    std::span<const std::byte> inputSpan = {input.buffer.get(), input.size};
+    std::span<std::byte> outputSpan = {outputBuffer.get(), 0x20000};
+
+    inflatelib::stream stream;
+    REQUIRE(stream.try_inflate(inputSpan, outputSpan) < INFLATELIB_OK);
+    std::string message = stream.error_detail();
+
+    inflatelib::stream copy(stream);
+    REQUIRE(copy.error_info().code == stream.error_info().code);
+    REQUIRE(copy.error_detail() == message);
+
+    // Copy assignment replaces the existing state
+    copy = inflatelib::stream(empty);
+    REQUIRE(!copy);
+    copy = stream;
+    REQUIRE(copy.error_detail() == message);
+}
+
+TEST_CASE("InflateLimits", "[inflate][inflate64]")
+{
+    inflatelib::stream stream;
+
+    // NOTE: Limits are specified as {max_output, max_ratio, max_blocks, max_tables}
+    // NOTE: We provide buffers large enough for all input/output, so we only need one call
+    auto doInflate = [&](const char* inputFileName, const inflatelib_limits& limits) {
+        auto input = read_file(data_directory / inputFileName);
+        auto outputBuffer = std::make_unique<std::byte[]>(0x50000);
+
+        stream.reset();
+        stream.set_limits(limits);
+
+        std::span<const std::byte> inputSpan = {input.buffer.get(), input.size};
+        std::span<std::byte> outputSpan = {outputBuffer.get(), 0x50000};
+        return stream.try_inflate(inputSpan, outputSpan);
+    };
+
+    auto requireLimitError = [&](int result, int code, std::uintmax_t limit) {
+        REQUIRE(result == INFLATELIB_ERROR_LIMIT);
+        auto info = stream.error_info();
+        REQUIRE(info.code == code);
+        REQUIRE(info.values[0] == limit);
+    };
+
+    // Output size
+    auto output = read_file(data_directory / "file.us-constitution.txt.out.bin");
+    REQUIRE(doInflate("file.us-constitution.deflate.txt.in.bin", {output.size, 0, 0, 0}) == INFLATELIB_EOF);
+    requireLimitError(
+        doInflate("file.us-constitution.deflate.txt.in.bin", {output.size - 1, 0, 0, 0}),
+        INFLATELIB_ERRCODE_OUTPUT_LIMIT,
+        output.size - 1);
+    requireLimitError(
+        doInflate("file.us-constitution.deflate.txt.in.bin", {1000, 0, 0, 0}), INFLATELIB_ERRCODE_OUTPUT_LIMIT, 1000);
+
+    // Compression ratio
+    REQUIRE(doInflate("file.us-constitution.deflate.txt.in.bin", {0, 10, 0, 0}) == INFLATELIB_EOF);
+    requireLimitError(doInflate("file.us-constitution.deflate.txt.in.bin", {0, 2, 0, 0}), INFLATELIB_ERRCODE_RATIO_LIMIT, 2);
+    REQUIRE(stream.error_info().values[1] > 2 * stream.error_info().values[2]);
+
+    // Block count; 'mixed.simple' has one uncompressed, one dynamic, and one static block
+    REQUIRE(doInflate("mixed.simple.in.bin", {0, 0, 3, 0}) == INFLATELIB_EOF);
+    requireLimitError(doInflate("mixed.simple.in.bin", {0, 0, 2, 0}), INFLATELIB_ERRCODE_BLOCK_LIMIT, 2);
+
+    // Table count; 'dynamic.multiple' has two dynamic blocks
+    REQUIRE(doInflate("dynamic.multiple.deflate.in.bin", {0, 0, 0, 2}) == INFLATELIB_EOF);
+    requireLimitError(doInflate("dynamic.multiple.deflate.in.bin", {0, 0, 0, 1}), INFLATELIB_ERRCODE_TABLE_LIMIT, 1);
+    REQUIRE(doInflate("mixed.simple.in.bin", {0, 0, 0, 1}) == INFLATELIB_EOF);
+
+    // Limits persist across reset. NOTE: 'doInflate' resets the stream before each call, so all of the successful calls
+    // above also verify that the counters do not persist across reset
+    auto input = read_file(data_directory / "mixed.simple.in.bin");
+    auto outputBuffer = std::make_unique<std::byte[]>(0x50000);
+    auto inflateAgain = [&] {
+        stream.reset();
+        std::span<const std::byte> inputSpan = {input.buffer.get(), input.size};
+        std::span<std::byte> outputSpan = {outputBuffer.get(), 0x50000};
+        return stream.try_inflate(inputSpan, outputSpan);
+    };
+
+    doInflate("mixed.simple.in.bin", {0, 0, 2, 0});
+    requireLimitError(inflateAgain(), INFLATELIB_ERRCODE_BLOCK_LIMIT, 2);
+
+    // Passing null removes all limits
+    REQUIRE(inflatelib_set_limits(stream.get(), nullptr) == INFLATELIB_OK);
+    REQUIRE(inflateAgain() == INFLATELIB_EOF);
+
+    // Limit errors surface as exceptions from the throwing overloads
+    stream.reset();
+    stream.set_limits({1, 0, 0, 0});
+    std::span<const std::byte> inputSpan = {input.buffer.get(), input.size};
+    std::span<std::byte> outputSpan = {outputBuffer.get(), 0x50000};
+    REQUIRE_THROWS_AS(stream.inflate(inputSpan, outputSpan), std::range_error);
+}
+
+TEST_CASE("InflateCallBudget", "[inflate][inflate64]")
+{
+    inflatelib::stream stream;
+
+    auto doTestWorker = [&]<try_inflate_t inflateFunc>(
+                            const char* inputFileName, const char* outputFileName, std::size_t maxOutput, std::size_t maxSymbols) {
+        auto input = read_file(data_directory / inputFileName);
+        auto output = read_file(data_directory / outputFileName);
+        auto outputBuffer = std::make_unique<std::byte[]>(output.size);
+
+        stream.reset();
+        stream.set_call_budget(maxOutput, maxSymbols);
+
+        // NOTE: The buffers are large enough for all input/output, so any additional calls are due to the budget
+        std::span<const std::byte> inputSpan = {input.buffer.get(), input.size};
+        std::span<std::byte> outputSpan = {outputBuffer.get(), output.size};
+        int result;
+        std::size_t calls = 0;
+        do
+        {
+            auto outputSizeBefore = outputSpan.size();
+            result = (stream.*inflateFunc)(inputSpan, outputSpan);
+            ++calls;
+
+            REQUIRE(result >= INFLATELIB_OK);
+            if (maxOutput)
+            {
+                REQUIRE((outputSizeBefore - outputSpan.size()) <= maxOutput);
+            }
+        } while (result == INFLATELIB_OK);
+
+        REQUIRE(result == INFLATELIB_EOF);
+        REQUIRE(inputSpan.empty());
+        REQUIRE(outputSpan.empty());
+        REQUIRE(std::memcmp(outputBuffer.get(), output.buffer.get(), output.size) == 0);
+        return calls;
+    };
+
+    auto doTest = [&](const char* inputFileName, const char* outputFileName, std::size_t maxOutput, std::size_t maxSymbols) {
+        return doTestWorker.operator()<&inflatelib::stream::try_inflate>(inputFileName, outputFileName, maxOutput, maxSymbols);
+    };
+#ifndef INFLATELIB_SMALL_FOOTPRINT
+    auto doTest64 = [&](const char* inputFileName, const char* outputFileName, std::size_t maxOutput, std::size_t maxSymbols) {
+        return doTestWorker.operator()<&inflatelib::stream::try_inflate64>(inputFileName, outputFileName, maxOutput, maxSymbols);
+    };
+#endif
+
+    // No budget means a single call is sufficient
+    REQUIRE(doTest("file.us-constitution.deflate.txt.in.bin", "file.us-constitution.txt.out.bin", 0, 0) == 1);
+
+    // The US Constitution inflates to ~290KB
+    REQUIRE(doTest("file.us-constitution.deflate.txt.in.bin", "file.us-constitution.txt.out.bin", 4096, 0) >= (298072 / 4096));
+    REQUIRE(doTest("file.us-constitution.deflate.txt.in.bin", "file.us-constitution.txt.out.bin", 0, 1000) > 1);
+#ifndef INFLATELIB_SMALL_FOOTPRINT
+    REQUIRE(doTest64("file.us-constitution.deflate64.txt.in.bin", "file.us-constitution.txt.out.bin", 1, 0) == 298072);
+    REQUIRE(doTest64("file.us-constitution.deflate64.txt.in.bin", "file.us-constitution.txt.out.bin", 0, 1) > 1);
+#endif
+
+    // Multiple blocks of various types
+    REQUIRE(doTest("mixed.simple.in.bin", "mixed.simple.out.bin", 100, 10) > 1);
+#ifndef INFLATELIB_SMALL_FOOTPRINT
+    REQUIRE(doTest64("mixed.overlap.deflate64.in.bin", "mixed.overlap.deflate64.out.bin", 0, 1) > 1);
+#endif
+}
+
+TEST_CASE("InflatePhaseTimes", "[inflate]")
+{
+    inflatelib_phase_times times = {};
+
+    inflatelib_stream uninitialized = {};
+    REQUIRE(inflatelib_get_phase_times(&uninitialized, &times) == INFLATELIB_ERROR_ARG);
+
+    inflatelib::stream stream;
+    if (inflatelib_get_phase_times(stream.get(), &times) != INFLATELIB_OK)
+    {
+        return; // The library was built without 'INFLATELIB_PHASE_TIMING'
+    }
+
+    auto requireNoTime = [&] {
+        REQUIRE(inflatelib_get_phase_times(stream.get(), &times) == INFLATELIB_OK);
+        for (auto ticks : times.ticks)
+        {
+            REQUIRE(ticks == 0);
+        }
+    };
+    requireNoTime();
+
+    auto input = read_file(data_directory / "file.us-constitution.deflate.txt.in.bin");
+    auto output = read_file(data_directory / "file.us-constitution.txt.out.bin");
+    auto outputBuffer = std::make_unique<std::byte[]>(output.size);
+    std::span<const std::byte> inputSpan = {input.buffer.get(), input.size};
+    std::span<std::byte> outputSpan = {outputBuffer.get(), output.size};
+    REQUIRE(stream.try_inflate(inputSpan, outputSpan) == INFLATELIB_EOF);
+
+    // Nearly all of this file is decoded by the fast path
+    REQUIRE(inflatelib_get_phase_times(stream.get(), &times) == INFLATELIB_OK);
+    REQUIRE(times.ticks[INFLATELIB_PHASE_FAST_DECODE] > 0);
+
+    // Times are cleared on reset
+    stream.reset();
+    requireNoTime();
+}
+
+TEST_CASE("InflateScatterGather", "[inflate][inflate64]")
+{
+    inflatelib::stream stream;
+
+    using try_inflatev_t =
+        int (inflatelib::stream::*)(std::span<inflatelib_input_buffer>, std::span<inflatelib_output_buffer>) noexcept;
+    auto doTestWorker = [&]<try_inflatev_t inflateFunc>(
+                            const char* inputFileName, const char* outputFileName, std::size_t inputStride, std::size_t outputStride) {
+        auto input = read_file(data_directory / inputFileName);
+        auto output = read_file(data_directory / outputFileName);
+        auto outputBuffer = std::make_unique<std::byte[]>(output.size);
+
+        // Break the input/output into fragments, with some empty ones mixed in
+        std::vector<inflatelib_input_buffer> inputs;
+        for (std::size_t i = 0; i < input.size; i += inputStride)
+        {
+            inputs.push_back({input.buffer.get() + i, std::min(inputStride, input.size - i)});
+            inputs.push_back({nullptr, 0});
+        }
+
+        std::vector<inflatelib_output_buffer> outputs;
+        for (std::size_t i = 0; i < output.size; i += outputStride)
+        {
+            outputs.push_back({nullptr, 0});
+            outputs.push_back({outputBuffer.get() + i, std::min(outputStride, output.size - i)});
+        }
+
+        // NOTE: 'total_out' is not cleared by reset
+        stream.reset();
+        auto totalOutBefore = stream.get()->total_out;
+        REQUIRE((stream.*inflateFunc)(inputs, outputs) == INFLATELIB_EOF);
+        REQUIRE((stream.get()->total_out - totalOutBefore) == output.size);
+        REQUIRE(std::memcmp(outputBuffer.get(), output.buffer.get(), output.size) == 0);
+        REQUIRE(std::all_of(inputs.begin(), inputs.end(), [](auto& buffer) { return buffer.size == 0; }));
+        REQUIRE(std::all_of(outputs.begin(), outputs.end(), [](auto& buffer) { return buffer.size == 0; }));
+    };
+
+    auto doTest = [&](const char* inputFileName, const char* outputFileName, std::size_t inputStride, std::size_t outputStride) {
+        doTestWorker.operator()<&inflatelib::stream::try_inflatev>(inputFileName, outputFileName, inputStride, outputStride);
+    };
+#ifndef INFLATELIB_SMALL_FOOTPRINT
+    auto doTest64 = [&](const char* inputFileName, const char* outputFileName, std::size_t inputStride, std::size_t outputStride) {
+        doTestWorker.operator()<&inflatelib::stream::try_inflatev64>(inputFileName, outputFileName, inputStride, outputStride);
+    };
+#endif
+
+    for (std::size_t inputStride : {1, 7, 1500})
+    {
+        for (std::size_t outputStride : {1, 100, 4096})
+        {
+            doTest("file.us-constitution.deflate.txt.in.bin", "file.us-constitution.txt.out.bin", inputStride, outputStride);
+            doTest("mixed.simple.in.bin", "mixed.simple.out.bin", inputStride, outputStride);
+#ifndef INFLATELIB_SMALL_FOOTPRINT
+            doTest64("file.us-constitution.deflate64.txt.in.bin", "file.us-constitution.txt.out.bin", inputStride, outputStride);
+            doTest64("mixed.overlap.deflate64.in.bin", "mixed.overlap.deflate64.out.bin", inputStride, outputStride);
+#endif
+        }
+    }
+
+    // Running out of output space returns OK, and the remaining input is left in the input buffers
+    auto input = read_file(data_directory / "file.us-constitution.deflate.txt.in.bin");
+    auto output = read_file(data_directory / "file.us-constitution.txt.out.bin");
+    auto outputBuffer = std::make_unique<std::byte[]>(output.size);
+    inflatelib_input_buffer inputs[] = {
+        {input.buffer.get(), input.size / 2}, {input.buffer.get() + input.size / 2, input.size - input.size / 2}};
+    inflatelib_output_buffer outputs[] = {{outputBuffer.get(), 1000}, {outputBuffer.get() + 1000, 1000}};
+
+    stream.reset();
+    REQUIRE(stream.try_inflatev(inputs, outputs) == INFLATELIB_OK);
+    REQUIRE(outputs[0].size == 0);
+    REQUIRE(outputs[1].size == 0);
+    REQUIRE(inputs[1].size == input.size - input.size / 2);
+
+    // The remaining data can be read using the single buffer functions
+    std::span<const std::byte> inputSpan = {static_cast<const std::byte*>(inputs[0].data), inputs[0].size};
+    std::span<std::byte> outputSpan = {outputBuffer.get() + 2000, output.size - 2000};
+    REQUIRE(stream.try_inflate(inputSpan, outputSpan) == INFLATELIB_OK);
+    REQUIRE(inputSpan.empty());
+    REQUIRE(stream.inflatev(std::span(inputs + 1, 1), std::span<inflatelib_output_buffer>{}) == true);
+    inputSpan = {static_cast<const std::byte*>(inputs[1].data), inputs[1].size};
+    REQUIRE(stream.try_inflate(inputSpan, outputSpan) == INFLATELIB_EOF);
+    REQUIRE(std::memcmp(outputBuffer.get(), output.buffer.get(), output.size) == 0);
+
+    // The per-call budget applies to the call as a whole
+    stream.reset();
+    stream.set_call_budget(1500, 0);
+    auto totalOutBefore = stream.get()->total_out;
+    inputs[0] = {input.buffer.get(), input.size};
+    outputs[0] = {outputBuffer.get(), 1000};
+    outputs[1] = {outputBuffer.get() + 1000, 1000};
+    REQUIRE(stream.try_inflatev(std::span(inputs, 1), outputs) == INFLATELIB_OK);
+    REQUIRE((stream.get()->total_out - totalOutBefore) == 1500);
+    REQUIRE(outputs[1].size == 500);
+}
+
+TEST_CASE("InflateAll", "[inflate][inflate64]")
+{
+    auto input = read_file(data_directory / "file.us-constitution.deflate.txt.in.bin");
+    auto output = read_file(data_directory / "file.us-constitution.txt.out.bin");
+    std::span<const std::byte> inputSpan = {input.buffer.get(), input.size};
+#ifndef INFLATELIB_SMALL_FOOTPRINT
+    auto input64 = read_file(data_directory / "file.us-constitution.deflate64.txt.in.bin");
+    std::span<const std::byte> input64Span = {input64.buffer.get(), input64.size};
+#endif
+
+    auto verify = [&](const auto& container) {
+        REQUIRE(container.size() == output.size);
+        REQUIRE(std::memcmp(container.data(), output.buffer.get(), output.size) == 0);
+    };
+
+    // Various size hints: none, exact, too small, and too large
+    for (std::size_t sizeHint : {std::size_t{0}, output.size, std::size_t{1}, output.size / 3, output.size * 2})
+    {
+        verify(inflatelib::inflate_all(inputSpan, sizeHint));
+        verify(inflatelib::inflate_all<std::string>(inputSpan, sizeHint));
+#ifndef INFLATELIB_SMALL_FOOTPRINT
+        verify(inflatelib::inflate64_all(input64Span, sizeHint));
+#endif
+    }
+
+    // An exact size hint should not require the container to grow
+    auto vec = inflatelib::inflate_all(inputSpan, output.size);
+    REQUIRE(vec.capacity() == output.size);
+
+    // Output allocated from a user supplied memory resource
+    std::pmr::monotonic_buffer_resource resource;
+    auto pmrVec = inflatelib::inflate_all(inputSpan, 0, &resource);
+    verify(pmrVec);
+    REQUIRE(pmrVec.get_allocator().resource() == &resource);
+
+    // Appending to existing data using a stream, leaving trailing data in the input
+    inflatelib::stream stream;
+    std::string str = "prefix";
+    auto trailingInput = read_file(data_directory / "extra.static.in.bin");
+    std::span<const std::byte> trailingSpan = {trailingInput.buffer.get(), trailingInput.size};
+    stream.inflate_all(trailingSpan, str);
+    REQUIRE(str.starts_with("prefix"));
+    REQUIRE(!trailingSpan.empty());
+
+    // Truncated input
+    REQUIRE_THROWS_AS(inflatelib::inflate_all(inputSpan.first(inputSpan.size() / 2)), std::runtime_error);
+
+    // Errors in the data
+    auto errInput = read_file(data_directory / "error.invalid-block-type.in.bin");
+    REQUIRE_THROWS_AS(inflatelib::inflate_all({errInput.buffer.get(), errInput.size}), std::runtime_error);
+
+    SECTION("Call budget")
+    {
+        // The budget can stop a call after all of the input has been consumed but before all of the output is written,
+        // which must not be mistaken for truncated input
+        for (std::size_t maxOutput : {std::size_t{1}, std::size_t{7}, std::size_t{4096}})
+        {
+            std::vector<std::byte> result;
+            std::span<const std::byte> budgetSpan = inputSpan;
+            stream.reset();
+            stream.set_call_budget(maxOutput, 0);
+            stream.inflate_all(budgetSpan, result);
+            verify(result);
+            REQUIRE(budgetSpan.empty());
+
+            budgetSpan = inputSpan.first(inputSpan.size() / 2);
+            result.clear();
+            stream.reset();
+            REQUIRE_THROWS_AS(stream.inflate_all(budgetSpan, result), std::runtime_error);
+        }
+    }
+}
+
+// Memory resource that tracks outstanding allocations and verifies that the requested alignment is honored
+struct tracking_resource : std::pmr::memory_resource
+{
+    std::size_t outstanding = 0;
+    std::size_t allocations = 0;
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        auto result = std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        REQUIRE((reinterpret_cast<std::uintptr_t>(result) % alignment) == 0);
+        outstanding += bytes;
+        ++allocations;
+        return result;
+    }
+
+    void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override
+    {
+        REQUIRE(outstanding >= bytes);
+        outstanding -= bytes;
+        std::pmr::new_delete_resource()->deallocate(ptr, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+// Stateful allocator that forwards to a 'tracking_resource'
+template <typename T>
+struct tracking_allocator
+{
+    using value_type = T;
+
+    tracking_resource* resource;
+
+    tracking_allocator(tracking_resource* resource) : resource(resource)
+    {
+    }
+
+    template <typename U>
+    tracking_allocator(const tracking_allocator<U>& other) : resource(other.resource)
+    {
+    }
+
+    T* allocate(std::size_t count)
+    {
+        return static_cast<T*>(resource->allocate(count * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* ptr, std::size_t count)
+    {
+        resource->deallocate(ptr, count * sizeof(T), alignof(T));
+    }
+
+    bool operator==(const tracking_allocator&) const = default;
+};
+
+TEST_CASE("InflateStreamAllocators", "[inflate]")
+{
+    auto input = read_file(data_directory / "file.us-constitution.deflate.txt.in.bin");
+    auto output = read_file(data_directory / "file.us-constitution.txt.out.bin");
+    std::span<const std::byte> inputSpan = {input.buffer.get(), input.size};
+
+    auto verify = [&](inflatelib::stream& stream) {
+        stream.reset();
+        std::vector<std::byte> result;
+        auto span = inputSpan;
+        stream.inflate_all(span, result, output.size);
+        REQUIRE(result.size() == output.size);
+        REQUIRE(std::memcmp(result.data(), output.buffer.get(), output.size) == 0);
+    };
+
+    tracking_resource resource;
+    SECTION("std::pmr::memory_resource")
+    {
+        inflatelib::stream stream(&resource);
+        REQUIRE(resource.outstanding > 0);
+        verify(stream);
+
+        // Moving the stream transfers ownership of the allocations
+        inflatelib::stream other(std::move(stream));
+        verify(other);
+        stream = std::move(other);
+        verify(stream);
+
+        // Copies allocate from the same resource
+        inflatelib::stream copy(stream);
+        verify(copy);
+        verify(stream);
+    }
+
+    SECTION("Stateful allocator")
+    {
+        inflatelib::stream stream{tracking_allocator<int>(&resource)};
+        REQUIRE(resource.outstanding > 0);
+        verify(stream);
+
+        inflatelib::stream other(std::move(stream));
+        verify(other);
+
+        // Copies get their own copy of the allocator
+        inflatelib::stream copy(other);
+        REQUIRE(copy.get()->user_data != other.get()->user_data);
+        verify(copy);
+        verify(other);
+    }
+
+    SECTION("std::pmr::polymorphic_allocator")
+    {
+        inflatelib::stream stream{std::pmr::polymorphic_allocator<std::byte>(&resource)};
+        REQUIRE(resource.outstanding > 0);
+        verify(stream);
+    }
+
+    SECTION("Stateless allocator")
+    {
+        inflatelib::stream stream(std::allocator<std::byte>{});
+        verify(stream);
+    }
+
+    SECTION("inflate_all with a memory resource")
+    {
+        auto result = inflatelib::inflate_all(inputSpan, output.size, &resource);
+        REQUIRE(result.size() == output.size);
+        REQUIRE(resource.outstanding == output.size); // Only the output should remain
+    }
+
+    // All memory should have been freed
+    REQUIRE(resource.outstanding == 0);
+
+    // Arena allocators can reclaim the stream's state along with the rest of the arena
+    std::pmr::monotonic_buffer_resource arena;
+    inflatelib::stream arenaStream(&arena);
+    verify(arenaStream);
+}
+
+#if INFLATELIB_HAS_COROUTINES
+TEST_CASE("InflateChunks", "[inflate][inflate64]")
+{
+    auto input = read_file(data_directory / "file.us-constitution.deflate.txt.in.bin");
+    auto input64 = read_file(data_directory / "file.us-constitution.deflate64.txt.in.bin");
+    auto output = read_file(data_directory / "file.us-constitution.txt.out.bin");
+
+    // Split the input into chunks of various sizes to simulate data arriving incrementally
+    auto split = [](const file_contents& contents, std::size_t chunkSize) {
+        std::vector<std::span<const std::byte>> result;
+        for (std::size_t offset = 0; offset < contents.size; offset += chunkSize)
+        {
+            result.emplace_back(contents.buffer.get() + offset, std::min(chunkSize, contents.size - offset));
+        }
+        return result;
+    };
+
+    auto collect = [](auto&& gen) {
+        std::vector<std::byte> result;
+        for (auto chunk : gen)
+        {
+            REQUIRE(!chunk.empty());
+            result.insert(result.end(), chunk.begin(), chunk.end());
+        }
+        return result;
+    };
+
+    auto verify = [&](const std::vector<std::byte>& result) {
+        REQUIRE(result.size() == output.size);
+        REQUIRE(std::memcmp(result.data(), output.buffer.get(), output.size) == 0);
+    };
+
+    inflatelib::stream stream;
+    for (std::size_t chunkSize : {std::size_t{1}, std::size_t{1000}, input.size})
+    {
+        for (std::size_t bufferSize : {std::size_t{1}, std::size_t{4096}, inflatelib::default_chunk_size})
+        {
+            stream.reset();
+            verify(collect(inflatelib::inflate_chunks(stream, split(input, chunkSize), bufferSize)));
+
+#ifndef INFLATELIB_SMALL_FOOTPRINT
+            stream.reset();
+            verify(collect(inflatelib::inflate64_chunks(stream, split(input64, chunkSize), bufferSize)));
+#endif
+        }
+    }
+
+    // Buffer sizes that are not a multiple of the chunk size should still yield every byte
+    stream.reset();
+    auto chunks = split(input, 777);
+    verify(collect(inflatelib::inflate_chunks(stream, std::views::all(chunks), 333)));
+
+    // The call budget can stop a call after a chunk has been consumed but before all of its output has been written
+    for (std::size_t maxOutput : {std::size_t{1}, std::size_t{7}, std::size_t{4096}})
+    {
+        stream.reset();
+        stream.set_call_budget(maxOutput, 0);
+        verify(collect(inflatelib::inflate_chunks(stream, split(input, 1000))));
+    }
+    stream.set_call_budget(0, 0);
+
+    // Truncated input
+    stream.reset();
+    chunks.resize(chunks.size() / 2);
+    REQUIRE_THROWS_AS(collect(inflatelib::inflate_chunks(stream, chunks)), std::runtime_error);
+
+    // Errors in the data
+    stream.reset();
+    auto errInput = read_file(data_directory / "error.invalid-block-type.in.bin");
+    REQUIRE_THROWS_AS(collect(inflatelib::inflate_chunks(stream, split(errInput, 1))), std::runtime_error);
+
+    // Abandoning the generator part way through should release its resources
+    tracking_resource resource;
+    {
+        stream.reset();
+        auto gen = inflatelib::inflate_chunks(
+            std::allocator_arg, std::pmr::polymorphic_allocator<std::byte>(&resource), stream, split(input, 1000), 4096);
+        REQUIRE(resource.outstanding > 0); // Coroutine frame
+        auto itr = gen.begin();
+        REQUIRE(resource.outstanding > 4096); // Output buffer
+        REQUIRE(itr != gen.end());
+        REQUIRE(!(*itr).empty());
+        ++itr;
+    }
+    REQUIRE(resource.outstanding == 0);
+
+    {
+        stream.reset();
+        auto gen = inflatelib::inflate_chunks(std::allocator_arg, tracking_allocator<int>(&resource), stream, split(input, 1000));
+        verify(collect(gen));
+    }
+    REQUIRE(resource.allocations > 0);
+    REQUIRE(resource.outstanding == 0);
+}
+#endif
+
+TEST_CASE("InflateIStreamBuf", "[inflate][inflate64]")
+{
+    auto input = read_file(data_directory / "file.us-constitution.deflate.txt.in.bin");
+    auto input64 = read_file(data_directory / "file.us-constitution.deflate64.txt.in.bin");
+    auto output = read_file(data_directory / "file.us-constitution.txt.out.bin");
+    std::span<const std::byte> inputSpan = {input.buffer.get(), input.size};
+    std::string_view expected(reinterpret_cast<const char*>(output.buffer.get()), output.size);
+
+    auto to_string = [](const file_contents& contents) {
+        return std::string(reinterpret_cast<const char*>(contents.buffer.get()), contents.size);
+    };
+
+    // Reads the whole stream using reads of 'readSize' bytes at a time
+    auto read_all = [](std::istream& stream, std::size_t readSize) {
+        std::string result;
+        std::vector<char> buffer(readSize);
+        while (stream.read(buffer.data(), buffer.size()) || (stream.gcount() > 0))
+        {
+            result.append(buffer.data(), static_cast<std::size_t>(stream.gcount()));
+        }
+        return result;
+    };
+
+    for (std::size_t bufferSize : {std::size_t{1}, std::size_t{100}, inflatelib::default_chunk_size})
+    {
+        // Read sizes both smaller and larger than the internal buffer, exercising both paths through 'xsgetn'
+        for (std::size_t readSize : {std::size_t{1}, std::size_t{1000}, std::size_t{100000}})
+        {
+            std::istringstream source(to_string(input));
+            inflatelib::istreambuf buf(*source.rdbuf(), inflatelib::format::deflate, bufferSize);
+            std::istream stream(&buf);
+            REQUIRE(read_all(stream, readSize) == expected);
+            REQUIRE(stream.eof());
+            REQUIRE(!stream.bad());
+
+#ifndef INFLATELIB_SMALL_FOOTPRINT
+            std::istringstream source64(to_string(input64));
+            inflatelib::istreambuf buf64(*source64.rdbuf(), inflatelib::format::deflate64, bufferSize);
+            std::istream stream64(&buf64);
+            REQUIRE(read_all(stream64, readSize) == expected);
+#endif
+        }
+    }
+
+    // Reading from memory, one character and one line at a time
+    {
+        inflatelib::istreambuf buf(inputSpan);
+        std::istream stream(&buf);
+        std::string result(std::istreambuf_iterator<char>(stream), {});
+        REQUIRE(result == expected);
+    }
+
+    {
+        inflatelib::istreambuf buf(inputSpan, inflatelib::format::deflate, 256);
+        std::istream stream(&buf);
+        std::string result;
+        for (std::string line; std::getline(stream, line);)
+        {
+            result += line;
+            result += '\n';
+        }
+        REQUIRE(result.starts_with(expected.substr(0, expected.size() - 1)));
+    }
+
+    // Truncated input sets badbit, or throws if requested
+    {
+        inflatelib::istreambuf buf(inputSpan.first(inputSpan.size() / 2));
+        std::istream stream(&buf);
+        auto result = read_all(stream, 1000);
+        REQUIRE(stream.bad());
+        REQUIRE(expected.starts_with(result));
+    }
+
+    {
+        std::istringstream source(to_string(input).substr(0, input.size / 2));
+        inflatelib::istreambuf buf(*source.rdbuf());
+        std::istream stream(&buf);
+        stream.exceptions(std::ios_base::badbit);
+        REQUIRE_THROWS_AS(read_all(stream, 1000), std::runtime_error);
+    }
+
+    // Errors in the data
+    {
+        auto errInput = read_file(data_directory / "error.invalid-block-type.in.bin");
+        inflatelib::istreambuf buf({errInput.buffer.get(), errInput.size});
+        std::istream stream(&buf);
+        stream.exceptions(std::ios_base::badbit);
+        REQUIRE_THROWS_AS(read_all(stream, 1), std::runtime_error);
+    }
+
+    // Limits configured on the underlying stream apply
+    {
+        inflatelib::istreambuf buf(inputSpan);
+        inflatelib_limits limits = {1000, 0, 0, 0};
+        buf.get_stream().set_limits(limits);
+        std::istream stream(&buf);
+        stream.exceptions(std::ios_base::badbit);
+        REQUIRE_THROWS_AS(read_all(stream, 1000), std::range_error);
+    }
+}
+
+TEST_CASE("InflateZipReader", "[inflate][inflate64]")
+{
+    auto input = read_file(data_directory / "file.us-constitution.deflate.txt.in.bin");
+    auto output = read_file(data_directory / "file.us-constitution.txt.out.bin");
+    std::span<const std::byte> inputSpan = {input.buffer.get(), input.size};
+#ifndef INFLATELIB_SMALL_FOOTPRINT
+    auto input64 = read_file(data_directory / "file.us-constitution.deflate64.txt.in.bin");
+    std::uint16_t method64 = 9;
+    std::span<const std::byte> inputSpan64 = {input64.buffer.get(), input64.size};
+#else
+    // Deflate64 is not supported, so the entries that would use it are compressed with Deflate instead
+    std::uint16_t method64 = 8;
+    std::span<const std::byte> inputSpan64 = inputSpan;
+#endif
+    std::span<const std::byte> outputSpan = {output.buffer.get(), output.size};
+    std::string_view expected(reinterpret_cast<const char*>(output.buffer.get()), output.size);
+
+    enum class descriptor
+    {
+        none,
+        with_signature,
+        without_signature,
+        zip64,
+    };
+
+    // Builds an archive as it would be written by a streaming encoder, which can't go back and fill in the sizes
+    auto append_le = [](std::string& archive, std::uint64_t value, std::size_t size) {
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            archive.push_back(static_cast<char>((value >> (i * 8)) & 0xFF));
+        }
+    };
+    auto append_entry = [&](std::string& archive,
+                            std::string_view name,
+                            std::uint16_t method,
+                            std::span<const std::byte> data,
+                            std::size_t uncompressedSize,
+                            descriptor desc) {
+        bool deferred = desc != descriptor::none;
+        append_le(archive, 0x04034b50, 4);
+        append_le(archive, 20, 2);
+        append_le(archive, deferred ? 0x0008 : 0, 2);
+        append_le(archive, method, 2);
+        append_le(archive, 0, 4); // Time & date
+        append_le(archive, 0x12345678, 4);
+        append_le(archive, deferred ? 0 : data.size(), 4);
+        append_le(archive, deferred ? 0 : uncompressedSize, 4);
+        append_le(archive, name.size(), 2);
+        append_le(archive, (desc == descriptor::zip64) ? 20 : 0, 2);
+        archive += name;
+        if (desc == descriptor::zip64)
+        {
+            append_le(archive, 0x0001, 2);
+            append_le(archive, 16, 2);
+            append_le(archive, 0, 8); // Uncompressed size
+            append_le(archive, 0, 8); // Compressed size
+        }
+        archive.append(reinterpret_cast<const char*>(data.data()), data.size());
+
+        if (deferred)
+        {
+            if (desc != descriptor::without_signature)
+            {
+                append_le(archive, 0x08074b50, 4);
+            }
+            std::size_t sizeBytes = (desc == descriptor::zip64) ? 8 : 4;
+            append_le(archive, 0x12345678, 4);
+            append_le(archive, data.size(), sizeBytes);
+            append_le(archive, uncompressedSize, sizeBytes);
+        }
+    };
+
+    std::string archive;
+    append_entry(archive, "deflate.txt", 8, inputSpan, output.size, descriptor::with_signature);
+    append_entry(archive, "deflate64.txt", method64, inputSpan64, output.size, descriptor::without_signature);
+    append_entry(archive, "zip64.txt", 8, inputSpan, output.size, descriptor::zip64);
+    append_entry(archive, "stored.txt", 0, outputSpan, output.size, descriptor::none);
+    append_entry(archive, "sized.txt", method64, inputSpan64, output.size, descriptor::none);
+    append_le(archive, 0x02014b50, 4); // Start of the central directory, which is never read
+    archive.append(42, '\0');
+
+    auto as_bytes = [](const std::string& data) {
+        return std::span<const std::byte>(reinterpret_cast<const std::byte*>(data.data()), data.size());
+    };
+
+    const std::string_view names[] = {"deflate.txt", "deflate64.txt", "zip64.txt", "stored.txt", "sized.txt"};
+
+    auto read_entry = [](inflatelib::zip_reader& reader, std::size_t readSize) {
+        std::string result;
+        std::vector<std::byte> buffer(readSize);
+        while (auto bytesRead = reader.read(buffer))
+        {
+            result.append(reinterpret_cast<const char*>(buffer.data()), bytesRead);
+        }
+        return result;
+    };
+
+    auto read_archive = [&](inflatelib::zip_reader& reader, std::size_t readSize, bool skipOdd) {
+        std::size_t index = 0;
+        for (; reader.next_entry(); ++index)
+        {
+            REQUIRE(index < std::size(names));
+            REQUIRE(reader.entry().name == names[index]);
+            if (skipOdd && (index % 2))
+            {
+                continue;
+            }
+
+            REQUIRE(read_entry(reader, readSize) == expected);
+            REQUIRE(reader.entry().crc32 == 0x12345678);
+            REQUIRE(reader.entry().uncompressed_size == output.size);
+        }
+        REQUIRE(index == std::size(names));
+        REQUIRE(!reader.next_entry());
+    };
+
+    for (std::size_t bufferSize : {std::size_t{1}, std::size_t{100}, inflatelib::default_chunk_size})
+    {
+        for (std::size_t readSize : {std::size_t{1}, std::size_t{1000}, std::size_t{100000}})
+        {
+            std::istringstream source(archive);
+            inflatelib::zip_reader reader(*source.rdbuf(), bufferSize);
+            read_archive(reader, readSize, false);
+        }
+
+        std::istringstream source(archive);
+        inflatelib::zip_reader reader(*source.rdbuf(), bufferSize);
+        read_archive(reader, 1000, true);
+    }
+
+    {
+        inflatelib::zip_reader reader(as_bytes(archive));
+        read_archive(reader, 1000, false);
+    }
+
+    // Truncated archives
+    {
+        std::istringstream source(archive.substr(0, archive.size() / 2));
+        inflatelib::zip_reader reader(*source.rdbuf());
+        REQUIRE_THROWS_AS(
+            [&] {
+                while (reader.next_entry())
+                {
+                }
+            }(),
+            std::runtime_error);
+    }
+
+    // Stored entries need their size in the local header
+    {
+        std::string stored;
+        append_entry(stored, "stored.txt", 0, outputSpan, output.size, descriptor::with_signature);
+        inflatelib::zip_reader reader(as_bytes(stored));
+        REQUIRE(reader.next_entry());
+        REQUIRE_THROWS_AS(read_entry(reader, 1000), std::runtime_error);
+    }
+
+    // Sizes in the data descriptor must match the data
+    {
+        std::string mismatch;
+        append_entry(mismatch, "deflate.txt", 8, inputSpan, output.size + 1, descriptor::with_signature);
+        inflatelib::zip_reader reader(as_bytes(mismatch));
+        REQUIRE(reader.next_entry());
+        REQUIRE_THROWS_AS(read_entry(reader, 1000), std::runtime_error);
+    }
+}
+
+TEST_CASE("InflateExecutor", "[inflate][inflate64]")
+{
+    // A mix of large and small jobs
+    struct test_file
+    {
+        file_contents input;
+        file_contents output;
+        inflatelib::format fmt;
+    };
+    std::vector<test_file> files;
+    auto add_file = [&](const char* input, const char* output, inflatelib::format fmt) {
+        files.push_back({read_file(data_directory / input), read_file(data_directory / output), fmt});
+    };
+    add_file("file.us-constitution.deflate.txt.in.bin", "file.us-constitution.txt.out.bin", inflatelib::format::deflate);
+    add_file("dynamic.multiple.deflate.in.bin", "dynamic.multiple.deflate.out.bin", inflatelib::format::deflate);
+#ifndef INFLATELIB_SMALL_FOOTPRINT
+    add_file("file.us-constitution.deflate64.txt.in.bin", "file.us-constitution.txt.out.bin", inflatelib::format::deflate64);
+    add_file("dynamic.single.deflate64.in.bin", "dynamic.single.deflate64.out.bin", inflatelib::format::deflate64);
+#endif
+    add_file("extra.static.in.bin", "extra.static.out.bin", inflatelib::format::deflate);
+    add_file("dynamic.empty.in.bin", "dynamic.empty.out.bin", inflatelib::format::deflate);
+
+    auto verify = [](const test_file& file, std::span<const std::byte> result) {
+        REQUIRE(result.size() == file.output.size);
+        if (file.output.size > 0) // The buffer is null for empty files
+        {
+            REQUIRE(std::memcmp(result.data(), file.output.buffer.get(), file.output.size) == 0);
+        }
+    };
+
+    constexpr std::size_t repeat = 8;
+    inflatelib::executor exec(4);
+    REQUIRE(exec.thread_count() == 4);
+
+    SECTION("Futures")
+    {
+        std::vector<std::vector<std::byte>> outputs;
+        std::vector<inflatelib::executor::job> jobs;
+        for (std::size_t i = 0; i < repeat; ++i)
+        {
+            for (auto& file : files)
+            {
+                auto& output = outputs.emplace_back(file.output.size);
+                jobs.push_back({{file.input.buffer.get(), file.input.size}, output, {}, file.fmt});
+            }
+        }
+
+        // Submit the first half individually and the second half as a batch
+        std::vector<std::future<inflatelib::executor::job_result>> futures;
+        for (std::size_t i = 0; i < jobs.size() / 2; ++i)
+        {
+            futures.push_back(exec.submit(jobs[i]));
+        }
+        auto batch = exec.submit_batch({jobs.begin() + jobs.size() / 2, jobs.end()});
+        std::move(batch.begin(), batch.end(), std::back_inserter(futures));
+
+        REQUIRE(futures.size() == jobs.size());
+        for (std::size_t i = 0; i < futures.size(); ++i)
+        {
+            auto& file = files[i % files.size()];
+            auto result = futures[i].get();
+            REQUIRE(result.output_written == file.output.size);
+            REQUIRE(result.input_consumed <= file.input.size);
+            REQUIRE(result.queue_wait.count() >= 0);
+            REQUIRE(result.run_time.count() >= 0);
+            verify(file, outputs[i]);
+        }
+    }
+
+    SECTION("Sinks and completion callbacks")
+    {
+        std::vector<std::vector<std::byte>> outputs(files.size() * repeat);
+        std::vector<inflatelib::executor::job_result> results(outputs.size());
+        std::atomic<std::size_t> completed = 0;
+        for (std::size_t i = 0; i < outputs.size(); ++i)
+        {
+            auto& file = files[i % files.size()];
+            auto sink = [&output = outputs[i]](std::span<const std::byte> data) {
+                output.insert(output.end(), data.begin(), data.end());
+            };
+            exec.submit({{file.input.buffer.get(), file.input.size}, {}, sink, file.fmt}, [&, i](const auto& result) {
+                results[i] = result;
+                completed.fetch_add(1, std::memory_order_release);
+            });
+        }
+
+        while (completed.load(std::memory_order_acquire) != outputs.size())
+        {
+            std::this_thread::yield();
+        }
+
+        for (std::size_t i = 0; i < outputs.size(); ++i)
+        {
+            REQUIRE(!results[i].error);
+            REQUIRE(results[i].output_written == outputs[i].size());
+            verify(files[i % files.size()], outputs[i]);
+        }
+    }
+
+    SECTION("Errors")
+    {
+        auto& file = files[0];
+        std::span<const std::byte> input = {file.input.buffer.get(), file.input.size};
+        std::vector<std::byte> output(file.output.size + 1);
+
+        // Output buffer too small, including when only the last byte doesn't fit
+        auto tooSmall = exec.submit({input, std::span(output).first(file.output.size / 2), {}, inflatelib::format::deflate});
+        REQUIRE_THROWS_AS(tooSmall.get(), std::length_error);
+        auto offByOne = exec.submit({input, std::span(output).first(file.output.size - 1), {}, inflatelib::format::deflate});
+        REQUIRE_THROWS_AS(offByOne.get(), std::length_error);
+
+        // Output buffers larger than necessary are fine
+        auto larger = exec.submit({input, output, {}, inflatelib::format::deflate});
+        REQUIRE(larger.get().output_written == file.output.size);
+
+        // Truncated input
+        auto truncated = exec.submit({input.first(input.size() / 2), output, {}, inflatelib::format::deflate});
+        REQUIRE_THROWS_AS(truncated.get(), std::runtime_error);
+
+        // Errors in the data are reported to the callback
+        auto errInput = read_file(data_directory / "error.invalid-block-type.in.bin");
+        std::promise<inflatelib::executor::job_result> promise;
+        exec.submit({{errInput.buffer.get(), errInput.size}, output, {}, inflatelib::format::deflate}, [&](const auto& result) {
+            promise.set_value(result);
+        });
+        auto result = promise.get_future().get();
+        REQUIRE(result.error);
+        REQUIRE_THROWS_AS(std::rethrow_exception(result.error), std::runtime_error);
+    }
 }
@@ -31,6 +31,7 @@ static const std::span<const std::uint8_t, DEFLATE64_WINDOW_SIZE> secondHalf(inp
 static const std::span<const std::uint8_t, DEFLATE64_WINDOW_SIZE> middleHalf(inputData.data() + DEFLATE64_WINDOW_SIZE / 2, DEFLATE64_WINDOW_SIZE);
 static const std::span<const std::uint8_t, DEFLATE64_WINDOW_SIZE / 2> firstQuarter(inputData.data(), DEFLATE64_WINDOW_SIZE / 2);
 
+#ifndef INFLATELIB_SMALL_FOOTPRINT
 static void read_data(window* window, std::span<std::uint8_t> output, std::span<const std::uint8_t> expectedData, std::size_t stride = DEFLATE64_WINDOW_SIZE)
 {
     assert(output.size() >= expectedData.size());
@@ -45,13 +46,40 @@ static void read_data(window* window, std::span<std::uint8_t> output, std::span<
 
     REQUIRE(std::memcmp(expectedData.data(), output.data(), expectedData.size()) == 0);
 }
+#endif
 
+// Tests are run against both the window's built-in storage and, where supported, a mirrored mapping
+static void init_window(window* window, bool mirrored)
+{
+    window_init(window);
+    if (mirrored && window_enable_mirror(window))
+    {
+        REQUIRE(window->data != window->storage);
+    }
+    else
+    {
+        REQUIRE(window->data == window->storage);
+    }
+}
+
+struct window_cleanup
+{
+    window* value;
+
+    ~window_cleanup()
+    {
+        window_destroy(value);
+    }
+};
+
+#ifndef INFLATELIB_SMALL_FOOTPRINT
 TEST_CASE("WindowWriteBytesTest", "[window]")
 {
     std::uint8_t out[DEFLATE64_WINDOW_SIZE];
 
     window window;
-    window_init(&window);
+    init_window(&window, GENERATE(false, true));
+    window_cleanup cleanup{&window};
 
     auto writeData = [&](std::span<const std::uint8_t> data, std::size_t stride) {
         bitstream stream;
@@ -132,7 +160,8 @@ TEST_CASE("WindowWriteByteTest", "[window]")
 {
     std::uint8_t out[DEFLATE64_WINDOW_SIZE];
     window window;
-    window_init(&window);
+    init_window(&window, GENERATE(false, true));
+    window_cleanup cleanup{&window};
 
     auto writeData = [&](std::span<const std::uint8_t> data) {
         for (auto byte : data)
@@ -164,7 +193,8 @@ TEST_CASE("WindowWrite", "[window]")
     std::uint8_t output[DEFLATE64_WINDOW_SIZE];
 
     window window;
-    window_init(&window);
+    init_window(&window, GENERATE(false, true));
+    window_cleanup cleanup{&window};
 
     bitstream stream;
     bitstream_init(&stream);
@@ -263,6 +293,30 @@ TEST_CASE("WindowWrite", "[window]")
         REQUIRE(window_copy_output(&window, output, std::size(output)) == 2);
         REQUIRE(std::memcmp(secondHalf.data(), output, 2) == 0); // This wraps back around
     }
+    SECTION("Long distances")
+    {
+        // Deflate64 distances can exceed half the window. Copies longer than 'WINDOW_SIZE - distance' then read bytes
+        // that are being overwritten by the same copy, which matters when both halves of a mirrored window alias
+        writeSomeBytes(0x8000);
+        writeSomeBytes(0x8000);
+
+        REQUIRE(window_copy_length_distance(&window, 0xC000, 0x8000) == 0x8000);
+        REQUIRE(window_copy_output(&window, output, std::size(output)) == 0x8000);
+        REQUIRE(std::memcmp(firstHalf.data() + 0x4000, output, 0x8000) == 0);
+
+        // The output so far is 'firstHalf' followed by its middle half, so this reads the end of 'firstHalf' and then
+        // the first byte that was copied above
+        REQUIRE(window_copy_length_distance(&window, 0xFFFF, 0x8000) == 0x8000);
+        REQUIRE(window_copy_output(&window, output, std::size(output)) == 0x8000);
+        REQUIRE(std::memcmp(firstHalf.data() + 0x8001, output, 0x7FFF) == 0);
+        REQUIRE(output[0x7FFF] == firstHalf[0x4000]);
+
+        // A distance of the full window size copies each byte onto itself
+        REQUIRE(window_copy_length_distance(&window, 0x10000, 0xC000) == 0xC000);
+        REQUIRE(window_copy_output(&window, output, std::size(output)) == 0xC000);
+        REQUIRE(std::memcmp(firstHalf.data() + 0x4000, output, 0x8000) == 0);
+        REQUIRE(std::memcmp(firstHalf.data() + 0x8001, output + 0x8000, 0x4000) == 0);
+    }
     SECTION("Curated Conditions")
     {
         // Test very specific conditions around overlap and overflow (wrapping around to start of the buffer). For all
@@ -362,3 +416,94 @@ TEST_CASE("WindowWrite", "[window]")
         REQUIRE(std::memcmp(firstHalf.data() + one_eighth, output + one_half, one_quarter) == 0);
     }
 }
+
+#else
+// Small footprint builds size the window for Deflate only, so the tests above that assume the Deflate64 window size
+// are replaced with this one
+TEST_CASE("WindowSmallFootprint", "[window]")
+{
+    static_assert(WINDOW_SIZE == DEFLATE_WINDOW_SIZE);
+    std::uint8_t output[DEFLATE_WINDOW_SIZE];
+
+    window window;
+    init_window(&window, false);
+    window_cleanup cleanup{&window};
+
+    bitstream stream;
+    bitstream_init(&stream);
+    bitstream_set_data(&stream, firstHalf.data(), firstHalf.size());
+
+    SECTION("Error cases")
+    {
+        REQUIRE(window_copy_length_distance(&window, 1, 1) == -1); // No data written yet
+
+        REQUIRE(window_copy_bytes(&window, &stream, 256) == 256);
+        REQUIRE(window_copy_length_distance(&window, 257, 1) == -1);
+    }
+    SECTION("Uncompressed blocks")
+    {
+        // Uncompressed blocks can be up to 65535 bytes, which is larger than the window, so only part of the block fits
+        // until some of it is read back
+        REQUIRE(window_copy_bytes(&window, &stream, 0xFFFF) == DEFLATE_WINDOW_SIZE);
+        REQUIRE(window_copy_bytes(&window, &stream, 0xFFFF - DEFLATE_WINDOW_SIZE) == 0);
+        REQUIRE(window_copy_output(&window, output, std::size(output)) == DEFLATE_WINDOW_SIZE);
+        REQUIRE(std::memcmp(firstHalf.data(), output, DEFLATE_WINDOW_SIZE) == 0);
+
+        // The rest of the block wraps back around to the start of the window
+        REQUIRE(window_copy_bytes(&window, &stream, 0xFFFF - DEFLATE_WINDOW_SIZE) == 0xFFFF - DEFLATE_WINDOW_SIZE);
+        REQUIRE(window.write_offset == 0x7FFF);
+        REQUIRE(window_copy_output(&window, output, std::size(output)) == 0x7FFF);
+        REQUIRE(std::memcmp(firstHalf.data() + DEFLATE_WINDOW_SIZE, output, 0x7FFF) == 0);
+    }
+    SECTION("Wrapping copies")
+    {
+        REQUIRE(window_copy_bytes(&window, &stream, 0x7FF0) == 0x7FF0);
+        REQUIRE(window_copy_output(&window, output, std::size(output)) == 0x7FF0);
+
+        // Both the source and the destination of an overlapping copy wrap around the end of the window
+        REQUIRE(window_copy_length_distance(&window, 0x10, 0x40) == 0x40);
+        REQUIRE(window.write_offset == 0x30);
+        REQUIRE(window_copy_output(&window, output, std::size(output)) == 0x40);
+        for (std::uint32_t i = 0; i < 4; ++i)
+        {
+            REQUIRE(std::memcmp(firstHalf.data() + 0x7FE0, output + 0x10 * i, 0x10) == 0);
+        }
+
+        // The maximum Deflate distance reaches back one full window, which is where the data was first written
+        REQUIRE(window_copy_length_distance(&window, DEFLATE_WINDOW_SIZE, 258) == 258);
+        REQUIRE(window_copy_output(&window, output, std::size(output)) == 258);
+        REQUIRE(std::memcmp(firstHalf.data() + 0x30, output, 258) == 0);
+    }
+}
+#endif
+
+TEST_CASE("WindowMirror", "[window]")
+{
+    window window;
+    window_init(&window);
+    window_cleanup cleanup{&window};
+    if (!window_enable_mirror(&window))
+    {
+        SUCCEED("Mirrored windows are not supported");
+        return;
+    }
+
+    // Every byte should be visible through both halves of the mapping, including across the wrap point
+    for (std::uint32_t i = 0; i < DEFLATE64_WINDOW_SIZE + 0x100; ++i)
+    {
+        REQUIRE(window_write_byte(&window, static_cast<std::uint8_t>(i * 7)));
+        auto offset = static_cast<std::uint16_t>(window.write_offset - 1);
+        REQUIRE(window.data[offset] == static_cast<std::uint8_t>(i * 7));
+        REQUIRE(window.data[offset + DEFLATE64_WINDOW_SIZE] == static_cast<std::uint8_t>(i * 7));
+
+        std::uint8_t out;
+        REQUIRE(window_copy_output(&window, &out, 1) == 1);
+    }
+
+    // Resetting the window keeps the mapping, and enabling it again is a no-op
+    auto data = window.data;
+    window_reset(&window);
+    REQUIRE(window_enable_mirror(&window));
+    REQUIRE(window.data == data);
+}
+
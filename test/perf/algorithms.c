@@ -8,8 +8,21 @@
  */
 #include "pch.h"
 
+#include <limits.h>
+#include <stddef.h>
+
 #include "algorithms.h"
 
+size_t input_chunk_size = SIZE_MAX;
+size_t output_chunk_size = output_buffer_size;
+
+/* Returns the number of bytes to pass as input to the next inflate call */
+static size_t next_input_size(const file_data* input, const void* next)
+{
+    size_t remaining = input->bytes - (size_t)((const uint8_t*)next - input->buffer);
+    return (remaining < input_chunk_size) ? remaining : input_chunk_size;
+}
+
 const char* deflate_algorithm_string(deflate_algorithm alg)
 {
     switch (alg)
@@ -24,9 +37,58 @@ const char* deflate_algorithm_string(deflate_algorithm alg)
     }
 }
 
+/* Each allocation is prefixed with its size so that it can be subtracted when freed, since zlib does not provide it */
+static void* memory_usage_alloc(memory_usage* usage, size_t bytes)
+{
+    max_align_t* header = (max_align_t*)malloc(sizeof(max_align_t) + bytes);
+    if (!header)
+    {
+        return NULL;
+    }
+
+    *(size_t*)header = bytes;
+    usage->current_bytes += bytes;
+    if (usage->current_bytes > usage->peak_bytes)
+    {
+        usage->peak_bytes = usage->current_bytes;
+    }
+
+    return header + 1;
+}
+
+static void memory_usage_free(memory_usage* usage, void* ptr)
+{
+    max_align_t* header;
+
+    if (!ptr)
+    {
+        return;
+    }
+
+    header = (max_align_t*)ptr - 1;
+    usage->current_bytes -= *(size_t*)header;
+    free(header);
+}
+
+static void* inflatelib_inflater_alloc(void* userData, size_t bytes, size_t alignment)
+{
+    (void)alignment; /* 'max_align_t' covers all alignments inflatelib requests */
+    return memory_usage_alloc((memory_usage*)userData, bytes);
+}
+
+static void inflatelib_inflater_free(void* userData, void* ptr, size_t bytes, size_t alignment)
+{
+    (void)bytes; /* Recorded in the allocation's header */
+    (void)alignment;
+    memory_usage_free((memory_usage*)userData, ptr);
+}
+
 static int inflatelib_inflater_init(void* pThis)
 {
     inflatelib_inflater_t* self = (inflatelib_inflater_t*)pThis;
+    self->stream.alloc = inflatelib_inflater_alloc;
+    self->stream.free = inflatelib_inflater_free;
+    self->stream.user_data = &self->memory;
     if (inflatelib_init(&self->stream) != INFLATELIB_OK)
     {
         printf("ERROR: inflatelib_init failed\n");
@@ -49,6 +111,12 @@ static void inflatelib_inflater_destroy(void* pThis)
     inflatelib_destroy(&self->stream);
 }
 
+static size_t inflatelib_inflater_peak_memory(void* pThis)
+{
+    inflatelib_inflater_t* self = (inflatelib_inflater_t*)pThis;
+    return self->memory.peak_bytes;
+}
+
 static int inflatelib_inflater_inflate(void* pThis, const file_data* input, uint8_t* outputBuffer)
 {
     inflatelib_inflater_t* self = (inflatelib_inflater_t*)pThis;
@@ -58,17 +126,21 @@ static int inflatelib_inflater_inflate(void* pThis, const file_data* input, uint
 
     /* Initialize stream buffers */
     self->stream.next_in = input->buffer;
-    self->stream.avail_in = input->bytes;
+    self->stream.avail_in = 0;
 
     while (1)
     {
+        if (self->stream.avail_in == 0)
+        {
+            self->stream.avail_in = next_input_size(input, self->stream.next_in);
+        }
         self->stream.next_out = outputBuffer;
-        self->stream.avail_out = output_buffer_size;
+        self->stream.avail_out = output_chunk_size;
         inflateResult = inflatelib_inflate(&self->stream);
         if (inflateResult == INFLATELIB_EOF)
         {
             /* Tests for validity are done elsewhere; this is just a sanity check */
-            assert(self->stream.avail_in == 0);
+            assert(next_input_size(input, self->stream.next_in) == 0);
             return 1;
         }
         else if (inflateResult < 0)
@@ -79,8 +151,6 @@ static int inflatelib_inflater_inflate(void* pThis, const file_data* input, uint
             printf("ERROR: %s\n", self->stream.error_msg);
             return 0;
         }
-
-        assert(self->stream.avail_in > 0);
     }
 }
 
@@ -93,17 +163,21 @@ static int inflatelib_inflater64_inflate(void* pThis, const file_data* input, ui
 
     /* Initialize stream buffers */
     self->stream.next_in = input->buffer;
-    self->stream.avail_in = input->bytes;
+    self->stream.avail_in = 0;
 
     while (1)
     {
+        if (self->stream.avail_in == 0)
+        {
+            self->stream.avail_in = next_input_size(input, self->stream.next_in);
+        }
         self->stream.next_out = outputBuffer;
-        self->stream.avail_out = output_buffer_size;
+        self->stream.avail_out = output_chunk_size;
         inflateResult = inflatelib_inflate64(&self->stream);
         if (inflateResult == INFLATELIB_EOF)
         {
             /* Tests for validity are done elsewhere; this is just a sanity check */
-            assert(self->stream.avail_in == 0);
+            assert(next_input_size(input, self->stream.next_in) == 0);
             return 1;
         }
         else if (inflateResult < 0)
@@ -114,9 +188,65 @@ static int inflatelib_inflater64_inflate(void* pThis, const file_data* input, ui
             printf("ERROR: %s\n", self->stream.error_msg);
             return 0;
         }
+    }
+}
+
+static void inflatelib_inflater_reset(void* pThis)
+{
+    inflatelib_inflater_t* self = (inflatelib_inflater_t*)pThis;
+    inflatelib_reset(&self->stream);
+}
+
+static int inflatelib_inflater_phase_times(void* pThis, inflatelib_phase_times* times)
+{
+    inflatelib_inflater_t* self = (inflatelib_inflater_t*)pThis;
+    return inflatelib_get_phase_times(&self->stream, times) == INFLATELIB_OK;
+}
+
+static inflate_result inflatelib_inflater_inflate_buffer(
+    void* pThis, const uint8_t* input, size_t* inputSize, uint8_t* output, size_t* outputSize)
+{
+    inflatelib_inflater_t* self = (inflatelib_inflater_t*)pThis;
+    int inflateResult;
 
-        assert(self->stream.avail_in > 0);
+    self->stream.next_in = input;
+    self->stream.avail_in = *inputSize;
+    self->stream.next_out = output;
+    self->stream.avail_out = *outputSize;
+    inflateResult = inflatelib_inflate(&self->stream);
+    if (inflateResult < 0)
+    {
+        printf("ERROR: inflatelib_inflate unexpectedly failed\n");
+        printf("ERROR: %s\n", self->stream.error_msg);
+        return inflate_result_error;
     }
+
+    *inputSize -= self->stream.avail_in;
+    *outputSize -= self->stream.avail_out;
+    return (inflateResult == INFLATELIB_EOF) ? inflate_result_eof : inflate_result_ok;
+}
+
+static inflate_result inflatelib_inflater64_inflate_buffer(
+    void* pThis, const uint8_t* input, size_t* inputSize, uint8_t* output, size_t* outputSize)
+{
+    inflatelib_inflater_t* self = (inflatelib_inflater_t*)pThis;
+    int inflateResult;
+
+    self->stream.next_in = input;
+    self->stream.avail_in = *inputSize;
+    self->stream.next_out = output;
+    self->stream.avail_out = *outputSize;
+    inflateResult = inflatelib_inflate64(&self->stream);
+    if (inflateResult < 0)
+    {
+        printf("ERROR: inflatelib_inflate64 unexpectedly failed\n");
+        printf("ERROR: %s\n", self->stream.error_msg);
+        return inflate_result_error;
+    }
+
+    *inputSize -= self->stream.avail_in;
+    *outputSize -= self->stream.avail_out;
+    return (inflateResult == INFLATELIB_EOF) ? inflate_result_eof : inflate_result_ok;
 }
 
 static const inflater_vtable inflatelib_inflater_vtable = {
@@ -124,11 +254,16 @@ static const inflater_vtable inflatelib_inflater_vtable = {
     .destroy = inflatelib_inflater_destroy,
     .name = inflatelib_inflater_name,
     .inflate_file = inflatelib_inflater_inflate,
+    .peak_memory = inflatelib_inflater_peak_memory,
+    .reset = inflatelib_inflater_reset,
+    .inflate_buffer = inflatelib_inflater_inflate_buffer,
+    .phase_times = inflatelib_inflater_phase_times,
 };
 
 inflatelib_inflater_t inflatelib_inflater = {
     .vtable = &inflatelib_inflater_vtable,
     .stream = {0},
+    .memory = {0},
 };
 
 static const inflater_vtable inflatelib_inflater64_vtable = {
@@ -136,16 +271,34 @@ static const inflater_vtable inflatelib_inflater64_vtable = {
     .destroy = inflatelib_inflater_destroy,
     .name = inflatelib_inflater_name,
     .inflate_file = inflatelib_inflater64_inflate,
+    .peak_memory = inflatelib_inflater_peak_memory,
+    .reset = inflatelib_inflater_reset,
+    .inflate_buffer = inflatelib_inflater64_inflate_buffer,
+    .phase_times = inflatelib_inflater_phase_times,
 };
 
 inflatelib_inflater_t inflatelib_inflater64 = {
     .vtable = &inflatelib_inflater64_vtable,
     .stream = {0},
+    .memory = {0},
 };
 
+static voidpf zlib_inflater_alloc(voidpf opaque, uInt items, uInt size)
+{
+    return memory_usage_alloc((memory_usage*)opaque, (size_t)items * size);
+}
+
+static void zlib_inflater_free(voidpf opaque, voidpf address)
+{
+    memory_usage_free((memory_usage*)opaque, address);
+}
+
 int zlib_inflater_init(void* self)
 {
     zlib_inflater_t* pThis = (zlib_inflater_t*)self;
+    pThis->stream.zalloc = zlib_inflater_alloc;
+    pThis->stream.zfree = zlib_inflater_free;
+    pThis->stream.opaque = &pThis->memory;
     if (inflateInit2(&pThis->stream, -15) != Z_OK) /* Don't check for zlib header */
     {
         printf("ERROR: inflateInit2 failed\n");
@@ -168,6 +321,12 @@ const char* zlib_inflater_name(void* pThis)
     return "zlib";
 }
 
+size_t zlib_inflater_peak_memory(void* self)
+{
+    zlib_inflater_t* pThis = (zlib_inflater_t*)self;
+    return pThis->memory.peak_bytes;
+}
+
 int zlib_inflater_inflate(void* self, const file_data* input, uint8_t* outputBuffer)
 {
     zlib_inflater_t* pThis = (zlib_inflater_t*)self;
@@ -177,18 +336,22 @@ int zlib_inflater_inflate(void* self, const file_data* input, uint8_t* outputBuf
 
     /* Initialize stream buffers */
     pThis->stream.next_in = input->buffer;
-    pThis->stream.avail_in = (uInt)input->bytes;
-    assert((size_t)pThis->stream.avail_in == input->bytes); /* Cast should succeed */
+    pThis->stream.avail_in = 0;
 
     while (1)
     {
+        if (pThis->stream.avail_in == 0)
+        {
+            pThis->stream.avail_in = (uInt)next_input_size(input, pThis->stream.next_in);
+            assert((size_t)pThis->stream.avail_in == next_input_size(input, pThis->stream.next_in)); /* Cast should succeed */
+        }
         pThis->stream.next_out = outputBuffer;
-        pThis->stream.avail_out = (uInt)output_buffer_size;
+        pThis->stream.avail_out = (uInt)output_chunk_size;
         inflateResult = inflate(&pThis->stream, 0);
         if (inflateResult == Z_STREAM_END)
         {
             /* Tests for validity are done elsewhere; this is just a sanity check */
-            assert(pThis->stream.avail_in == 0);
+            assert(next_input_size(input, pThis->stream.next_in) == 0);
             return 1;
         }
         else if (inflateResult < 0)
@@ -199,9 +362,37 @@ int zlib_inflater_inflate(void* self, const file_data* input, uint8_t* outputBuf
             printf("ERROR: %s\n", pThis->stream.msg);
             return 0;
         }
+    }
+}
+
+void zlib_inflater_reset(void* self)
+{
+    zlib_inflater_t* pThis = (zlib_inflater_t*)self;
+    inflateReset(&pThis->stream);
+}
 
-        assert(pThis->stream.avail_in > 0);
+inflate_result zlib_inflater_inflate_buffer(
+    void* self, const uint8_t* input, size_t* inputSize, uint8_t* output, size_t* outputSize)
+{
+    zlib_inflater_t* pThis = (zlib_inflater_t*)self;
+    int inflateResult;
+
+    assert((*inputSize <= UINT_MAX) && (*outputSize <= UINT_MAX));
+    pThis->stream.next_in = (Bytef*)input;
+    pThis->stream.avail_in = (uInt)*inputSize;
+    pThis->stream.next_out = output;
+    pThis->stream.avail_out = (uInt)*outputSize;
+    inflateResult = inflate(&pThis->stream, 0);
+    if ((inflateResult < 0) && (inflateResult != Z_BUF_ERROR))
+    {
+        printf("ERROR: inflate unexpectedly failed\n");
+        printf("ERROR: %s\n", pThis->stream.msg);
+        return inflate_result_error;
     }
+
+    *inputSize -= pThis->stream.avail_in;
+    *outputSize -= pThis->stream.avail_out;
+    return (inflateResult == Z_STREAM_END) ? inflate_result_eof : inflate_result_ok;
 }
 
 static const inflater_vtable zlib_inflater_vtable = {
@@ -209,9 +400,13 @@ static const inflater_vtable zlib_inflater_vtable = {
     .destroy = zlib_inflater_destroy,
     .name = zlib_inflater_name,
     .inflate_file = zlib_inflater_inflate,
+    .peak_memory = zlib_inflater_peak_memory,
+    .reset = zlib_inflater_reset,
+    .inflate_buffer = zlib_inflater_inflate_buffer,
 };
 
 zlib_inflater_t zlib_inflater = {
     .vtable = &zlib_inflater_vtable,
     .stream = {0},
+    .memory = {0},
 };
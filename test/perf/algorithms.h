@@ -17,6 +17,13 @@
 /* The output buffer is selected as a constant size to emulate more real life scenarios */
 static const size_t output_buffer_size = 1 << 16;
 
+/* The maximum number of bytes passed as input/output to a single inflate call. By default, each file's input is passed
+ * all at once and the full output buffer is used. The 'streaming' argument lowers both to 'streaming_chunk_size' to
+ * emulate callers that feed data through small buffers (e.g. network or pipe reads) */
+static const size_t streaming_chunk_size = 1 << 12;
+extern size_t input_chunk_size;
+extern size_t output_chunk_size;
+
 typedef enum deflate_algorithm
 {
     deflate_algorithm_deflate = 0,
@@ -25,12 +32,37 @@ typedef enum deflate_algorithm
 
 const char* deflate_algorithm_string(deflate_algorithm alg);
 
+/* Memory allocated through an inflater's allocation callbacks */
+typedef struct memory_usage
+{
+    size_t current_bytes;
+    size_t peak_bytes;
+} memory_usage;
+
+typedef enum inflate_result
+{
+    inflate_result_error = 0,
+    inflate_result_ok = 1,
+    inflate_result_eof = 2, /* The end of the stream was reached */
+} inflate_result;
+
 typedef struct inflater_vtable
 {
     int (*init)(void* pThis);
     void (*destroy)(void* pThis);
     const char* (*name)(void* pThis);
     int (*inflate_file)(void* pThis, const file_data* input, uint8_t* outputBuffer);
+    size_t (*peak_memory)(void* pThis);
+
+    /* Used by the latency and soak tests. 'reset' prepares the inflater for a new stream and 'inflate_buffer' makes a
+     * single inflate call. On input, '*inputSize' and '*outputSize' are the sizes of 'input' and 'output'; on return,
+     * they are updated to the number of bytes consumed and written */
+    void (*reset)(void* pThis);
+    inflate_result (*inflate_buffer)(void* pThis, const uint8_t* input, size_t* inputSize, uint8_t* output, size_t* outputSize);
+
+    /* Optional. Retrieves the time spent in each phase of decoding the last stream, returning 0 if this is not
+     * available, e.g. because inflatelib was not built with 'INFLATELIB_PHASE_TIMING' */
+    int (*phase_times)(void* pThis, inflatelib_phase_times* times);
 } inflater_vtable;
 
 /* Convenient typedefs so these look more "object-like". The 'p' indicates that it's a "pointer to" an inflater */
@@ -40,6 +72,7 @@ typedef struct inflatelib_inflater_t
 {
     const inflater_vtable* const vtable;
     inflatelib_stream stream;
+    memory_usage memory;
 } inflatelib_inflater_t;
 
 extern inflatelib_inflater_t inflatelib_inflater;
@@ -49,6 +82,7 @@ typedef struct zlib_inflater_t
 {
     const inflater_vtable* const vtable;
     z_stream stream;
+    memory_usage memory;
 } zlib_inflater_t;
 
 extern zlib_inflater_t zlib_inflater;
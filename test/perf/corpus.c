@@ -0,0 +1,504 @@
+/*
+ *    Copyright (c) Microsoft. All rights reserved.
+ *    This code is licensed under the MIT License.
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF
+ *    ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+ *    TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ *    PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ */
+#include "pch.h"
+
+#include <inttypes.h>
+
+#include "corpus.h"
+#include "timer.h"
+#include "zip.h"
+
+/* Each entry is inflated repeatedly until about 'corpus_target_bytes' of output has been produced, within the bounds
+ * below. Small entries therefore get enough iterations for their timings to be meaningful without large entries taking
+ * too long */
+static const uint64_t corpus_target_bytes = 64 << 20;
+static const uint64_t corpus_min_iterations = 3;
+static const uint64_t corpus_max_iterations = 1000;
+
+/* The most inflaters that can be measured for a single algorithm */
+#define CORPUS_MAX_INFLATERS 4
+
+/* Entries are grouped by uncompressed size and by compression ratio, i.e. compressed size as a percentage of uncompressed
+ * size. Each group holds the values that are at least the previous group's limit and less than its own; the last group
+ * has no limit */
+#define CORPUS_GROUP_COUNT 5
+static const char* const size_group_names[CORPUS_GROUP_COUNT] = {
+    "< 1 KiB", "1 - 16 KiB", "16 - 256 KiB", "256 KiB - 4 MiB", ">= 4 MiB"};
+static const uint64_t size_group_limits[CORPUS_GROUP_COUNT - 1] = {1 << 10, 16 << 10, 256 << 10, 4 << 20};
+static const char* const ratio_group_names[CORPUS_GROUP_COUNT] = {"< 10%", "10 - 25%", "25 - 50%", "50 - 75%", ">= 75%"};
+static const double ratio_group_limits[CORPUS_GROUP_COUNT - 1] = {10, 25, 50, 75};
+
+/* gzip header flags (RFC 1952) */
+#define GZIP_FLAG_HCRC 0x02
+#define GZIP_FLAG_EXTRA 0x04
+#define GZIP_FLAG_NAME 0x08
+#define GZIP_FLAG_COMMENT 0x10
+
+typedef struct corpus_group
+{
+    size_t entries;
+    uint64_t input_bytes;
+    uint64_t output_bytes;
+
+    /* The sum of the average time each inflater took to inflate each entry in the group, in 'current_time' units */
+    double time[CORPUS_MAX_INFLATERS];
+} corpus_group;
+
+typedef struct corpus_results
+{
+    const pinflater* inflaters;
+    size_t inflater_count;
+    corpus_group by_size[CORPUS_GROUP_COUNT];
+    corpus_group by_ratio[CORPUS_GROUP_COUNT];
+    corpus_group total;
+} corpus_results;
+
+typedef struct corpus_context
+{
+    corpus_results results[2]; /* Indexed by 'deflate_algorithm' */
+    uint8_t* output_buffer;
+    int print_entries;
+
+    /* Deflate and Deflate64 entries that were not measured, e.g. because they failed to inflate */
+    size_t skipped;
+} corpus_context;
+
+static double corpus_throughput(uint64_t bytes, double time)
+{
+    double ms = time_to_ms_f(time);
+    return (ms > 0) ? ((bytes / (1024.0 * 1024.0)) / (ms / 1000.0)) : 0;
+}
+
+/* Inflates 'entry' once to validate it and find its uncompressed size. Any data that follows the end of the stream, such
+ * as a gzip trailer and any further gzip members, is trimmed from 'entry' so that the timed runs see exactly one stream */
+static int corpus_measure_entry(pinflater inflater, file_data* entry, uint8_t* outputBuffer, uint64_t* outputBytes)
+{
+    const inflater_vtable* vtable = *inflater;
+    inflate_result result = inflate_result_ok;
+    size_t offset = 0;
+
+    *outputBytes = 0;
+    vtable->reset((void*)inflater);
+    while (result == inflate_result_ok)
+    {
+        /* zlib only accepts 32-bit sizes */
+        size_t inputSize = ((entry->bytes - offset) < UINT32_MAX) ? (entry->bytes - offset) : UINT32_MAX;
+        size_t outputSize = output_buffer_size;
+        result = vtable->inflate_buffer((void*)inflater, entry->buffer + offset, &inputSize, outputBuffer, &outputSize);
+        if ((result == inflate_result_ok) && (inputSize == 0) && (outputSize == 0))
+        {
+            return 0; /* Truncated */
+        }
+
+        offset += inputSize;
+        *outputBytes += outputSize;
+    }
+
+    if (result != inflate_result_eof)
+    {
+        return 0;
+    }
+
+    entry->bytes = offset;
+    return 1;
+}
+
+static void corpus_group_add(corpus_group* group, size_t inputBytes, uint64_t outputBytes, const double* times, size_t count)
+{
+    ++group->entries;
+    group->input_bytes += inputBytes;
+    group->output_bytes += outputBytes;
+    for (size_t i = 0; i < count; ++i)
+    {
+        group->time[i] += times[i];
+    }
+}
+
+static void corpus_run_entry(corpus_context* context, deflate_algorithm alg, const char* name, const uint8_t* data, size_t size)
+{
+    corpus_results* results = &context->results[alg];
+    file_data entry = {name, (uint8_t*)data, size};
+    uint64_t outputBytes, iterations;
+    uint64_t totals[CORPUS_MAX_INFLATERS] = {0};
+    double times[CORPUS_MAX_INFLATERS];
+    double ratio;
+    size_t sizeGroup = 0, ratioGroup = 0;
+
+    if (results->inflater_count == 0)
+    {
+        ++context->skipped; /* No inflater was selected for this algorithm */
+        return;
+    }
+
+    if (!corpus_measure_entry(results->inflaters[0], &entry, context->output_buffer, &outputBytes))
+    {
+        printf("NOTE: Skipping '%s' since it is not valid %s data\n", name, deflate_algorithm_string(alg));
+        ++context->skipped;
+        return;
+    }
+
+    iterations = outputBytes ? (corpus_target_bytes / outputBytes) : corpus_max_iterations;
+    if (iterations < corpus_min_iterations)
+    {
+        iterations = corpus_min_iterations;
+    }
+    else if (iterations > corpus_max_iterations)
+    {
+        iterations = corpus_max_iterations;
+    }
+
+    /* Iterations alternate between the inflaters so that any drift over the run, e.g. from thermal throttling, affects
+     * each of them equally */
+    for (uint64_t iteration = 0; iteration < iterations; ++iteration)
+    {
+        for (size_t i = 0; i < results->inflater_count; ++i)
+        {
+            uint64_t start = current_time();
+            if (!(*results->inflaters[i])->inflate_file((void*)results->inflaters[i], &entry, context->output_buffer))
+            {
+                exit(1); /* The inflater has already reported the error */
+            }
+            totals[i] += current_time() - start;
+        }
+    }
+
+    for (size_t i = 0; i < results->inflater_count; ++i)
+    {
+        times[i] = (double)totals[i] / iterations;
+    }
+
+    ratio = outputBytes ? ((entry.bytes * 100.0) / outputBytes) : 100.0;
+    while ((sizeGroup < (CORPUS_GROUP_COUNT - 1)) && (outputBytes >= size_group_limits[sizeGroup]))
+    {
+        ++sizeGroup;
+    }
+    while ((ratioGroup < (CORPUS_GROUP_COUNT - 1)) && (ratio >= ratio_group_limits[ratioGroup]))
+    {
+        ++ratioGroup;
+    }
+
+    corpus_group_add(&results->by_size[sizeGroup], entry.bytes, outputBytes, times, results->inflater_count);
+    corpus_group_add(&results->by_ratio[ratioGroup], entry.bytes, outputBytes, times, results->inflater_count);
+    corpus_group_add(&results->total, entry.bytes, outputBytes, times, results->inflater_count);
+
+    if (context->print_entries)
+    {
+        printf("  %s (%s): %zu -> %" PRIu64 " bytes (%.1f%%)", name, deflate_algorithm_string(alg), entry.bytes, outputBytes,
+            ratio);
+        for (size_t i = 0; i < results->inflater_count; ++i)
+        {
+            printf(", %s %.1f MiB/s", (*results->inflaters[i])->name((void*)results->inflaters[i]),
+                corpus_throughput(outputBytes, times[i]));
+        }
+        printf("\n");
+    }
+}
+
+/* Returns "<archive>:<name>", which must be freed */
+static char* corpus_entry_name(const char* archive, const char* name, size_t nameLen)
+{
+    size_t archiveLen = strlen(archive);
+    char* result = (char*)malloc(archiveLen + 1 + nameLen + 1);
+    if (!result)
+    {
+        printf("ERROR: Failed to allocate space for the name of an entry in '%s'\n", archive);
+        exit(1);
+    }
+
+    memcpy(result, archive, archiveLen);
+    result[archiveLen] = ':';
+    memcpy(result + archiveLen + 1, name, nameLen);
+    result[archiveLen + 1 + nameLen] = '\0';
+    return result;
+}
+
+/* Entries are found through the central directory, the same as the 'zip-extract' tool, and inflated directly from the
+ * archive's data */
+static void corpus_run_zip(corpus_context* context, const file_data* file)
+{
+    const end_of_central_directory* eocd = NULL;
+    size_t searchEnd, cdOffset, cdSize, offset;
+
+    /* The end of central directory record is the last thing in the file, other than its comment of at most 64 KiB */
+    searchEnd = (file->bytes > (sizeof(*eocd) + 0xFFFF)) ? (file->bytes - sizeof(*eocd) - 0xFFFF) : 0;
+    for (size_t i = file->bytes - sizeof(*eocd) + 1; i-- > searchEnd;)
+    {
+        const end_of_central_directory* candidate = (const end_of_central_directory*)(file->buffer + i);
+        if (end_of_central_directory_valid(candidate))
+        {
+            eocd = candidate;
+            break;
+        }
+    }
+
+    if (!eocd)
+    {
+        printf("NOTE: Skipping '%s' since its end of central directory record could not be found\n", file->filename);
+        return;
+    }
+
+    cdOffset = le_u32_get(eocd->cd_offset);
+    cdSize = le_u32_get(eocd->cd_size);
+    if ((cdOffset == ZIP64_SENTINEL) || (le_u16_get(eocd->cd_records) == 0xFFFF))
+    {
+        printf("NOTE: Skipping '%s' since ZIP64 archives are not supported\n", file->filename);
+        return;
+    }
+    else if ((cdOffset > file->bytes) || (cdSize > (file->bytes - cdOffset)))
+    {
+        printf("NOTE: Skipping '%s' since its central directory is out of bounds\n", file->filename);
+        return;
+    }
+
+    for (offset = cdOffset; offset < (cdOffset + cdSize);)
+    {
+        const central_directory_file_header* header = (const central_directory_file_header*)(file->buffer + offset);
+        const local_file_header* localHeader;
+        size_t remaining = cdOffset + cdSize - offset, localOffset, dataOffset, compressedSize;
+        uint16_t method;
+        char* name;
+
+        if ((remaining < sizeof(*header)) || !central_directory_file_header_valid(header) ||
+            (central_directory_file_header_size(header) > remaining))
+        {
+            printf("NOTE: Skipping the rest of '%s' since its central directory is invalid\n", file->filename);
+            return;
+        }
+        offset += central_directory_file_header_size(header);
+
+        method = le_u16_get(header->compression_method);
+        if ((method != ZIP_METHOD_DEFLATE) && (method != ZIP_METHOD_DEFLATE64))
+        {
+            continue; /* E.g. directories and stored files */
+        }
+
+        name = corpus_entry_name(file->filename, (const char*)(header + 1), le_u16_get(header->file_name_length));
+        compressedSize = le_u32_get(header->compressed_size);
+        localOffset = le_u32_get(header->local_file_header_offset);
+        localHeader = (const local_file_header*)(file->buffer + localOffset);
+        if (le_u16_get(header->bit_flag) & ZIP_FLAG_ENCRYPTED)
+        {
+            printf("NOTE: Skipping '%s' since it is encrypted\n", name);
+            ++context->skipped;
+        }
+        else if ((compressedSize == ZIP64_SENTINEL) || (localOffset == ZIP64_SENTINEL))
+        {
+            printf("NOTE: Skipping '%s' since ZIP64 entries are not supported\n", name);
+            ++context->skipped;
+        }
+        else if ((file->bytes < sizeof(*localHeader)) || (localOffset > (file->bytes - sizeof(*localHeader))) ||
+                 !local_file_header_valid(localHeader) ||
+                 ((dataOffset = localOffset + local_file_header_size(localHeader)) > file->bytes) ||
+                 (compressedSize > (file->bytes - dataOffset)))
+        {
+            printf("NOTE: Skipping '%s' since its local file header is invalid\n", name);
+            ++context->skipped;
+        }
+        else
+        {
+            deflate_algorithm alg = (method == ZIP_METHOD_DEFLATE64) ? deflate_algorithm_deflate64 : deflate_algorithm_deflate;
+            corpus_run_entry(context, alg, name, file->buffer + dataOffset, compressedSize);
+        }
+
+        free(name);
+    }
+}
+
+static size_t corpus_skip_string(const file_data* file, size_t offset)
+{
+    while ((offset < file->bytes) && (file->buffer[offset] != 0))
+    {
+        ++offset;
+    }
+    return offset + 1;
+}
+
+static void corpus_run_gzip(corpus_context* context, const file_data* file)
+{
+    uint8_t flags = file->buffer[3];
+    size_t offset = 10;
+
+    if (flags & GZIP_FLAG_EXTRA)
+    {
+        offset += 2 + (size_t)(file->buffer[offset] | (file->buffer[offset + 1] << 8));
+    }
+    if (flags & GZIP_FLAG_NAME)
+    {
+        offset = corpus_skip_string(file, offset);
+    }
+    if (flags & GZIP_FLAG_COMMENT)
+    {
+        offset = corpus_skip_string(file, offset);
+    }
+    if (flags & GZIP_FLAG_HCRC)
+    {
+        offset += 2;
+    }
+
+    if (offset >= file->bytes)
+    {
+        printf("NOTE: Skipping '%s' since its gzip header is truncated\n", file->filename);
+        ++context->skipped;
+        return;
+    }
+
+    corpus_run_entry(context, deflate_algorithm_deflate, file->filename, file->buffer + offset, file->bytes - offset);
+}
+
+static void corpus_run_file(const char* path, void* pContext)
+{
+    corpus_context* context = (corpus_context*)pContext;
+    file_data file = read_file_path(path);
+    const uint8_t* data = file.buffer;
+
+    if ((file.bytes >= sizeof(end_of_central_directory)) && (data[0] == 'P') && (data[1] == 'K') &&
+        (((data[2] == 3) && (data[3] == 4)) || ((data[2] == 5) && (data[3] == 6))))
+    {
+        corpus_run_zip(context, &file);
+    }
+    else if ((file.bytes >= 18) && (data[0] == 0x1F) && (data[1] == 0x8B) && (data[2] == 8))
+    {
+        /* The 10 byte header and 8 byte trailer are the minimum; the first two bytes are the magic number and the third
+         * is the compression method, which is always Deflate */
+        corpus_run_gzip(context, &file);
+    }
+    else
+    {
+        /* Raw Deflate and Deflate64 data can't be told apart, so this relies on the path */
+        deflate_algorithm alg = strstr(path, "deflate64") ? deflate_algorithm_deflate64 : deflate_algorithm_deflate;
+        corpus_run_entry(context, alg, path, file.buffer, file.bytes);
+    }
+
+    free(file.buffer);
+}
+
+static void corpus_print_group(const char* name, const corpus_group* group, const corpus_results* results)
+{
+    printf("  %-17s | %7zu | %12.2f | %12.2f", name, group->entries, group->input_bytes / (1024.0 * 1024.0),
+        group->output_bytes / (1024.0 * 1024.0));
+    for (size_t i = 0; i < results->inflater_count; ++i)
+    {
+        if (group->entries > 0)
+        {
+            printf(" | %20.1f", corpus_throughput(group->output_bytes, group->time[i]));
+        }
+        else
+        {
+            printf(" | %20s", "-");
+        }
+    }
+    printf("\n");
+}
+
+static void corpus_print_groups(
+    const char* title, const char* const* names, const corpus_group* groups, const corpus_results* results)
+{
+    printf("\n  %-17s | Entries |  Input (MiB) | Output (MiB)", title);
+    for (size_t i = 0; i < results->inflater_count; ++i)
+    {
+        char header[64];
+        snprintf(header, sizeof(header), "%s (MiB/s)", (*results->inflaters[i])->name((void*)results->inflaters[i]));
+        printf(" | %20s", header);
+    }
+    printf("\n  ------------------+---------+--------------+-------------");
+    for (size_t i = 0; i < results->inflater_count; ++i)
+    {
+        printf("-+---------------------");
+    }
+    printf("\n");
+
+    for (size_t i = 0; i < CORPUS_GROUP_COUNT; ++i)
+    {
+        corpus_print_group(names[i], groups + i, results);
+    }
+    corpus_print_group("All", &results->total, results);
+}
+
+static void corpus_print_results(deflate_algorithm alg, const corpus_results* results)
+{
+    printf("\n%s:\n", deflate_algorithm_string(alg));
+    corpus_print_groups("Uncompressed size", size_group_names, results->by_size, results);
+    printf("\n  Compression ratio is the compressed size as a percentage of the uncompressed size\n");
+    corpus_print_groups("Compression ratio", ratio_group_names, results->by_ratio, results);
+}
+
+void run_corpus_tests(
+    const char* const* paths,
+    size_t pathCount,
+    const pinflater* deflateInflaters,
+    size_t deflateInflaterCount,
+    const pinflater* deflate64Inflaters,
+    size_t deflate64InflaterCount,
+    int printEntries)
+{
+    corpus_context context = {0};
+    size_t entryCount;
+
+    assert((deflateInflaterCount <= CORPUS_MAX_INFLATERS) && (deflate64InflaterCount <= CORPUS_MAX_INFLATERS));
+    context.results[deflate_algorithm_deflate].inflaters = deflateInflaters;
+    context.results[deflate_algorithm_deflate].inflater_count = deflateInflaterCount;
+    context.results[deflate_algorithm_deflate64].inflaters = deflate64Inflaters;
+    context.results[deflate_algorithm_deflate64].inflater_count = deflate64InflaterCount;
+    context.print_entries = printEntries;
+
+    context.output_buffer = (uint8_t*)malloc(output_buffer_size);
+    if (!context.output_buffer)
+    {
+        printf("ERROR: Failed to allocate output buffer\n");
+        exit(1);
+    }
+
+    for (size_t alg = 0; alg < ARRAYSIZE(context.results); ++alg)
+    {
+        for (size_t i = 0; i < context.results[alg].inflater_count; ++i)
+        {
+            if (!(*context.results[alg].inflaters[i])->init((void*)context.results[alg].inflaters[i]))
+            {
+                printf("ERROR: Failed to initialize inflater\n");
+                exit(1);
+            }
+        }
+    }
+
+    printf("--------------------------------------------------------------------------------\n");
+    printf("Running corpus tests...\n");
+    for (size_t i = 0; i < pathCount; ++i)
+    {
+        for_each_file(paths[i], corpus_run_file, &context);
+    }
+
+    for (size_t alg = 0; alg < ARRAYSIZE(context.results); ++alg)
+    {
+        if (context.results[alg].total.entries > 0)
+        {
+            corpus_print_results((deflate_algorithm)alg, &context.results[alg]);
+        }
+    }
+
+    entryCount = context.results[deflate_algorithm_deflate].total.entries +
+                 context.results[deflate_algorithm_deflate64].total.entries;
+    if (entryCount == 0)
+    {
+        printf("\nNOTE: No Deflate or Deflate64 data was measured\n");
+    }
+    if (context.skipped > 0)
+    {
+        printf("\nNOTE: %zu entries were skipped\n", context.skipped);
+    }
+    printf("\n");
+
+    for (size_t alg = 0; alg < ARRAYSIZE(context.results); ++alg)
+    {
+        for (size_t i = 0; i < context.results[alg].inflater_count; ++i)
+        {
+            (*context.results[alg].inflaters[i])->destroy((void*)context.results[alg].inflaters[i]);
+        }
+    }
+    free(context.output_buffer);
+}
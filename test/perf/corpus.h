@@ -0,0 +1,29 @@
+/*
+ *    Copyright (c) Microsoft. All rights reserved.
+ *    This code is licensed under the MIT License.
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF
+ *    ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+ *    TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ *    PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ */
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include "algorithms.h"
+
+/* Measures throughput over a user supplied corpus. Each path is either a file or a directory that is searched
+ * recursively, and each file is one of: a zip file, whose Deflate and Deflate64 entries are inflated in place; a gzip
+ * file, whose first member is inflated; or raw Deflate data, or Deflate64 data if its path contains "deflate64". Every
+ * entry is timed with each inflater for its algorithm and the results are reported grouped by uncompressed size and by
+ * compression ratio. Entries that fail to inflate are reported and skipped. If 'printEntries' is non-zero, the results
+ * for each entry are also displayed */
+void run_corpus_tests(
+    const char* const* paths,
+    size_t pathCount,
+    const pinflater* deflateInflaters,
+    size_t deflateInflaterCount,
+    const pinflater* deflate64Inflaters,
+    size_t deflate64InflaterCount,
+    int printEntries);
+
+#endif
@@ -28,6 +28,11 @@
 #include <stdlib.h>
 #endif
 
+#ifndef _WIN32
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
 char* resolve_test_file_path(const char* filename)
 {
     char* result = NULL;
@@ -102,18 +107,16 @@ char* resolve_test_file_path(const char* filename)
     return result;
 }
 
-file_data read_file(const char* filename)
+/* Reads the file at 'fullPath'. 'filename' is the name that the file is reported as, both in errors and in the result */
+static file_data read_file_at(const char* fullPath, const char* filename)
 {
     file_data result = {0};
-    char* fullPath = NULL;
     FILE* file = NULL;
     uint8_t* buffer = NULL;
     uint8_t* writeBuffer = NULL;
     long fileSize = 0;
     size_t bytesRemaining = 0;
 
-    fullPath = resolve_test_file_path(filename);
-
 #ifdef _WIN32
     if (fopen_s(&file, fullPath, "rb"))
     {
@@ -126,7 +129,10 @@ file_data read_file(const char* filename)
     if (!file)
     {
         printf("ERROR: Failed to open file '%s'\n", filename);
-        printf("NOTE: Full path is '%s'\n", fullPath);
+        if (fullPath != filename)
+        {
+            printf("NOTE: Full path is '%s'\n", fullPath);
+        }
         exit(1);
     }
 
@@ -209,7 +215,6 @@ file_data read_file(const char* filename)
             }
 
             fclose(file);
-            free(fullPath);
             return result;
         }
 
@@ -218,3 +223,186 @@ file_data read_file(const char* filename)
         bytesRemaining -= bytesRead;
     }
 }
+
+file_data read_file(const char* filename)
+{
+    char* fullPath = resolve_test_file_path(filename);
+    file_data result = read_file_at(fullPath, filename);
+    free(fullPath);
+    return result;
+}
+
+file_data read_file_path(const char* path)
+{
+    return read_file_at(path, path);
+}
+
+typedef enum path_type
+{
+    path_type_other = 0,
+    path_type_file = 1,
+    path_type_directory = 2,
+} path_type;
+
+static path_type get_path_type(const char* path)
+{
+#ifdef _WIN32
+    DWORD attributes = GetFileAttributesA(path);
+    if (attributes == INVALID_FILE_ATTRIBUTES)
+    {
+        return path_type_other;
+    }
+
+    return (attributes & FILE_ATTRIBUTE_DIRECTORY) ? path_type_directory : path_type_file;
+#else
+    struct stat info;
+    if (stat(path, &info) != 0)
+    {
+        return path_type_other;
+    }
+
+    return S_ISDIR(info.st_mode) ? path_type_directory : (S_ISREG(info.st_mode) ? path_type_file : path_type_other);
+#endif
+}
+
+static char* join_path(const char* directory, const char* name)
+{
+    size_t directoryLen = strlen(directory), nameLen = strlen(name);
+    char* result = (char*)malloc(directoryLen + 1 + nameLen + 1);
+    if (!result)
+    {
+        printf("ERROR: Failed to allocate space for path to file '%s'\n", name);
+        exit(1);
+    }
+
+    memcpy(result, directory, directoryLen);
+    result[directoryLen] = PATH_SEPARATOR_CHR;
+    memcpy(result + directoryLen + 1, name, nameLen + 1);
+    return result;
+}
+
+typedef struct name_list
+{
+    char** names;
+    size_t count;
+    size_t capacity;
+} name_list;
+
+static void name_list_push(name_list* list, const char* name)
+{
+    if (list->count == list->capacity)
+    {
+        list->capacity = list->capacity ? (list->capacity * 2) : 64;
+        list->names = (char**)realloc(list->names, list->capacity * sizeof(*list->names));
+        if (!list->names)
+        {
+            printf("ERROR: Failed to allocate space for directory contents\n");
+            exit(1);
+        }
+    }
+
+    list->names[list->count] = (char*)malloc(strlen(name) + 1);
+    if (!list->names[list->count])
+    {
+        printf("ERROR: Failed to allocate space for directory contents\n");
+        exit(1);
+    }
+    strcpy(list->names[list->count++], name);
+}
+
+static int compare_names(const void* lhs, const void* rhs)
+{
+    return strcmp(*(char* const*)lhs, *(char* const*)rhs);
+}
+
+/* Returns the names of everything in 'directory', other than "." and "..", in sorted order */
+static name_list list_directory(const char* directory)
+{
+    name_list result = {0};
+
+#ifdef _WIN32
+    WIN32_FIND_DATAA findData;
+    char* pattern = join_path(directory, "*");
+    HANDLE findHandle = FindFirstFileA(pattern, &findData);
+    free(pattern);
+    if (findHandle == INVALID_HANDLE_VALUE)
+    {
+        printf("ERROR: Failed to read directory '%s'\n", directory);
+        exit(1);
+    }
+
+    do
+    {
+        if ((strcmp(findData.cFileName, ".") != 0) && (strcmp(findData.cFileName, "..") != 0))
+        {
+            name_list_push(&result, findData.cFileName);
+        }
+    } while (FindNextFileA(findHandle, &findData));
+    FindClose(findHandle);
+#else
+    struct dirent* entry;
+    DIR* dir = opendir(directory);
+    if (!dir)
+    {
+        printf("ERROR: Failed to read directory '%s'\n", directory);
+        exit(1);
+    }
+
+    while ((entry = readdir(dir)) != NULL)
+    {
+        if ((strcmp(entry->d_name, ".") != 0) && (strcmp(entry->d_name, "..") != 0))
+        {
+            name_list_push(&result, entry->d_name);
+        }
+    }
+    closedir(dir);
+#endif
+
+    if (result.count > 1)
+    {
+        qsort(result.names, result.count, sizeof(*result.names), compare_names);
+    }
+    return result;
+}
+
+void for_each_file(const char* path, void (*callback)(const char* path, void* context), void* context)
+{
+    name_list contents;
+
+    switch (get_path_type(path))
+    {
+    case path_type_file:
+        callback(path, context);
+        return;
+
+    case path_type_directory:
+        break;
+
+    default:
+        printf("ERROR: '%s' is not a file or directory\n", path);
+        exit(1);
+    }
+
+    contents = list_directory(path);
+    for (size_t i = 0; i < contents.count; ++i)
+    {
+        char* childPath = join_path(path, contents.names[i]);
+        switch (get_path_type(childPath))
+        {
+        case path_type_file:
+            callback(childPath, context);
+            break;
+
+        case path_type_directory:
+            for_each_file(childPath, callback, context);
+            break;
+
+        default:
+            break; /* E.g. devices, sockets, or broken links */
+        }
+
+        free(childPath);
+        free(contents.names[i]);
+    }
+    free(contents.names);
+}
@@ -11,7 +11,7 @@
 
 typedef struct file_data
 {
-    const char* filename; /* NOTE: Holds pointer to string literal; no need to free */
+    const char* filename; /* NOTE: Holds the pointer passed to 'read_file'/'read_file_path'; no need to free */
     uint8_t* buffer;
     size_t bytes;
 } file_data;
@@ -19,4 +19,12 @@ typedef struct file_data
 /* Returns the number of bytes read. No file is empty, so zero means failure */
 file_data read_file(const char* filename);
 
+/* Same as 'read_file', only 'path' is used as-is rather than being resolved relative to the test data directory */
+file_data read_file_path(const char* path);
+
+/* Calls 'callback' with the path of each regular file at 'path', which is either a file or a directory that is searched
+ * recursively. The files in each directory are visited in sorted order so that runs are repeatable. Failures are
+ * reported and exit the process */
+void for_each_file(const char* path, void (*callback)(const char* path, void* context), void* context);
+
 #endif
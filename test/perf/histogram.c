@@ -8,6 +8,8 @@
  */
 #include "pch.h"
 
+#include <math.h>
+
 #include "histogram.h"
 
 int histogram_init(histogram* self, size_t capacity)
@@ -92,6 +94,43 @@ void histogram_finalize(histogram* self)
     }
 }
 
+double histogram_confidence_interval(const histogram* self)
+{
+    double sum = 0, mean, variance = 0;
+
+    if (self->size < 2)
+    {
+        return HUGE_VAL; /* Not enough data to say anything */
+    }
+
+    for (size_t i = 0; i < self->size; ++i)
+    {
+        sum += self->counts[i];
+    }
+    mean = sum / (double)self->size;
+    if (mean == 0)
+    {
+        return 0;
+    }
+
+    for (size_t i = 0; i < self->size; ++i)
+    {
+        double delta = self->counts[i] - mean;
+        variance += delta * delta;
+    }
+    variance /= (double)(self->size - 1);
+
+    /* 95% of a normal distribution lies within 1.96 standard deviations of its mean */
+    return (1.96 * sqrt(variance / (double)self->size) * 100.0) / mean;
+}
+
+uint64_t histogram_percentile(histogram* self, double percentile)
+{
+    size_t index = (size_t)((percentile / 100.0) * (double)(self->size - 1) + 0.5);
+    assert(self->size > 0);
+    return self->counts[index];
+}
+
 histogram_buckets histogram_bucketize(histogram* self, uint64_t start, uint64_t stride, size_t bucketCount)
 {
     histogram_buckets result = {0};
@@ -148,3 +187,31 @@ void histogram_destroy_buckets(histogram_buckets* self)
 
     memset(self, 0, sizeof(*self));
 }
+
+histogram_outliers histogram_find_outliers(histogram* self)
+{
+    histogram_outliers result = {0};
+    double firstQuartile = (double)histogram_percentile(self, 25);
+    double thirdQuartile = (double)histogram_percentile(self, 75);
+    double range = thirdQuartile - firstQuartile;
+
+    result.low_fence = firstQuartile - (1.5 * range);
+    if (result.low_fence < 0)
+    {
+        result.low_fence = 0; /* No value can be below this anyway */
+    }
+    result.high_fence = thirdQuartile + (1.5 * range);
+    for (size_t i = 0; i < self->size; ++i)
+    {
+        if (self->counts[i] < result.low_fence)
+        {
+            ++result.low_count;
+        }
+        else if (self->counts[i] > result.high_fence)
+        {
+            ++result.high_count;
+        }
+    }
+
+    return result;
+}
@@ -36,6 +36,16 @@ typedef struct histogram_buckets
     uint64_t stride;
 } histogram_buckets;
 
+/* Outliers according to Tukey's fences: values more than 1.5 times the interquartile range below the first quartile or
+ * above the third quartile */
+typedef struct histogram_outliers
+{
+    double low_fence;
+    double high_fence;
+    size_t low_count;
+    size_t high_count;
+} histogram_outliers;
+
 /* Returns 1 on success, 0 on failure */
 int histogram_init(histogram* self, size_t capacity);
 
@@ -47,10 +57,19 @@ int histogram_push(histogram* self, uint64_t value);
 /* Called when all data has been added to the histogram */
 void histogram_finalize(histogram* self);
 
+/* Returns the half-width of the 95% confidence interval of the mean as a percentage of the mean, using the normal
+ * approximation. This can be called before 'finalize' */
+double histogram_confidence_interval(const histogram* self);
+
 /* All of the remaining functions can only be called after 'finalize' has been called */
 
+/* Returns the smallest value that is greater than or equal to 'percentile' percent of the data, e.g. 99.9 */
+uint64_t histogram_percentile(histogram* self, double percentile);
+
 histogram_buckets histogram_bucketize(histogram* self, uint64_t start, uint64_t stride, size_t bucketCount);
 
+histogram_outliers histogram_find_outliers(histogram* self);
+
 void histogram_destroy_buckets(histogram_buckets* self);
 
 #endif
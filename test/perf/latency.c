@@ -0,0 +1,340 @@
+/*
+ *    Copyright (c) Microsoft. All rights reserved.
+ *    This code is licensed under the MIT License.
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF
+ *    ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+ *    TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ *    PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ */
+#include "pch.h"
+
+#include <zlib.h>
+
+#include "histogram.h"
+#include "latency.h"
+#include "timer.h"
+
+/* Number of messages generated for each block type, the range of their uncompressed sizes, and the number of times the
+ * whole corpus is inflated. The init and reset phases therefore collect 'LATENCY_MESSAGE_COUNT * 2 * latency_iterations'
+ * samples, and the static and dynamic phases collect half as many each, which is plenty for the 99.9th percentile */
+#define LATENCY_MESSAGE_COUNT 256
+static const size_t latency_min_message_size = 100;
+static const size_t latency_max_message_size = 2048;
+static const size_t latency_iterations = 100;
+
+typedef enum latency_phase
+{
+    latency_phase_init,
+    latency_phase_reset,
+    latency_phase_first_byte_static,
+    latency_phase_first_byte_dynamic,
+    latency_phase_message_static,
+    latency_phase_message_dynamic,
+    latency_phase_count,
+} latency_phase;
+
+static const char* const latency_phase_names[] = {
+    "init",
+    "reset",
+    "first byte (static)",
+    "first byte (dynamic)",
+    "message (static)",
+    "message (dynamic)",
+};
+
+typedef struct latency_message
+{
+    uint8_t* data;
+    size_t size;
+    uint8_t* compressed;
+    size_t compressed_size;
+} latency_message;
+
+/* Simple xorshift generator so that the corpus is the same on every run and every platform */
+static uint32_t latency_random(uint32_t* state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+/* Fills 'data' with JSON-like key/value pairs, which is representative of the repetitive, text heavy payloads that small
+ * messages tend to carry */
+static void latency_generate_text(uint8_t* data, size_t size, uint32_t* state)
+{
+    static const char* const words[] = {"id", "user", "name", "status", "ok", "error", "request", "response", "timestamp",
+        "value", "items", "count", "token", "session", "region", "us-east", "eu-west", "true", "false", "null"};
+    char pair[64];
+    size_t offset = 0;
+
+    data[offset++] = '{';
+    while (offset < size)
+    {
+        int len = snprintf(pair, sizeof(pair), "\"%s\":\"%s%u\",", words[latency_random(state) % ARRAYSIZE(words)],
+            words[latency_random(state) % ARRAYSIZE(words)], (unsigned)(latency_random(state) % 1000));
+        size_t copy = (size - offset < (size_t)len) ? (size - offset) : (size_t)len;
+        memcpy(data + offset, pair, copy);
+        offset += copy;
+    }
+}
+
+/* Returns 1 if the compressed data starts with a block of the specified type */
+static int latency_compress(latency_message* message, int strategy)
+{
+    z_stream stream = {0};
+    uLong bound;
+
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, strategy) != Z_OK)
+    {
+        return 0;
+    }
+
+    bound = deflateBound(&stream, (uLong)message->size);
+    message->compressed = (uint8_t*)malloc(bound);
+    if (!message->compressed)
+    {
+        deflateEnd(&stream);
+        return 0;
+    }
+
+    stream.next_in = message->data;
+    stream.avail_in = (uInt)message->size;
+    stream.next_out = message->compressed;
+    stream.avail_out = (uInt)bound;
+    if (deflate(&stream, Z_FINISH) != Z_STREAM_END)
+    {
+        deflateEnd(&stream);
+        return 0;
+    }
+
+    message->compressed_size = bound - stream.avail_out;
+    deflateEnd(&stream);
+    return 1;
+}
+
+/* Generates a message whose first block has the type 'blockType' (1 for static, 2 for dynamic). zlib picks whichever
+ * block type is smaller, so text that it chooses to encode differently is discarded and regenerated */
+static void latency_generate_message(latency_message* message, int blockType, uint32_t* state)
+{
+    for (int attempt = 0;; ++attempt)
+    {
+        size_t range = latency_max_message_size - latency_min_message_size + 1;
+        message->size = latency_min_message_size + (latency_random(state) % range);
+        message->data = (uint8_t*)malloc(message->size);
+        if (!message->data)
+        {
+            printf("ERROR: Failed to allocate memory for the latency corpus\n");
+            exit(1);
+        }
+
+        latency_generate_text(message->data, message->size, state);
+        if (!latency_compress(message, (blockType == 1) ? Z_FIXED : Z_DEFAULT_STRATEGY))
+        {
+            printf("ERROR: Failed to compress the latency corpus\n");
+            exit(1);
+        }
+
+        if ((((message->compressed[0] >> 1) & 0x03) == blockType) || (attempt >= 100))
+        {
+            return;
+        }
+
+        free(message->data);
+        free(message->compressed);
+    }
+}
+
+static void latency_print_range(const char* name, const latency_message* messages)
+{
+    size_t minSize = SIZE_MAX, maxSize = 0, total = 0, totalCompressed = 0;
+    for (size_t i = 0; i < LATENCY_MESSAGE_COUNT; ++i)
+    {
+        minSize = (messages[i].size < minSize) ? messages[i].size : minSize;
+        maxSize = (messages[i].size > maxSize) ? messages[i].size : maxSize;
+        total += messages[i].size;
+        totalCompressed += messages[i].compressed_size;
+    }
+
+    printf("    %d %s messages, %zu to %zu bytes (%zu bytes average, %.1f%% compressed size)\n", LATENCY_MESSAGE_COUNT, name,
+        minSize, maxSize, total / LATENCY_MESSAGE_COUNT, ((double)totalCompressed * 100.0) / (double)total);
+}
+
+void run_latency_tests(const pinflater* inflaters, size_t inflaterCount)
+{
+    latency_message staticMessages[LATENCY_MESSAGE_COUNT];
+    latency_message dynamicMessages[LATENCY_MESSAGE_COUNT];
+    const latency_message* corpus[2 * LATENCY_MESSAGE_COUNT];
+    histogram* results;
+    uint8_t* outputBuffer;
+    uint64_t timerOverhead = UINT64_MAX;
+    uint32_t state = 0x12345678;
+
+    for (size_t i = 0; i < LATENCY_MESSAGE_COUNT; ++i)
+    {
+        latency_generate_message(&staticMessages[i], 1, &state);
+        latency_generate_message(&dynamicMessages[i], 2, &state);
+
+        /* Alternate static and dynamic messages so that neither is favored by a warm branch predictor */
+        corpus[i * 2] = &staticMessages[i];
+        corpus[i * 2 + 1] = &dynamicMessages[i];
+    }
+
+    outputBuffer = (uint8_t*)malloc(latency_max_message_size);
+    results = (histogram*)malloc(inflaterCount * latency_phase_count * sizeof(*results));
+    if (!outputBuffer || !results)
+    {
+        printf("ERROR: Failed to allocate memory for the latency tests\n");
+        exit(1);
+    }
+
+    for (size_t i = 0; i < inflaterCount * latency_phase_count; ++i)
+    {
+        if (!histogram_init(&results[i], LATENCY_MESSAGE_COUNT * 2 * latency_iterations))
+        {
+            printf("ERROR: Failed to initialize histogram\n");
+            exit(1);
+        }
+    }
+
+    printf("--------------------------------------------------------------------------------\n");
+    printf("Running small message latency tests for Deflate...\n");
+    latency_print_range("static", staticMessages);
+    latency_print_range("dynamic", dynamicMessages);
+
+    for (size_t i = 0; i < inflaterCount; ++i)
+    {
+        if (!(*inflaters[i])->init((void*)inflaters[i]))
+        {
+            printf("ERROR: Failed to initialize inflater\n");
+            exit(1);
+        }
+    }
+
+    /* Time spent reading the clock is included in every sample; report it so that it can be accounted for */
+    for (int i = 0; i < 1000; ++i)
+    {
+        uint64_t start = current_time();
+        uint64_t elapsed = current_time() - start;
+        timerOverhead = (elapsed < timerOverhead) ? elapsed : timerOverhead;
+    }
+
+    for (size_t iteration = 0; iteration < latency_iterations; ++iteration)
+    {
+        for (size_t messageIndex = 0; messageIndex < ARRAYSIZE(corpus); ++messageIndex)
+        {
+            const latency_message* message = corpus[messageIndex];
+            int dynamic = (messageIndex % 2) != 0;
+
+            /* Inflaters are interleaved per message so that drift over the run (e.g. frequency scaling) affects all of
+             * them equally */
+            for (size_t inflaterIndex = 0; inflaterIndex < inflaterCount; ++inflaterIndex)
+            {
+                void* inflater = (void*)inflaters[inflaterIndex];
+                const inflater_vtable* vtable = *inflaters[inflaterIndex];
+                histogram* phases = results + (inflaterIndex * latency_phase_count);
+                uint64_t times[latency_phase_count];
+                size_t inputSize, outputSize;
+                inflate_result result;
+                uint64_t start;
+
+                vtable->destroy(inflater);
+                start = current_time();
+                if (!vtable->init(inflater))
+                {
+                    printf("ERROR: Failed to initialize %s for a latency test message\n", vtable->name(inflater));
+                    exit(1);
+                }
+                times[latency_phase_init] = current_time() - start;
+
+                inputSize = message->compressed_size;
+                outputSize = 1;
+                start = current_time();
+                result = vtable->inflate_buffer(inflater, message->compressed, &inputSize, outputBuffer, &outputSize);
+                if (result == inflate_result_error)
+                {
+                    printf("ERROR: %s failed to inflate the first byte of a latency test message\n", vtable->name(inflater));
+                    exit(1);
+                }
+                times[dynamic ? latency_phase_first_byte_dynamic : latency_phase_first_byte_static] = current_time() - start;
+
+                start = current_time();
+                vtable->reset(inflater);
+                times[latency_phase_reset] = current_time() - start;
+
+                inputSize = message->compressed_size;
+                outputSize = latency_max_message_size;
+                start = current_time();
+                result = vtable->inflate_buffer(inflater, message->compressed, &inputSize, outputBuffer, &outputSize);
+                if (result != inflate_result_eof)
+                {
+                    printf("ERROR: %s failed to inflate a latency test message\n", vtable->name(inflater));
+                    exit(1);
+                }
+                times[dynamic ? latency_phase_message_dynamic : latency_phase_message_static] = current_time() - start;
+
+                /* Tests for validity are done elsewhere; this is just a sanity check and isn't timed */
+                if ((outputSize != message->size) || (memcmp(outputBuffer, message->data, outputSize) != 0))
+                {
+                    printf("ERROR: %s produced incorrect output for a latency test message\n", vtable->name(inflater));
+                    exit(1);
+                }
+
+                histogram_push(&phases[latency_phase_init], times[latency_phase_init]);
+                histogram_push(&phases[latency_phase_reset], times[latency_phase_reset]);
+                if (dynamic)
+                {
+                    histogram_push(&phases[latency_phase_first_byte_dynamic], times[latency_phase_first_byte_dynamic]);
+                    histogram_push(&phases[latency_phase_message_dynamic], times[latency_phase_message_dynamic]);
+                }
+                else
+                {
+                    histogram_push(&phases[latency_phase_first_byte_static], times[latency_phase_first_byte_static]);
+                    histogram_push(&phases[latency_phase_message_static], times[latency_phase_message_static]);
+                }
+            }
+        }
+    }
+
+    printf("\nSummary for small message latency (includes timer overhead of %.3f us):\n\n", time_to_ms(timerOverhead) * 1000.0);
+    printf("  Algorithm  |        Phase         |   p50 (us)   |   p99 (us)   |  p99.9 (us)  |   Max (us)\n");
+    printf("-------------+----------------------+--------------+--------------+--------------+--------------\n");
+    for (size_t inflaterIndex = 0; inflaterIndex < inflaterCount; ++inflaterIndex)
+    {
+        void* inflater = (void*)inflaters[inflaterIndex];
+        for (size_t phase = 0; phase < latency_phase_count; ++phase)
+        {
+            histogram* data = &results[inflaterIndex * latency_phase_count + phase];
+            histogram_finalize(data);
+            printf(
+                "%12s | %-20s | %12.3f | %12.3f | %12.3f | %12.3f\n",
+                (phase == 0) ? (*inflaters[inflaterIndex])->name(inflater) : "",
+                latency_phase_names[phase],
+                time_to_ms(histogram_percentile(data, 50.0)) * 1000.0,
+                time_to_ms(histogram_percentile(data, 99.0)) * 1000.0,
+                time_to_ms(histogram_percentile(data, 99.9)) * 1000.0,
+                time_to_ms(data->max) * 1000.0);
+        }
+    }
+    printf("\n");
+
+    for (size_t i = 0; i < inflaterCount; ++i)
+    {
+        (*inflaters[i])->destroy((void*)inflaters[i]);
+    }
+
+    for (size_t i = 0; i < inflaterCount * latency_phase_count; ++i)
+    {
+        histogram_destroy(&results[i]);
+    }
+    free(results);
+    free(outputBuffer);
+    for (size_t i = 0; i < LATENCY_MESSAGE_COUNT; ++i)
+    {
+        free(staticMessages[i].data);
+        free(staticMessages[i].compressed);
+        free(dynamicMessages[i].data);
+        free(dynamicMessages[i].compressed);
+    }
+}
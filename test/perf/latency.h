@@ -0,0 +1,21 @@
+/*
+ *    Copyright (c) Microsoft. All rights reserved.
+ *    This code is licensed under the MIT License.
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF
+ *    ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+ *    TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ *    PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ */
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include "algorithms.h"
+
+/* Measures per-message latency for small Deflate messages, such as those sent over RPC, where the cost is dominated by
+ * stream setup rather than throughput. The corpus is generated with zlib, half as static blocks and half as dynamic
+ * blocks, and each message is timed in four separate phases: 'init' (a freshly initialized stream), 'first byte' (the
+ * first inflate call on the new stream, limited to a single byte of output), 'reset', and 'message' (inflating the whole
+ * message on the reset stream in a single call). Failures are reported and exit the process */
+void run_latency_tests(const pinflater* inflaters, size_t inflaterCount);
+
+#endif
@@ -14,16 +14,22 @@
 #include <inflatelib.h>
 
 #include "algorithms.h"
+#include "corpus.h"
 #include "histogram.h"
+#include "latency.h"
+#include "methodology.h"
+#include "soak.h"
+#include "timer.h"
 
-#ifdef _WIN32
-#include <Windows.h>
-#else
-#include <time.h>
-#endif
+/* Enough to get a reasonable amount of data. Use 'iterations=<count>' to change this */
+static const size_t default_test_iterations = 1000;
 
-/* Enough to get a reasonable amount of data */
-static const size_t test_iterations = 1000;
+/* When targeting a confidence interval with 'confidence=<percent>', at least 'adaptive_min_iterations' are run and the
+ * interval is checked every 'adaptive_check_interval' iterations after that. Unless 'iterations=<count>' is also given,
+ * the run stops after 'default_adaptive_max_iterations' even if the target is never reached */
+static const size_t adaptive_min_iterations = 30;
+static const size_t adaptive_check_interval = 50;
+static const size_t default_adaptive_max_iterations = 10000;
 
 /* The files we test for decoding */
 static const char* const deflate_files[] = {
@@ -60,10 +66,34 @@ typedef struct test_desc
      *      + For the per-file histograms: result[inflater_count + (file_index * inflater_count) + inflater_index]
      */
     histogram* results;
+
+    /* Time spent in each phase of decoding, summed over all iterations, for inflaters that record it. This is indexed
+     * the same as the per-file histograms, without the leading per-inflater entries. Null if no inflater records it */
+    inflatelib_phase_times* phases;
+
+    /* The number of timed iterations that were run. This is fewer than the histograms' capacity if a confidence target
+     * was reached early */
+    size_t iterations;
 } test_desc;
 
+/* Controls how 'run_tests' takes its measurements. See 'main' for the corresponding arguments */
+typedef struct run_options
+{
+    size_t warmup_iterations; /* Untimed iterations run before measuring */
+    size_t iterations;        /* Timed iterations to run; the maximum if 'confidence' is set */
+    double confidence; /* If non-zero, stop once each 95% confidence interval of total runtime is within this percent */
+    int shuffle;       /* Inflate the files with the inflaters in a random order each iteration */
+    int flush;         /* Evict the caches before inflating each file */
+} run_options;
+
 static void test_desc_init(
-    test_desc* self, deflate_algorithm alg, const char* const* fileNames, size_t fileCount, const pinflater* inflaters, size_t inflaterCount)
+    test_desc* self,
+    deflate_algorithm alg,
+    const char* const* fileNames,
+    size_t fileCount,
+    const pinflater* inflaters,
+    size_t inflaterCount,
+    size_t maxIterations)
 {
     size_t histogramCount = inflaterCount * (fileCount + 1);
 
@@ -108,12 +138,28 @@ static void test_desc_init(
     /* Initialize the histograms */
     for (size_t i = 0; i < histogramCount; ++i)
     {
-        if (!histogram_init(&self->results[i], test_iterations))
+        if (!histogram_init(&self->results[i], maxIterations))
         {
             printf("ERROR: Failed to initialize histogram\n");
             exit(1);
         }
     }
+
+    /* Phase times are only available when inflatelib is built with 'INFLATELIB_PHASE_TIMING' */
+    for (size_t i = 0; i < inflaterCount; ++i)
+    {
+        inflatelib_phase_times times;
+        if ((*inflaters[i])->phase_times && (*inflaters[i])->phase_times((void*)inflaters[i], &times))
+        {
+            self->phases = (inflatelib_phase_times*)calloc(inflaterCount * fileCount, sizeof(*self->phases));
+            if (!self->phases)
+            {
+                printf("ERROR: Failed to allocate space for phase times\n");
+                exit(1);
+            }
+            break;
+        }
+    }
 }
 
 static histogram* test_desc_file_histogram(test_desc* self, size_t inflaterIndex, size_t fileIndex)
@@ -121,58 +167,11 @@ static histogram* test_desc_file_histogram(test_desc* self, size_t inflaterIndex
     return &self->results[self->inflater_count + (fileIndex * self->inflater_count) + inflaterIndex];
 }
 
-#ifdef _WIN32
-static uint64_t current_time(void)
-{
-    LARGE_INTEGER result;
-    BOOL success = QueryPerformanceCounter(&result);
-    (void)success; /* Only used for assert */
-    assert(success);
-
-    return (uint64_t)result.QuadPart;
-}
-
-static double time_to_ms(uint64_t time)
-{
-    LARGE_INTEGER frequency;
-    BOOL success = QueryPerformanceFrequency(&frequency);
-    (void)success; /* Only used for assert */
-    assert(success);
-
-    return ((double)time / (double)frequency.QuadPart) * 1000.0;
-}
-
-static double time_to_ms_f(double time)
-{
-    LARGE_INTEGER frequency;
-    BOOL success = QueryPerformanceFrequency(&frequency);
-    (void)success; /* Only used for assert */
-    assert(success);
-
-    return (time / (double)frequency.QuadPart) * 1000.0;
-}
-#else
-static uint64_t current_time(void)
-{
-    struct timespec result;
-    int success = clock_gettime(CLOCK_MONOTONIC, &result);
-    (void)success; /* Only used for assert */
-    assert(success);
-
-    return (uint64_t)result.tv_sec * 1000000000ull + (uint64_t)result.tv_nsec;
-}
-
-static double time_to_ms(uint64_t time)
+static inflatelib_phase_times* test_desc_file_phases(test_desc* self, size_t inflaterIndex, size_t fileIndex)
 {
-    return (double)time / 1000000.0;
+    return &self->phases[(fileIndex * self->inflater_count) + inflaterIndex];
 }
 
-static double time_to_ms_f(double time)
-{
-    return time / 1000000.0;
-}
-#endif
-
 typedef enum
 {
     pf_quiet = 0, /* No output */
@@ -188,9 +187,14 @@ typedef enum
     pf_summarize_all = pf_summarize_totals | pf_summarize_files,
 
     pf_all = pf_display_all | pf_summarize_all,
+
+    /* Only displayed when requested */
+    pf_display_outliers = 1 << 4,
 } print_flags;
 
-static int run_tests(test_desc* data, print_flags printFlags);
+static int run_tests(test_desc* data, print_flags printFlags, const run_options* options);
+static void print_phase_times(test_desc* data, size_t fileIndex);
+static void print_memory_usage(test_desc* data);
 
 /* A very simple structure for determining if an argument is present or not */
 typedef struct
@@ -199,6 +203,27 @@ typedef struct
     int set;
 } cmd_arg;
 
+/* If 'arg' has the form '<name>=<value>', returns a pointer to '<value>', otherwise null */
+static const char* arg_value(const char* arg, const char* name)
+{
+    size_t nameLen = strlen(name);
+    return ((strncmp(arg, name, nameLen) == 0) && (arg[nameLen] == '=')) ? (arg + nameLen + 1) : NULL;
+}
+
+/* Parses the value of 'arg' as a non-negative integer, exiting if it is invalid */
+static uint64_t parse_integer_arg(const char* arg, const char* value)
+{
+    char* end;
+    uint64_t result = strtoull(value, &end, 10);
+    if ((*value < '0') || (*value > '9') || (*end != '\0'))
+    {
+        printf("ERROR: Invalid value in argument '%s'\n", arg);
+        exit(1);
+    }
+
+    return result;
+}
+
 int main(int argc, char** argv)
 {
     int result = 0;
@@ -220,6 +245,20 @@ int main(int argc, char** argv)
     cmd_arg print_table = {"table", 0};         /* Print summary table */
     cmd_arg print_totals = {"totals", 0};       /* Print total runtime */
     cmd_arg print_files = {"files", 0};         /* Print per-file data */
+    cmd_arg streaming = {"streaming", 0};       /* Feed input & output through small buffers */
+    cmd_arg print_memory = {"memory", 0};       /* Print peak memory allocated by each inflater */
+    cmd_arg latency = {"latency", 0};           /* Measure small message latency instead of file throughput */
+    cmd_arg soak = {"soak", 0};                 /* Inflate multi-GiB generated streams instead of the test files */
+    uint64_t soakGiB = SOAK_DEFAULT_GIB;
+    const char** corpusPaths = NULL; /* Inflate these files and directories instead of the test files */
+    size_t corpusPathCount = 0;
+    cmd_arg shuffle = {"shuffle", 0};            /* Randomize the order of inflaters and files in each iteration */
+    cmd_arg flush = {"flush", 0};                /* Evict the caches before each file is inflated */
+    cmd_arg print_outliers = {"outliers", 0};    /* Print outliers and confidence intervals */
+    run_options runOptions = {0, default_test_iterations, 0, 0, 0};
+    int iterationsSet = 0, affinitySet = 0;
+    unsigned affinityCpu = 0;
+    const char* value;
 
     cmd_arg* args[] = {
         &test_inflatelib,
@@ -230,6 +269,13 @@ int main(int argc, char** argv)
         &print_table,
         &print_totals,
         &print_files,
+        &streaming,
+        &print_memory,
+        &latency,
+        &soak,
+        &shuffle,
+        &flush,
+        &print_outliers,
     };
 
     /* If the caller supplied arguments, then the inflaters we want to use for the tests come from the command line */
@@ -239,6 +285,67 @@ int main(int argc, char** argv)
         for (int i = 1; i < argc; ++i)
         {
             int found = 0;
+            if (strncmp(argv[i], "soak=", 5) == 0)
+            {
+                /* The soak tests optionally take the number of GiB to inflate per stream */
+                soakGiB = strtoull(argv[i] + 5, NULL, 10);
+                if (soakGiB == 0)
+                {
+                    printf("ERROR: Invalid soak size '%s'\n", argv[i] + 5);
+                    exit(1);
+                }
+                soak.set = 1;
+                continue;
+            }
+            else if (strncmp(argv[i], "corpus=", 7) == 0)
+            {
+                if (!corpusPaths)
+                {
+                    corpusPaths = (const char**)malloc(argc * sizeof(*corpusPaths));
+                    if (!corpusPaths)
+                    {
+                        printf("ERROR: Failed to allocate space for corpus paths\n");
+                        exit(1);
+                    }
+                }
+                corpusPaths[corpusPathCount++] = argv[i] + 7;
+                continue;
+            }
+            else if ((value = arg_value(argv[i], "warmup")) != NULL)
+            {
+                runOptions.warmup_iterations = (size_t)parse_integer_arg(argv[i], value);
+                continue;
+            }
+            else if ((value = arg_value(argv[i], "iterations")) != NULL)
+            {
+                runOptions.iterations = (size_t)parse_integer_arg(argv[i], value);
+                if (runOptions.iterations == 0)
+                {
+                    printf("ERROR: Invalid value in argument '%s'\n", argv[i]);
+                    exit(1);
+                }
+                iterationsSet = 1;
+                continue;
+            }
+            else if ((value = arg_value(argv[i], "confidence")) != NULL)
+            {
+                /* The target half-width of the 95% confidence interval, as a percentage of the mean */
+                char* end;
+                runOptions.confidence = strtod(value, &end);
+                if ((end == value) || (*end != '\0') || !(runOptions.confidence > 0) || (runOptions.confidence >= 100))
+                {
+                    printf("ERROR: Invalid value in argument '%s'\n", argv[i]);
+                    exit(1);
+                }
+                continue;
+            }
+            else if ((value = arg_value(argv[i], "affinity")) != NULL)
+            {
+                affinityCpu = (unsigned)parse_integer_arg(argv[i], value);
+                affinitySet = 1;
+                continue;
+            }
+
             for (size_t j = 0; j < ARRAYSIZE(args); ++j)
             {
                 if (strcmp(argv[i], args[j]->name) == 0)
@@ -256,6 +363,19 @@ int main(int argc, char** argv)
             }
         }
 
+        if (streaming.set)
+        {
+            input_chunk_size = streaming_chunk_size;
+            output_chunk_size = streaming_chunk_size;
+        }
+
+        if ((runOptions.confidence > 0) && !iterationsSet)
+        {
+            runOptions.iterations = default_adaptive_max_iterations;
+        }
+        runOptions.shuffle = shuffle.set;
+        runOptions.flush = flush.set;
+
         if (!test_inflatelib.set && !test_zlib.set && !test_inflatelib64.set)
         {
             /* Testing everything */
@@ -313,6 +433,16 @@ int main(int argc, char** argv)
                 printFlags |= pf_summarize_files;
             }
         }
+
+        if (print_outliers.set)
+        {
+            if (print_quiet.set)
+            {
+                printf("ERROR: Cannot use 'quiet' with 'outliers'\n");
+                exit(1);
+            }
+            printFlags |= pf_display_outliers;
+        }
     }
     else
     {
@@ -335,21 +465,85 @@ int main(int argc, char** argv)
     }
     if (test_inflatelib64.set)
     {
+#ifdef INFLATELIB_SMALL_FOOTPRINT
+        printf("NOTE: Skipping 'inflatelib64' since this build of inflatelib does not support Deflate64\n");
+#else
         deflate64Inflaters[deflate64InflaterCount++] = &inflatelib_inflater64.vtable;
+#endif
+    }
+
+    if (affinitySet && !set_cpu_affinity(affinityCpu))
+    {
+        printf("ERROR: Failed to pin the process to CPU %u\n", affinityCpu);
+        printf("NOTE: The CPU must be available to this process, and this is only supported on Windows and Linux\n");
+        exit(1);
+    }
+
+    if (latency.set)
+    {
+        /* The latency tests generate their own Deflate corpus in place of the test files */
+        if (deflateInflaterCount > 0)
+        {
+            run_latency_tests(deflateInflaters, deflateInflaterCount);
+        }
+        return 0;
+    }
+
+    if (soak.set)
+    {
+        if (deflateInflaterCount > 0)
+        {
+            run_soak_tests(deflate_algorithm_deflate, deflateInflaters, deflateInflaterCount, soakGiB);
+        }
+        if (deflate64InflaterCount > 0)
+        {
+            run_soak_tests(deflate_algorithm_deflate64, deflate64Inflaters, deflate64InflaterCount, soakGiB);
+        }
+        return 0;
+    }
+
+    if (corpusPathCount > 0)
+    {
+        run_corpus_tests(corpusPaths, corpusPathCount, deflateInflaters, deflateInflaterCount, deflate64Inflaters,
+            deflate64InflaterCount, print_files.set);
+        free(corpusPaths);
+        return 0;
     }
 
-    test_desc_init(&deflate_tests, deflate_algorithm_deflate, deflate_files, ARRAYSIZE(deflate_files), deflateInflaters, deflateInflaterCount);
-    test_desc_init(&deflate64_tests, deflate_algorithm_deflate64, deflate64_files, ARRAYSIZE(deflate64_files), deflate64Inflaters, deflate64InflaterCount);
+    test_desc_init(
+        &deflate_tests,
+        deflate_algorithm_deflate,
+        deflate_files,
+        ARRAYSIZE(deflate_files),
+        deflateInflaters,
+        deflateInflaterCount,
+        runOptions.iterations);
+    test_desc_init(
+        &deflate64_tests,
+        deflate_algorithm_deflate64,
+        deflate64_files,
+        ARRAYSIZE(deflate64_files),
+        deflate64Inflaters,
+        deflate64InflaterCount,
+        runOptions.iterations);
 
     /* Finally, run the tests */
     if (deflateInflaterCount > 0)
     {
-        result += run_tests(&deflate_tests, printFlags);
+        result += run_tests(&deflate_tests, printFlags, &runOptions);
+        if (print_memory.set)
+        {
+            print_memory_usage(&deflate_tests);
+        }
     }
 
     if (deflate64InflaterCount > 0)
     {
-        result += run_tests(&deflate64_tests, printFlags);
+        result += run_tests(&deflate64_tests, printFlags, &runOptions);
+        if (print_memory.set)
+        {
+            print_memory_usage(&deflate64_tests);
+        }
     }
 
     /* NOTE: Exiting process; no need to clean up */
@@ -358,13 +552,49 @@ int main(int argc, char** argv)
 
 void print_test_histogram(test_desc* tests, histogram* data, const char* title, size_t count, uint32_t width, uint32_t height, print_flags printFlags);
 
-static int run_tests(test_desc* data, print_flags printFlags)
+static void accumulate_phase_times(test_desc* data, size_t inflaterIndex, size_t fileIndex)
+{
+    pinflater inflater = data->inflaters[inflaterIndex];
+    inflatelib_phase_times* total = test_desc_file_phases(data, inflaterIndex, fileIndex);
+    inflatelib_phase_times times;
+
+    if (!(*inflater)->phase_times || !(*inflater)->phase_times((void*)inflater, &times))
+    {
+        return;
+    }
+
+    total->unit = times.unit;
+    for (size_t i = 0; i < INFLATELIB_PHASE_COUNT; ++i)
+    {
+        total->ticks[i] += times.ticks[i];
+    }
+}
+
+/* Returns 1 once the 95% confidence interval of every inflater's mean total runtime is within 'target' percent */
+static int confidence_reached(test_desc* data, double target)
+{
+    for (size_t i = 0; i < data->inflater_count; ++i)
+    {
+        if (histogram_confidence_interval(&data->results[i]) > target)
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static int run_tests(test_desc* data, print_flags printFlags, const run_options* options)
 {
     /* The main purpose of this variable is to discourage the compiler from making some optimizations we would like to
      * avoid (such as dead writes, etc.)*/
     int result = 0;
     uint8_t* outputBuffer = NULL;
     uint64_t* times = NULL;
+    size_t* order = NULL;
+    size_t runCount = data->inflater_count * data->file_count;
+    random_state rng = RANDOM_STATE_INIT;
+    size_t iteration;
 
     if (printFlags)
     {
@@ -379,53 +609,136 @@ static int run_tests(test_desc* data, print_flags printFlags)
         exit(1);
     }
 
-    /* We don't want to profile our histogram functions, so delay pushing each new value until we're done with all files */
-    times = (uint64_t*)malloc(data->file_count * sizeof(*times));
-    if (!times)
+    /* Each iteration inflates every file with every inflater. A "run" is one of these, identified by the index
+     * '(inflaterIndex * file_count) + fileIndex'. Runs happen in the order given by 'order', which is only shuffled if
+     * requested. We don't want to profile our histogram functions, so delay pushing each new value until we're done with
+     * all runs */
+    times = (uint64_t*)malloc(runCount * sizeof(*times));
+    order = (size_t*)malloc(runCount * sizeof(*order));
+    if (!times || !order)
     {
         printf("ERROR: Failed to allocate memory for timing data\n");
         exit(1);
     }
 
-    for (size_t iteration = 0; iteration < test_iterations; ++iteration)
+    for (size_t i = 0; i < runCount; ++i)
+    {
+        order[i] = i;
+    }
+
+    if (printFlags && (options->warmup_iterations > 0))
+    {
+        printf("Warming up for %zu iterations\n", options->warmup_iterations);
+    }
+
+    for (iteration = 0; iteration < options->warmup_iterations; ++iteration)
+    {
+        for (size_t run = 0; run < runCount; ++run)
+        {
+            pinflater inflater = data->inflaters[run / data->file_count];
+            size_t fileIndex = run % data->file_count;
+            if (!(*inflater)->inflate_file((void*)inflater, &data->files[fileIndex], outputBuffer))
+            {
+                printf("ERROR: Failed to inflate file '%s'\n", data->files[fileIndex].filename);
+                exit(1);
+            }
+        }
+    }
+
+    for (iteration = 0; iteration < options->iterations; ++iteration)
     {
         if (printFlags && ((iteration % 100) == 0))
         {
-            printf("Iteration %zu of %zu\n", iteration, test_iterations);
+            printf("Iteration %zu of %s%zu\n", iteration, (options->confidence > 0) ? "at most " : "", options->iterations);
         }
 
-        for (size_t inflaterIndex = 0; inflaterIndex < data->inflater_count; ++inflaterIndex)
+        if (options->shuffle)
+        {
+            shuffle_indices(&rng, order, runCount);
+        }
+
+        for (size_t i = 0; i < runCount; ++i)
         {
-            uint64_t startTime = current_time(), totalTime;
-            for (size_t fileCount = 0; fileCount < data->file_count; ++fileCount)
+            size_t inflaterIndex = order[i] / data->file_count, fileIndex = order[i] % data->file_count;
+            pinflater inflater = data->inflaters[inflaterIndex];
+            uint64_t startTime;
+
+            if (options->flush)
             {
-                uint64_t fileStartTime = current_time();
-                if (!(*data->inflaters[inflaterIndex])->inflate_file((void*)data->inflaters[inflaterIndex], &data->files[fileCount], outputBuffer))
-                {
-                    printf("ERROR: Failed to inflate file '%s'\n", data->files[fileCount].filename);
-                    exit(1);
-                }
-                times[fileCount] = current_time() - fileStartTime;
+                result += flush_caches();
             }
-            totalTime = current_time() - startTime;
 
-            if (!printFlags)
+            startTime = current_time();
+            if (!(*inflater)->inflate_file((void*)inflater, &data->files[fileIndex], outputBuffer))
             {
-                /* Not printing anything, so don't bother with the histograms */
-                continue;
+                printf("ERROR: Failed to inflate file '%s'\n", data->files[fileIndex].filename);
+                exit(1);
             }
+            times[order[i]] = current_time() - startTime;
 
-            /* Done with the tight-ish loop; we can now push all this data to the histograms */
-            histogram_push(&data->results[inflaterIndex], totalTime);
-            for (size_t fileCount = 0; fileCount < data->file_count; ++fileCount)
+            /* NOTE: The stream is reset at the start of each file, so this needs to be collected after each one */
+            if (printFlags && data->phases)
             {
-                histogram_push(test_desc_file_histogram(data, inflaterIndex, fileCount), times[fileCount]);
+                accumulate_phase_times(data, inflaterIndex, fileIndex);
             }
         }
+
+        if (!printFlags && !(options->confidence > 0))
+        {
+            /* Not printing anything, so don't bother with the histograms */
+            continue;
+        }
+
+        /* Done with the tight-ish loop; we can now push all this data to the histograms. The total runtime is the sum of
+         * the file runtimes so that it is unaffected by the order of the runs */
+        for (size_t inflaterIndex = 0; inflaterIndex < data->inflater_count; ++inflaterIndex)
+        {
+            uint64_t totalTime = 0;
+            for (size_t fileIndex = 0; fileIndex < data->file_count; ++fileIndex)
+            {
+                uint64_t fileTime = times[(inflaterIndex * data->file_count) + fileIndex];
+                totalTime += fileTime;
+                if (printFlags)
+                {
+                    histogram_push(test_desc_file_histogram(data, inflaterIndex, fileIndex), fileTime);
+                }
+            }
+            histogram_push(&data->results[inflaterIndex], totalTime);
+        }
+
+        if ((options->confidence > 0) && ((iteration + 1) >= adaptive_min_iterations) &&
+            (((iteration + 1 - adaptive_min_iterations) % adaptive_check_interval) == 0) &&
+            confidence_reached(data, options->confidence))
+        {
+            ++iteration;
+            break;
+        }
     }
+    data->iterations = iteration;
 
     if (printFlags)
     {
+        if (options->confidence > 0)
+        {
+            double worst = 0;
+            for (size_t i = 0; i < data->inflater_count; ++i)
+            {
+                double interval = histogram_confidence_interval(&data->results[i]);
+                worst = (interval > worst) ? interval : worst;
+            }
+
+            if (worst <= options->confidence)
+            {
+                printf("Reached a 95%% confidence interval of +/- %.2f%% after %zu iterations\n", worst, data->iterations);
+            }
+            else
+            {
+                printf("NOTE: Stopped after %zu iterations with a 95%% confidence interval of +/- %.2f%%, short of the "
+                       "+/- %.2f%% target\n",
+                    data->iterations, worst, options->confidence);
+            }
+        }
+
         /* All runs complete */
         for (size_t i = 0; i < (data->inflater_count * (data->file_count + 1)); ++i)
         {
@@ -445,10 +758,15 @@ static int run_tests(test_desc* data, print_flags printFlags)
             {
                 print_test_histogram(
                     data, test_desc_file_histogram(data, 0, i), data->files[i].filename, data->inflater_count, 80, 15, printFlags);
+                if (data->phases)
+                {
+                    print_phase_times(data, i);
+                }
             }
         }
     }
 
+    free(order);
     free(times);
     free(outputBuffer);
 
@@ -457,6 +775,62 @@ static int run_tests(test_desc* data, print_flags printFlags)
     return (result != 0) ? 1 : 0;
 }
 
+/* Names of the 'INFLATELIB_PHASE_*' values, in order */
+static const char* const phase_names[INFLATELIB_PHASE_COUNT] = {
+    "dynamic header",
+    "table build",
+    "fast decode",
+    "slow decode",
+    "match copy",
+    "output copy",
+};
+
+static void print_phase_times(test_desc* data, size_t fileIndex)
+{
+    for (size_t i = 0; i < data->inflater_count; ++i)
+    {
+        const inflatelib_phase_times* times = test_desc_file_phases(data, i, fileIndex);
+        uintmax_t total = 0;
+
+        for (size_t j = 0; j < INFLATELIB_PHASE_COUNT; ++j)
+        {
+            total += times->ticks[j];
+        }
+
+        if (total == 0)
+        {
+            continue; /* This inflater does not record phase times */
+        }
+
+        printf("Time per phase for %s\n\n", (*data->inflaters[i])->name((void*)data->inflaters[i]));
+        printf(
+            "%15s | %25s | %6s\n",
+            "Phase",
+            (times->unit == INFLATELIB_TICKS_CYCLES) ? "Cycles per iteration" : "Nanoseconds per iteration",
+            "Share");
+        printf("----------------+---------------------------+-------\n");
+        for (size_t j = 0; j < INFLATELIB_PHASE_COUNT; ++j)
+        {
+            printf(
+                "%15s | %25.0f | %5.1f%%\n",
+                phase_names[j],
+                (double)times->ticks[j] / data->iterations,
+                ((double)times->ticks[j] * 100.0) / (double)total);
+        }
+        printf("\n");
+    }
+}
+
+static void print_memory_usage(test_desc* data)
+{
+    printf("\nPeak memory for %s:\n", deflate_algorithm_string(data->algorithm));
+    for (size_t i = 0; i < data->inflater_count; ++i)
+    {
+        void* inflater = (void*)data->inflaters[i];
+        printf("    %-12s %zu bytes\n", (*data->inflaters[i])->name(inflater), (*data->inflaters[i])->peak_memory(inflater));
+    }
+}
+
 /* TODO: Maybe just use colors? */
 /* The order is: { solid, medium, light, dark } */
 static const char* histogram_symbols[] = {"\xE2\x96\x88", "\xE2\x96\x92", "\xE2\x96\x91", "\xE2\x96\x93"};
@@ -500,7 +874,7 @@ void print_test_histogram(test_desc* tests, histogram* data, const char* title,
         /* We want to try and avoid the biggest outliers, so we don't consider a set percentage of the highest and lowest
          * times when calculating the min & max. These values are heuristically chosen */
         const size_t outlierLowIndex = 0;
-        const size_t outlierHighIndex = (test_iterations * 97) / 100;
+        const size_t outlierHighIndex = (data[0].size * 97) / 100;
         for (size_t i = 0; i < count; ++i)
         {
             uint64_t testMin = data[i].counts[outlierLowIndex];
@@ -577,7 +951,7 @@ void print_test_histogram(test_desc* tests, histogram* data, const char* title,
         {
             uint64_t endY = y * strideY;
             uint64_t startY = endY - strideY;
-            double startPctg = ((double)startY / (double)test_iterations) * 100.0;
+            double startPctg = ((double)startY / (double)data[0].size) * 100.0;
 
             printf("%6.2f%% |", startPctg);
 
@@ -698,5 +1072,31 @@ void print_test_histogram(test_desc* tests, histogram* data, const char* title,
         printf("\n");
     }
 
+    /* Output the outliers and how precise the mean is */
+    if (printFlags & pf_display_outliers)
+    {
+        if (!(printFlags & (pf_display_histogram | pf_display_table)))
+        {
+            printf("\n%s\n\n", title);
+        }
+
+        printf("  Algorithm  | Low outliers | High outliers | Low fence (ms) | High fence (ms) | Mean 95%% CI\n");
+        printf("-------------+--------------+---------------+----------------+-----------------+-------------\n");
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            histogram_outliers outliers = histogram_find_outliers(data + i);
+            printf(
+                "%12s | %12zu | %13zu | %14.5f | %15.5f | +/- %7.2f%%\n",
+                (*tests->inflaters[i])->name((void*)tests->inflaters[i]),
+                outliers.low_count,
+                outliers.high_count,
+                time_to_ms_f(outliers.low_fence),
+                time_to_ms_f(outliers.high_fence),
+                histogram_confidence_interval(data + i));
+        }
+        printf("\n");
+    }
+
     printf("\n");
 }
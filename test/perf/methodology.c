@@ -0,0 +1,101 @@
+/*
+ *    Copyright (c) Microsoft. All rights reserved.
+ *    This code is licensed under the MIT License.
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF
+ *    ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+ *    TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ *    PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ */
+#ifdef __linux__
+#define _GNU_SOURCE /* For 'sched_setaffinity' */
+#endif
+
+#include "pch.h"
+
+#include "methodology.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#elif defined(__linux__)
+#include <sched.h>
+#endif
+
+/* Comfortably larger than the last level cache of most desktop and server processors */
+static const size_t flush_buffer_size = 64 << 20;
+
+/* NOTE: Allocated on first use and intentionally never freed; it's needed until the process exits */
+static uint8_t* flush_buffer = NULL;
+
+int set_cpu_affinity(unsigned cpu)
+{
+#ifdef _WIN32
+    if (cpu >= (sizeof(DWORD_PTR) * 8))
+    {
+        return 0;
+    }
+
+    return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0;
+#elif defined(__linux__)
+    cpu_set_t set;
+    if (cpu >= CPU_SETSIZE)
+    {
+        return 0;
+    }
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return 0;
+#endif
+}
+
+uint8_t flush_caches(void)
+{
+    static uint8_t fill = 0;
+    uint8_t result = 0;
+
+    if (!flush_buffer)
+    {
+        flush_buffer = (uint8_t*)malloc(flush_buffer_size);
+        if (!flush_buffer)
+        {
+            printf("ERROR: Failed to allocate buffer for flushing the caches\n");
+            exit(1);
+        }
+    }
+
+    /* A different value each time so that every cache line is actually modified */
+    memset(flush_buffer, ++fill, flush_buffer_size);
+    for (size_t i = 0; i < flush_buffer_size; i += 64)
+    {
+        result += flush_buffer[i];
+    }
+
+    return result;
+}
+
+static uint64_t random_next(random_state* self)
+{
+    uint64_t value = self->value;
+    value ^= value << 13;
+    value ^= value >> 7;
+    value ^= value << 17;
+    self->value = value;
+    return value;
+}
+
+void shuffle_indices(random_state* rng, size_t* values, size_t count)
+{
+    /* Fisher-Yates; the slight modulo bias is irrelevant for such small counts */
+    for (size_t i = count; i > 1; --i)
+    {
+        size_t j = (size_t)(random_next(rng) % i);
+        size_t temp = values[i - 1];
+        values[i - 1] = values[j];
+        values[j] = temp;
+    }
+}
@@ -0,0 +1,35 @@
+/*
+ *    Copyright (c) Microsoft. All rights reserved.
+ *    This code is licensed under the MIT License.
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF
+ *    ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+ *    TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ *    PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ */
+#ifndef METHODOLOGY_H
+#define METHODOLOGY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Pins the calling thread to the logical processor 'cpu' so that the scheduler can't migrate it between measurements.
+ * Returns 1 on success and 0 on failure, including on platforms where this is not supported (e.g. macOS) */
+int set_cpu_affinity(unsigned cpu);
+
+/* Evicts the contents of the processor caches by writing to and then reading from a buffer that is much larger than the
+ * last level cache of a typical processor. The return value depends on the buffer's contents so that the compiler can't
+ * optimize the work away */
+uint8_t flush_caches(void);
+
+/* A small xorshift generator. It always starts from the same seed so that randomized runs are repeatable */
+typedef struct random_state
+{
+    uint64_t value;
+} random_state;
+
+#define RANDOM_STATE_INIT {0x9E3779B97F4A7C15ull}
+
+/* Randomly permutes 'values' in place */
+void shuffle_indices(random_state* rng, size_t* values, size_t count);
+
+#endif
@@ -0,0 +1,349 @@
+/*
+ *    Copyright (c) Microsoft. All rights reserved.
+ *    This code is licensed under the MIT License.
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF
+ *    ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+ *    TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ *    PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ */
+#include "pch.h"
+
+#include <inttypes.h>
+
+#include "soak.h"
+#include "timer.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <psapi.h>
+#elif defined(__linux__)
+#include <unistd.h>
+#endif
+
+/* Amount of uncompressed data between progress reports */
+static const uint64_t soak_report_interval = 256ull << 20;
+
+/* Number of symbols written to each block before starting a new one, so that block transitions are part of the stream */
+static const uint32_t soak_block_symbols = 0x10000;
+
+/* Largest number of bits a single symbol can add: a 9-bit literal/length code, 16 extra length bits (Deflate64), a 5-bit
+ * distance code, and 14 extra distance bits, rounded up to a whole number of bytes plus what may already be buffered */
+#define SOAK_MAX_SYMBOL_BYTES 16
+
+/* The length and distance codes. Deflate64 changes the meaning of length code 285 and adds distance codes 30 and 31 */
+static const uint16_t soak_length_base[] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t soak_length_extra[] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint32_t soak_distance_base[] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769,
+    1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577, 32769, 49153};
+static const uint8_t soak_distance_extra[] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13, 14, 14};
+
+/* Writes an endless-looking stream of static Huffman blocks. Rather than compressing real data, literals and
+ * length/distance pairs are chosen at random, the same way that the 'block-encode' tool leaves the choice of symbols to its
+ * caller, which makes generating the stream far cheaper than inflating it */
+typedef struct soak_encoder
+{
+    deflate_algorithm algorithm;
+    uint32_t random;
+
+    uint64_t bit_buffer;
+    uint32_t bit_count;
+
+    uint64_t target_bytes;
+    uint64_t total_bytes; /* Uncompressed bytes the symbols written so far decode to */
+    uint32_t block_symbols;
+    int done;
+} soak_encoder;
+
+static uint32_t soak_random(soak_encoder* self)
+{
+    uint32_t x = self->random;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return self->random = x;
+}
+
+static void soak_write_bits(soak_encoder* self, uint32_t value, uint32_t bitCount)
+{
+    assert(self->bit_count + bitCount <= 64);
+    self->bit_buffer |= (uint64_t)value << self->bit_count;
+    self->bit_count += bitCount;
+}
+
+/* Huffman codes are written starting with their most significant bit */
+static void soak_write_code(soak_encoder* self, uint32_t code, uint32_t bitCount)
+{
+    uint32_t reversed = 0;
+    for (uint32_t i = 0; i < bitCount; ++i)
+    {
+        reversed = (reversed << 1) | ((code >> i) & 0x01);
+    }
+    soak_write_bits(self, reversed, bitCount);
+}
+
+static void soak_write_symbol(soak_encoder* self, uint32_t symbol)
+{
+    if (symbol < 144)
+    {
+        soak_write_code(self, 0x30 + symbol, 8);
+    }
+    else if (symbol < 256)
+    {
+        soak_write_code(self, 0x190 + (symbol - 144), 9);
+    }
+    else if (symbol < 280)
+    {
+        soak_write_code(self, symbol - 256, 7);
+    }
+    else
+    {
+        soak_write_code(self, 0xC0 + (symbol - 280), 8);
+    }
+}
+
+static void soak_write_block_header(soak_encoder* self, int final)
+{
+    soak_write_bits(self, final ? 1 : 0, 1);
+    soak_write_bits(self, 1, 2); /* Static Huffman */
+    self->block_symbols = 0;
+}
+
+static void soak_write_match(soak_encoder* self, uint32_t length, uint32_t distance)
+{
+    size_t code;
+    if ((self->algorithm == deflate_algorithm_deflate64) && (length > 257))
+    {
+        /* Deflate64 re-purposes the last length code for 3 to 65538 bytes */
+        soak_write_symbol(self, 285);
+        soak_write_bits(self, length - 3, 16);
+    }
+    else
+    {
+        for (code = ARRAYSIZE(soak_length_base) - 1; soak_length_base[code] > length; --code)
+        {
+        }
+        soak_write_symbol(self, (uint32_t)(257 + code));
+        soak_write_bits(self, length - soak_length_base[code], soak_length_extra[code]);
+    }
+
+    for (code = ARRAYSIZE(soak_distance_base) - 1; soak_distance_base[code] > distance; --code)
+    {
+    }
+    soak_write_code(self, (uint32_t)code, 5);
+    soak_write_bits(self, distance - soak_distance_base[code], soak_distance_extra[code]);
+}
+
+static void soak_encoder_init(soak_encoder* self, deflate_algorithm alg, uint64_t targetBytes)
+{
+    memset(self, 0, sizeof(*self));
+    self->algorithm = alg;
+    self->random = 0x2545F491;
+    self->target_bytes = targetBytes;
+    soak_write_block_header(self, 0);
+}
+
+/* Chooses the next symbol. Roughly a quarter of the symbols are literals; the rest are matches that are mostly short and
+ * nearby, as in typical data, with a tail of long matches at distances spanning the whole window */
+static void soak_write_next_symbol(soak_encoder* self)
+{
+    uint32_t windowSize = (self->algorithm == deflate_algorithm_deflate64) ? 0x10000 : 0x8000;
+    uint32_t maxLength = (self->algorithm == deflate_algorithm_deflate64) ? 65538 : 258;
+    uint32_t choice = soak_random(self) % 16;
+    uint32_t length, distance;
+
+    if ((choice < 4) || (self->total_bytes == 0))
+    {
+        soak_write_symbol(self, soak_random(self) & 0xFF);
+        ++self->total_bytes;
+        return;
+    }
+
+    if (choice < 12)
+    {
+        length = 3 + (soak_random(self) % 30);
+        distance = 1 + (soak_random(self) % 1024);
+    }
+    else
+    {
+        /* Deflate64 matches longer than 258 bytes are rare in practice and would otherwise dominate the output */
+        uint32_t lengthRange = ((choice == 15) && ((soak_random(self) % 64) == 0)) ? maxLength - 2 : 256;
+        length = 3 + (soak_random(self) % lengthRange);
+        distance = 1 + (soak_random(self) % windowSize);
+    }
+
+    if (distance > self->total_bytes)
+    {
+        distance = (uint32_t)self->total_bytes;
+    }
+
+    soak_write_match(self, length, distance);
+    self->total_bytes += length;
+}
+
+/* Writes up to 'size' bytes of the stream to 'buffer', returning the number of bytes written. Returns zero once the whole
+ * stream has been written */
+static size_t soak_encoder_fill(soak_encoder* self, uint8_t* buffer, size_t size)
+{
+    size_t result = 0;
+    while (!self->done && (result + SOAK_MAX_SYMBOL_BYTES <= size))
+    {
+        if (self->total_bytes >= self->target_bytes)
+        {
+            /* End the current block and add an empty final block, padded to a whole byte */
+            soak_write_symbol(self, 256);
+            soak_write_block_header(self, 1);
+            soak_write_symbol(self, 256);
+            soak_write_bits(self, 0, (8 - (self->bit_count % 8)) % 8);
+            self->done = 1;
+        }
+        else if (++self->block_symbols > soak_block_symbols)
+        {
+            soak_write_symbol(self, 256);
+            soak_write_block_header(self, 0);
+        }
+        else
+        {
+            soak_write_next_symbol(self);
+        }
+
+        while (self->bit_count >= 8)
+        {
+            buffer[result++] = (uint8_t)self->bit_buffer;
+            self->bit_buffer >>= 8;
+            self->bit_count -= 8;
+        }
+    }
+
+    return result;
+}
+
+/* Returns the resident set size of the process, or zero if it can't be determined on this platform */
+static size_t soak_resident_bytes(void)
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        return counters.WorkingSetSize;
+    }
+#elif defined(__linux__)
+    unsigned long pages = 0, resident = 0;
+    FILE* file = fopen("/proc/self/statm", "r");
+    if (file)
+    {
+        int count = fscanf(file, "%lu %lu", &pages, &resident);
+        fclose(file);
+        if (count == 2)
+        {
+            return (size_t)resident * (size_t)sysconf(_SC_PAGESIZE);
+        }
+    }
+#endif
+    return 0;
+}
+
+void run_soak_tests(deflate_algorithm alg, const pinflater* inflaters, size_t inflaterCount, uint64_t gib)
+{
+    size_t inputSize = (input_chunk_size < output_buffer_size) ? input_chunk_size : output_buffer_size;
+    uint8_t* inputBuffer = (uint8_t*)malloc(inputSize);
+    uint8_t* outputBuffer = (uint8_t*)malloc(output_chunk_size);
+    if (!inputBuffer || !outputBuffer)
+    {
+        printf("ERROR: Failed to allocate soak test buffers\n");
+        exit(1);
+    }
+
+    printf("--------------------------------------------------------------------------------\n");
+    printf("Running soak tests for %s (%" PRIu64 " GiB per stream, %zu byte input and %zu byte output buffers)...\n",
+        deflate_algorithm_string(alg), gib, inputSize, output_chunk_size);
+
+    for (size_t inflaterIndex = 0; inflaterIndex < inflaterCount; ++inflaterIndex)
+    {
+        void* inflater = (void*)inflaters[inflaterIndex];
+        const inflater_vtable* vtable = *inflaters[inflaterIndex];
+        soak_encoder encoder;
+        uint64_t totalOutput = 0, nextReport = soak_report_interval;
+        uint64_t totalTime = 0, intervalTime = 0, intervalOutput = 0;
+        size_t available = 0;
+        uint8_t* next = inputBuffer;
+        inflate_result result = inflate_result_ok;
+
+        if (!vtable->init(inflater))
+        {
+            printf("ERROR: Failed to initialize inflater\n");
+            exit(1);
+        }
+
+        soak_encoder_init(&encoder, alg, gib << 30);
+        printf("\n%s:\n", vtable->name(inflater));
+        printf("   Output (GiB) |  Interval (MiB/s) |   Overall (MiB/s) |   RSS (MiB)\n");
+        printf("  --------------+-------------------+-------------------+-------------\n");
+
+        while (result != inflate_result_eof)
+        {
+            size_t consumed, written = output_chunk_size;
+            uint64_t start;
+
+            if (available == 0)
+            {
+                /* Generating the input is not timed */
+                next = inputBuffer;
+                available = soak_encoder_fill(&encoder, inputBuffer, inputSize);
+            }
+
+            consumed = available;
+            start = current_time();
+            result = vtable->inflate_buffer(inflater, next, &consumed, outputBuffer, &written);
+            intervalTime += current_time() - start;
+            if (result == inflate_result_error)
+            {
+                exit(1);
+            }
+            else if ((result == inflate_result_ok) && (consumed == 0) && (written == 0))
+            {
+                printf("ERROR: %s stopped making progress\n", vtable->name(inflater));
+                exit(1);
+            }
+
+            next += consumed;
+            available -= consumed;
+            totalOutput += written;
+            intervalOutput += written;
+
+            if (result == inflate_result_eof)
+            {
+                totalTime += intervalTime;
+                printf("  Inflated %" PRIu64 " bytes in %.3f seconds (%.1f MiB/s)\n", totalOutput, time_to_ms(totalTime) / 1000.0,
+                    ((double)totalOutput / (double)(1 << 20)) / (time_to_ms(totalTime) / 1000.0));
+            }
+            else if (totalOutput >= nextReport)
+            {
+                totalTime += intervalTime;
+                printf("  %12.2f  | %17.1f | %17.1f | %11.1f\n",
+                    (double)totalOutput / (double)(1ull << 30),
+                    ((double)intervalOutput / (double)(1 << 20)) / (time_to_ms(intervalTime) / 1000.0),
+                    ((double)totalOutput / (double)(1 << 20)) / (time_to_ms(totalTime) / 1000.0),
+                    (double)soak_resident_bytes() / (double)(1 << 20));
+                intervalTime = 0;
+                intervalOutput = 0;
+                nextReport += soak_report_interval;
+            }
+        }
+
+        if (totalOutput != encoder.total_bytes)
+        {
+            printf("ERROR: %s produced %" PRIu64 " bytes, but %" PRIu64 " were expected\n", vtable->name(inflater), totalOutput,
+                encoder.total_bytes);
+            exit(1);
+        }
+
+        vtable->destroy(inflater);
+    }
+
+    printf("\n");
+    free(inputBuffer);
+    free(outputBuffer);
+}
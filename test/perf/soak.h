@@ -0,0 +1,24 @@
+/*
+ *    Copyright (c) Microsoft. All rights reserved.
+ *    This code is licensed under the MIT License.
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF
+ *    ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+ *    TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ *    PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ */
+#ifndef SOAK_H
+#define SOAK_H
+
+#include "algorithms.h"
+
+/* Default amount of uncompressed data produced by each soak test stream */
+#define SOAK_DEFAULT_GIB 4
+
+/* Inflates a single stream of 'gib' GiB of uncompressed data with each inflater, streaming the input and output through
+ * buffers of 'input_chunk_size' and 'output_chunk_size' bytes. The input is generated as it is consumed, so the stream
+ * never needs to fit in memory and is far too large to stay in cache. Throughput and the resident set size are reported
+ * at regular intervals so that any slowdown or growth over the life of a long stream is visible. Failures are reported
+ * and exit the process */
+void run_soak_tests(deflate_algorithm alg, const pinflater* inflaters, size_t inflaterCount, uint64_t gib);
+
+#endif
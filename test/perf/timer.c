@@ -0,0 +1,69 @@
+/*
+ *    Copyright (c) Microsoft. All rights reserved.
+ *    This code is licensed under the MIT License.
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF
+ *    ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+ *    TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ *    PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ */
+#include "pch.h"
+
+#include "timer.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <time.h>
+#endif
+
+#ifdef _WIN32
+uint64_t current_time(void)
+{
+    LARGE_INTEGER result;
+    BOOL success = QueryPerformanceCounter(&result);
+    (void)success; /* Only used for assert */
+    assert(success);
+
+    return (uint64_t)result.QuadPart;
+}
+
+double time_to_ms(uint64_t time)
+{
+    LARGE_INTEGER frequency;
+    BOOL success = QueryPerformanceFrequency(&frequency);
+    (void)success; /* Only used for assert */
+    assert(success);
+
+    return ((double)time / (double)frequency.QuadPart) * 1000.0;
+}
+
+double time_to_ms_f(double time)
+{
+    LARGE_INTEGER frequency;
+    BOOL success = QueryPerformanceFrequency(&frequency);
+    (void)success; /* Only used for assert */
+    assert(success);
+
+    return (time / (double)frequency.QuadPart) * 1000.0;
+}
+#else
+uint64_t current_time(void)
+{
+    struct timespec result;
+    int error = clock_gettime(CLOCK_MONOTONIC, &result);
+    (void)error; /* Only used for assert */
+    assert(error == 0);
+
+    return (uint64_t)result.tv_sec * 1000000000ull + (uint64_t)result.tv_nsec;
+}
+
+double time_to_ms(uint64_t time)
+{
+    return (double)time / 1000000.0;
+}
+
+double time_to_ms_f(double time)
+{
+    return time / 1000000.0;
+}
+#endif
@@ -0,0 +1,20 @@
+/*
+ *    Copyright (c) Microsoft. All rights reserved.
+ *    This code is licensed under the MIT License.
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF
+ *    ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+ *    TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ *    PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ */
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+
+/* Returns a monotonically increasing time in platform specific units. Use the functions below to convert a difference
+ * between two of these values to milliseconds */
+uint64_t current_time(void);
+double time_to_ms(uint64_t time);
+double time_to_ms_f(double time);
+
+#endif
@@ -0,0 +1,139 @@
+/*
+ *    Copyright (c) Microsoft. All rights reserved.
+ *    This code is licensed under the MIT License.
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF
+ *    ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+ *    TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ *    PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ */
+#ifndef ZIP_H
+#define ZIP_H
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* The zip file headers, mirroring the structures used by the 'zip-extract' tool. Multi-byte values are stored as arrays of
+ * little endian bytes so that the structures have no padding or alignment requirements and can be read directly from a
+ * file's data */
+typedef struct le_u16
+{
+    uint8_t bytes[2];
+} le_u16;
+
+typedef struct le_u32
+{
+    uint8_t bytes[4];
+} le_u32;
+
+static inline uint16_t le_u16_get(le_u16 value)
+{
+    return (uint16_t)(value.bytes[0] | (value.bytes[1] << 8));
+}
+
+static inline uint32_t le_u32_get(le_u32 value)
+{
+    return (uint32_t)value.bytes[0] | ((uint32_t)value.bytes[1] << 8) | ((uint32_t)value.bytes[2] << 16) |
+           ((uint32_t)value.bytes[3] << 24);
+}
+
+/* Compression methods that this library can inflate */
+#define ZIP_METHOD_DEFLATE 8
+#define ZIP_METHOD_DEFLATE64 9
+
+/* General purpose bit flags */
+#define ZIP_FLAG_ENCRYPTED 0x0001
+
+/* Sizes and offsets are set to this value when the real value is in the ZIP64 extra field */
+#define ZIP64_SENTINEL 0xFFFFFFFF
+
+typedef struct end_of_central_directory
+{
+    uint8_t signature[4]; /* PK\5\6 */
+    le_u16 disk_number;
+    le_u16 disk_with_cd;
+    le_u16 cd_records_on_disk;
+    le_u16 cd_records;
+    le_u32 cd_size;
+    le_u32 cd_offset;
+    le_u16 comment_length;
+    /* uint8_t comment[]; */
+} end_of_central_directory;
+static_assert(sizeof(end_of_central_directory) == 22, "Unexpected padding in end_of_central_directory");
+
+static inline int end_of_central_directory_valid(const end_of_central_directory* self)
+{
+    static const uint8_t expected[4] = {0x50, 0x4B, 0x05, 0x06};
+    return memcmp(self->signature, expected, 4) == 0;
+}
+
+typedef struct central_directory_file_header
+{
+    uint8_t signature[4]; /* PK\1\2 */
+    le_u16 version;
+    le_u16 min_version;
+    le_u16 bit_flag;
+    le_u16 compression_method;
+    le_u16 mod_time;
+    le_u16 mod_date;
+    le_u32 crc32;
+    le_u32 compressed_size;
+    le_u32 uncompressed_size;
+    le_u16 file_name_length;
+    le_u16 extra_field_length;
+    le_u16 file_comment_length;
+    le_u16 disk_number_start;
+    le_u16 internal_file_attribute;
+    le_u32 external_file_attributes;
+    le_u32 local_file_header_offset;
+    /* char file_name[]; */
+    /* uint8_t extra_field[]; */
+    /* char file_comment[]; */
+} central_directory_file_header;
+static_assert(sizeof(central_directory_file_header) == 46, "Unexpected padding in central_directory_file_header");
+
+static inline int central_directory_file_header_valid(const central_directory_file_header* self)
+{
+    static const uint8_t expected[4] = {0x50, 0x4B, 0x01, 0x02};
+    return memcmp(self->signature, expected, 4) == 0;
+}
+
+/* The size of the header, including the variable length data that follows it */
+static inline size_t central_directory_file_header_size(const central_directory_file_header* self)
+{
+    return sizeof(*self) + le_u16_get(self->file_name_length) + le_u16_get(self->extra_field_length) +
+           le_u16_get(self->file_comment_length);
+}
+
+typedef struct local_file_header
+{
+    uint8_t signature[4]; /* PK\3\4 */
+    le_u16 version;
+    le_u16 bit_flag;
+    le_u16 compression_method;
+    le_u16 mod_time;
+    le_u16 mod_date;
+    le_u32 crc32;
+    le_u32 compressed_size;
+    le_u32 uncompressed_size;
+    le_u16 file_name_length;
+    le_u16 extra_field_length;
+    /* char file_name[]; */
+    /* uint8_t extra_field[]; */
+} local_file_header;
+static_assert(sizeof(local_file_header) == 30, "Unexpected padding in local_file_header");
+
+static inline int local_file_header_valid(const local_file_header* self)
+{
+    static const uint8_t expected[4] = {0x50, 0x4B, 0x03, 0x04};
+    return memcmp(self->signature, expected, 4) == 0;
+}
+
+/* The size of the header, including the variable length data that follows it. The file's data immediately follows */
+static inline size_t local_file_header_size(const local_file_header* self)
+{
+    return sizeof(*self) + le_u16_get(self->file_name_length) + le_u16_get(self->extra_field_length);
+}
+
+#endif
@@ -0,0 +1,346 @@
+/*
+ *    Copyright (c) Microsoft. All rights reserved.
+ *    This code is licensed under the MIT License.
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF
+ *    ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+ *    TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ *    PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ */
+#define __STDC_WANT_LIB_EXT1__ 1 /* For fopen_s */
+#include <cstdio>
+
+#if !defined(__STDC_LIB_EXT1__) && !defined(_WIN32)
+#include <errno.h>
+static int fopen_s(FILE** streamptr, const char* filename, const char* mode)
+{
+    *streamptr = fopen(filename, mode);
+    return (*streamptr == nullptr) ? errno : 0;
+}
+#endif
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#define ZIP_INFLATE_HAS_MMAP 1
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <print>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <inflatelib_zip.hpp>
+
+// Size of the heap buffer used by the 'fwrite' path
+static constexpr std::size_t write_buffer_size = 0x100000;
+
+struct extract_stats
+{
+    std::uint64_t entries = 0;
+    std::uint64_t bytes = 0;
+    std::uint64_t fallbacks = 0; // Entries whose size was unknown and were written with 'fwrite' instead
+    std::chrono::steady_clock::duration time = {};
+};
+
+// Rejects entry names that would escape the output directory
+static bool is_safe_path(const std::filesystem::path& path)
+{
+    if (path.empty() || path.has_root_path())
+    {
+        return false;
+    }
+
+    for (auto& part : path)
+    {
+        if (part == "..")
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Inflates the current entry into a heap buffer, writing each full buffer to the file
+static std::uint64_t extract_fwrite(
+    inflatelib::zip_reader& reader, const std::filesystem::path& path, std::span<std::byte> buffer)
+{
+    FILE* handle;
+    if (fopen_s(&handle, path.string().c_str(), "wb") != 0)
+    {
+        throw std::runtime_error("Failed to open '" + path.string() + "' for writing");
+    }
+    std::unique_ptr<FILE, decltype(&fclose)> file(handle, &fclose);
+
+    std::uint64_t result = 0;
+    while (auto bytesRead = reader.read(buffer))
+    {
+        if (fwrite(buffer.data(), 1, bytesRead, file.get()) != bytesRead)
+        {
+            throw std::runtime_error("Failed to write to '" + path.string() + "'");
+        }
+        result += bytesRead;
+    }
+
+    return result;
+}
+
+#if ZIP_INFLATE_HAS_MMAP
+struct unique_fd
+{
+    int fd;
+
+    ~unique_fd()
+    {
+        ::close(fd);
+    }
+};
+
+struct unique_mapping
+{
+    void* address;
+    std::size_t size;
+
+    ~unique_mapping()
+    {
+        ::munmap(address, size);
+    }
+};
+
+// Preallocates the file using the uncompressed size from the local header, maps it, and inflates directly into the mapping
+// 'windowSize' bytes at a time. Each window is handed to the kernel for write-back as soon as it's full
+static std::uint64_t extract_mmap(inflatelib::zip_reader& reader, const std::filesystem::path& path, std::size_t windowSize)
+{
+    auto size = reader.entry().uncompressed_size;
+    unique_fd file = {::open(path.string().c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644)};
+    if (file.fd < 0)
+    {
+        throw std::runtime_error("Failed to open '" + path.string() + "' for writing");
+    }
+
+    std::byte trailing[1];
+    if (size == 0)
+    {
+        if (reader.read(trailing) != 0)
+        {
+            throw std::runtime_error("Entry '" + reader.entry().name + "' is larger than its recorded size");
+        }
+        return 0;
+    }
+
+    if (auto err = ::posix_fallocate(file.fd, 0, static_cast<off_t>(size)); err != 0)
+    {
+        throw std::runtime_error("Failed to allocate " + std::to_string(size) + " bytes for '" + path.string() + "'");
+    }
+
+    auto address = ::mmap(nullptr, static_cast<std::size_t>(size), PROT_READ | PROT_WRITE, MAP_SHARED, file.fd, 0);
+    if (address == MAP_FAILED)
+    {
+        throw std::runtime_error("Failed to map '" + path.string() + "'");
+    }
+    unique_mapping mapping = {address, static_cast<std::size_t>(size)};
+    ::madvise(mapping.address, mapping.size, MADV_SEQUENTIAL);
+
+    auto data = static_cast<std::byte*>(mapping.address);
+    for (std::size_t offset = 0; offset < mapping.size;)
+    {
+        auto windowEnd = std::min(offset + windowSize, mapping.size);
+        auto windowStart = offset;
+        while (offset < windowEnd)
+        {
+            auto bytesRead = reader.read({data + offset, windowEnd - offset});
+            if (bytesRead == 0)
+            {
+                throw std::runtime_error("Entry '" + reader.entry().name + "' is smaller than its recorded size");
+            }
+            offset += bytesRead;
+        }
+
+        // NOTE: 'windowSize' is a multiple of the page size, so 'windowStart' is always page aligned
+        ::msync(data + windowStart, windowEnd - windowStart, MS_ASYNC);
+    }
+
+    // Reading past the end of the data validates the sizes
+    if (reader.read(trailing) != 0)
+    {
+        throw std::runtime_error("Entry '" + reader.entry().name + "' is larger than its recorded size");
+    }
+
+    return size;
+}
+#endif
+
+static extract_stats extract_all(
+    const char* zipPath, const std::filesystem::path& outputDir, bool useMmap, [[maybe_unused]] std::size_t windowSize)
+{
+    std::ifstream archive(zipPath, std::ios::binary);
+    if (!archive)
+    {
+        throw std::runtime_error(std::string("Failed to open file '") + zipPath + "'");
+    }
+
+    extract_stats result;
+    std::vector<std::byte> buffer(write_buffer_size);
+    auto start = std::chrono::steady_clock::now();
+
+    inflatelib::zip_reader reader(*archive.rdbuf());
+    while (reader.next_entry())
+    {
+        std::filesystem::path name(reader.entry().name);
+        if (!is_safe_path(name))
+        {
+            std::println("WARNING: Skipping entry with unsafe name '{}'", reader.entry().name);
+            continue;
+        }
+
+        auto path = outputDir / name;
+        if (reader.entry().name.ends_with('/'))
+        {
+            std::filesystem::create_directories(path);
+            continue;
+        }
+        std::filesystem::create_directories(path.parent_path());
+
+#if ZIP_INFLATE_HAS_MMAP
+        if (useMmap && !reader.entry().has_data_descriptor())
+        {
+            result.bytes += extract_mmap(reader, path, windowSize);
+        }
+        else
+#endif
+        {
+            result.fallbacks += useMmap ? 1 : 0;
+            result.bytes += extract_fwrite(reader, path, buffer);
+        }
+        ++result.entries;
+    }
+
+    result.time = std::chrono::steady_clock::now() - start;
+    return result;
+}
+
+static void print_stats(std::string_view mode, const extract_stats& stats)
+{
+    auto seconds = std::chrono::duration<double>(stats.time).count();
+    auto mib = static_cast<double>(stats.bytes) / (1024 * 1024);
+    std::println("{:<8}{:>10} entries{:>14} bytes{:>12.3f} s{:>12.1f} MiB/s", mode, stats.entries, stats.bytes, seconds,
+        (seconds > 0) ? (mib / seconds) : 0.0);
+    if (stats.fallbacks)
+    {
+        std::println("        {} entries had no size in their local header and were written with fwrite", stats.fallbacks);
+    }
+}
+
+void print_usage()
+{
+    std::println(R"^-^(
+USAGE
+    zip-inflate <path> <output-dir> [fwrite] [mmap] [-w <MiB>]
+
+DESCRIPTION
+    Extracts the Deflate, Deflate64, and stored entries of a zip file into the specified directory, reading the zip file
+    in a single pass, and reports the throughput of each output method. If neither 'fwrite' nor 'mmap' is specified,
+    both are run, one after the other, each overwriting the output of the previous run.
+
+ARGUMENTS
+    path        The path to the input zip file.
+    output-dir  The directory that entries are extracted to. Created if it does not exist.
+    fwrite      Inflate each entry into a heap buffer that is written to the output file with 'fwrite'.
+    mmap        Preallocate each output file using the size in its local header, map it into memory, and inflate
+                directly into the mapping. Entries without a size in their local header use 'fwrite'. Not supported on
+                Windows.
+    -w <MiB>    The amount of output inflated into the mapping before it is handed off for asynchronous write-back.
+                Default is 16.
+)^-^");
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        std::println("ERROR: Expected path to a zip file and an output directory");
+        return print_usage(), 1;
+    }
+
+    bool runFwrite = false;
+    bool runMmap = false;
+    std::size_t windowSize = 16 * 1024 * 1024;
+    for (int i = 3; i < argc; ++i)
+    {
+        std::string_view arg = argv[i];
+        if (arg == "fwrite")
+        {
+            runFwrite = true;
+        }
+        else if (arg == "mmap")
+        {
+            runMmap = true;
+        }
+        else if ((arg == "-w") && (i + 1 < argc))
+        {
+            auto mib = std::strtoul(argv[++i], nullptr, 10);
+            if (mib == 0)
+            {
+                std::println("ERROR: Invalid window size '{}'", argv[i]);
+                return print_usage(), 1;
+            }
+            else if (mib > SIZE_MAX / (1024 * 1024))
+            {
+                std::println("ERROR: Window size '{}' MiB is too large", argv[i]);
+                return print_usage(), 1;
+            }
+            windowSize = static_cast<std::size_t>(mib) * 1024 * 1024;
+        }
+        else
+        {
+            std::println("ERROR: Unknown argument '{}'", arg);
+            return print_usage(), 1;
+        }
+    }
+
+    if (!runFwrite && !runMmap)
+    {
+        runFwrite = true;
+        runMmap = true;
+    }
+
+#if !ZIP_INFLATE_HAS_MMAP
+    if (runMmap)
+    {
+        std::println("WARNING: 'mmap' is not supported on this platform");
+        runMmap = false;
+    }
+#endif
+
+    try
+    {
+        std::filesystem::path outputDir(argv[2]);
+        std::filesystem::create_directories(outputDir);
+
+        if (runFwrite)
+        {
+            print_stats("fwrite", extract_all(argv[1], outputDir, false, windowSize));
+        }
+
+        if (runMmap)
+        {
+            print_stats("mmap", extract_all(argv[1], outputDir, true, windowSize));
+        }
+    }
+    catch (std::exception& e)
+    {
+        std::println("ERROR: {}", e.what());
+        return 1;
+    }
+}